@@ -74,4 +74,25 @@ OcAppleChunklistVerifyData (
   IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
   );
 
+/**
+  Load file into RAM disk and verify it against a chunklist context in one pass.
+  Every chunk is hashed while it passes through the load buffer, so loaded data
+  is not read back for verification. Data past the last chunk is loaded as is,
+  matching OcAppleChunklistVerifyData.
+
+  @param[in] Context      The Context to verify against.
+  @param[in] ExtentTable  Allocated extent table of at least FileSize bytes.
+  @param[in] File         File protocol open for reading.
+  @param[in] FileSize     Amount of data to load.
+
+  @retval TRUE on success, FALSE on read error or chunk mismatch.
+**/
+BOOLEAN
+OcAppleChunklistLoadFile (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     EFI_FILE_PROTOCOL                  *File,
+  IN     UINTN                              FileSize
+  );
+
 #endif // APPLE_CHUNKLIST_LIB_H
@@ -20,16 +20,60 @@
 #include <Library/OcAppleChunklistLib.h>
 #include <Library/OcAppleRamDiskLib.h>
 
+//
+// Default number of decompressed chunks kept in disk image context.
+// Chunks are normally 1 MB when decompressed.
+//
+#define OC_APPLE_DISK_IMAGE_DEFAULT_CACHE_CAPACITY  4
+
+//
+// Decompressed chunk cache entry.
+//
+typedef struct {
+    CONST APPLE_DISK_IMAGE_CHUNK      *Chunk;
+    UINT8                             *Data;
+    UINTN                             DataSize;
+    UINT64                            LastUse;
+} OC_APPLE_DISK_IMAGE_CACHE_ENTRY;
+
+//
+// Sector range of a chunk, absolute and clipped to its block.
+//
+typedef struct {
+    UINT64                            SectorStart;
+    UINT64                            SectorEnd;
+    APPLE_DISK_IMAGE_BLOCK_DATA       *BlockData;
+    APPLE_DISK_IMAGE_CHUNK            *Chunk;
+} OC_APPLE_DISK_IMAGE_CHUNK_RANGE;
+
 //
 // Disk image context.
 //
 typedef struct {
     CONST APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable;
+    OC_APPLE_RAM_DISK_CURSOR          ExtentCursor;
 
     UINTN                             SectorCount;
 
     UINT32                            BlockCount;
     APPLE_DISK_IMAGE_BLOCK_DATA       **Blocks;
+
+    //
+    // Chunk ranges sorted by sector with last lookup position.
+    // When NULL, lookups walk Blocks.
+    //
+    UINT32                            ChunkRangeCount;
+    OC_APPLE_DISK_IMAGE_CHUNK_RANGE   *ChunkRanges;
+    UINT32                            ChunkRangeCursor;
+
+    //
+    // Least recently used cache of decompressed chunks, allocated on demand.
+    //
+    UINT32                            CacheCapacity;
+    OC_APPLE_DISK_IMAGE_CACHE_ENTRY   *Cache;
+    UINT64                            CacheTick;
+    UINT64                            CacheHits;
+    UINT64                            CacheMisses;
 } OC_APPLE_DISK_IMAGE_CONTEXT;
 
 BOOLEAN
@@ -39,10 +83,24 @@ OcAppleDiskImageInitializeContext (
   IN  UINTN                              FileSize
   );
 
+/**
+  Initialise disk image context preloading image data from File to RAM disk.
+  The whole image is loaded before any sector is served, because boot.efi
+  passes the RAM disk extents to the kernel, which reads the image after
+  ExitBootServices when File can no longer be accessed.
+
+  @param[out]    Context           Disk image context.
+  @param[in]     File              Opened image file.
+  @param[in,out] ChunklistContext  Chunklist context to verify the image against
+                                   while it is loaded, optional.
+
+  @retval TRUE on success.
+**/
 BOOLEAN
 OcAppleDiskImageInitializeFromFile (
-  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  EFI_FILE_PROTOCOL            *File
+  OUT    OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     EFI_FILE_PROTOCOL            *File,
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext OPTIONAL
   );
 
 VOID
@@ -60,6 +118,19 @@ OcAppleDiskImageVerifyData (
   IN OUT OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext
   );
 
+/**
+  Change decompressed chunk cache capacity and drop cached chunks.
+  Capacity 0 disables the cache.
+
+  @param[in,out] Context   Disk image context.
+  @param[in]     Capacity  Maximum number of cached chunks.
+**/
+VOID
+OcAppleDiskImageSetCacheCapacity (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       Capacity
+  );
+
 BOOLEAN
 OcAppleDiskImageRead (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
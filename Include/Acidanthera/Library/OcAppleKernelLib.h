@@ -128,6 +128,24 @@ typedef struct {
   // Used for caching prelinked kexts.
   //
   LIST_ENTRY               PrelinkedKexts;
+  //
+  // Hash map of kext identifiers to KextList entries and cached kexts.
+  // Built in PrelinkedContextInit, may be NULL when out of resources.
+  //
+  VOID                     *KextIndex;
+  //
+  // Used KextIndex slots.
+  //
+  UINT32                   KextIndexCount;
+  //
+  // KextIndex slot count - 1, slot count is a power of two.
+  //
+  UINT32                   KextIndexMask;
+  //
+  // Disable symbol lookup indices and use linear scans instead.
+  // Only meant for benchmarking and debugging.
+  //
+  BOOLEAN                  DisableSymbolIndices;
 } PRELINKED_CONTEXT;
 
 //
@@ -387,6 +405,24 @@ PatcherApplyGenericPatch (
   IN     PATCHER_GENERIC_PATCH  *Patch
   );
 
+/**
+  Apply multiple generic patches in a single pass over patcher data.
+  The result is identical to calling PatcherApplyGenericPatch for
+  every patch in order.
+
+  @param[in,out] Context         Patcher context.
+  @param[in]     Patches         Patch descriptions.
+  @param[in]     PatchCount      Patch count.
+  @param[out]    Results         Per-patch status, PatchCount entries.
+**/
+VOID
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 PatchCount,
+     OUT EFI_STATUS             *Results
+  );
+
 /**
   Block kext from loading.
 
@@ -18,6 +18,26 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/AppleRamDisk.h>
 #include <Protocol/SimpleFileSystem.h>
 
+/**
+  RAM disk cursor for repeated accesses to one extent table.
+  Extent start offsets are precomputed for binary search, and the last
+  accessed extent is remembered, so sequential accesses resolve in O(1).
+**/
+typedef struct {
+  ///
+  /// Allocated extent table.
+  ///
+  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable;
+  ///
+  /// Extent of the last access.
+  ///
+  UINT32                             Extent;
+  ///
+  /// RAM disk offset of every extent, followed by RAM disk size.
+  ///
+  UINTN                              ExtentOffsets[APPLE_RAM_DISK_MAX_EXTENTS + 1];
+} OC_APPLE_RAM_DISK_CURSOR;
+
 /**
   Request allocation of Size bytes in extents table.
 
@@ -68,6 +88,55 @@ OcAppleRamDiskWrite (
   IN CONST VOID                         *Buffer
   );
 
+/**
+  Initialise RAM disk cursor. Extent table must not change while
+  the cursor is in use.
+
+  @param[out] Cursor      RAM disk cursor.
+  @param[in]  ExtentTable Allocated extent table.
+**/
+VOID
+OcAppleRamDiskInitCursor (
+  OUT OC_APPLE_RAM_DISK_CURSOR           *Cursor,
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
+  );
+
+/**
+  Read RAM disk data through cursor.
+
+  @param[in,out] Cursor  Initialised RAM disk cursor.
+  @param[in]     Offset  Offset in RAM disk.
+  @param[in]     Size    Amount of data to read.
+  @param[out]    Buffer  Resulting data.
+
+  @retval TRUE on success.
+**/
+BOOLEAN
+OcAppleRamDiskCursorRead (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  OUT    VOID                      *Buffer
+  );
+
+/**
+  Write RAM disk data through cursor.
+
+  @param[in,out] Cursor  Initialised RAM disk cursor.
+  @param[in]     Offset  Offset in RAM disk.
+  @param[in]     Size    Amount of data to write.
+  @param[in]     Buffer  Source data.
+
+  @retval TRUE on success.
+**/
+BOOLEAN
+OcAppleRamDiskCursorWrite (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  IN     CONST VOID                *Buffer
+  );
+
 /**
   Load file into RAM disk as it is.
 
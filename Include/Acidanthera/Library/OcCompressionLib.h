@@ -21,6 +21,11 @@
 **/
 #define OC_COMPRESSION_MAX_LENGTH BASE_1GB
 
+/**
+  LZVN decompression window checksummed at once, fits in L2 cache.
+**/
+#define OC_LZVN_CHECKSUM_WINDOW BASE_64KB
+
 /**
   Allow the use of extra adler32 validation.
   Not very useful as dmg has own checks.
@@ -63,6 +68,27 @@ DecompressLZSS (
   IN  UINT32  SrcLen
   );
 
+/**
+  Decompress buffer with LZSS algorithm and calculate Adler-32 checksum
+  of decompressed data as it is produced.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+  @param[out]  Checksum    Adler-32 checksum of decompressed data.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINT32
+DecompressLZSSWithChecksum (
+  OUT UINT8   *Dst,
+  IN  UINT32  DstLen,
+  IN  UINT8   *Src,
+  IN  UINT32  SrcLen,
+  OUT UINT32  *Checksum
+  );
+
 /**
   Decompress buffer with LZVN algorithm.
 
@@ -81,6 +107,44 @@ DecompressLZVN (
   IN  UINTN        SrcLen
   );
 
+/**
+  Decompress buffer with LZVN algorithm and calculate Adler-32 checksum
+  of decompressed data as it is produced. Data is decompressed in windows
+  of OC_LZVN_CHECKSUM_WINDOW bytes each checksummed while still in cache.
+
+  @param[out]  Dst         Destination buffer.
+  @param[in]   DstLen      Destination buffer size.
+  @param[in]   Src         Source buffer.
+  @param[in]   SrcLen      Source buffer size.
+  @param[out]  Checksum    Adler-32 checksum of decompressed data.
+
+  @return  DecompressedLen on success otherwise 0.
+**/
+UINTN
+DecompressLZVNWithChecksum (
+  OUT UINT8        *Dst,
+  IN  UINTN        DstLen,
+  IN  CONST UINT8  *Src,
+  IN  UINTN        SrcLen,
+  OUT UINT32       *Checksum
+  );
+
+/**
+  Update Adler-32 checksum with buffer data.
+
+  @param[in]   Adler       Current checksum, 1 for no data.
+  @param[in]   Buffer      Data buffer.
+  @param[in]   Length      Data buffer size.
+
+  @return  Updated checksum.
+**/
+UINT32
+Adler32Update (
+  IN UINT32       Adler,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  );
+
 /**
   Compress buffer with ZLIB algorithm.
 
@@ -202,6 +202,14 @@
   OC_ARRAY (OC_KERNEL_BLOCK_ENTRY, _, __)
   OC_DECLARE (OC_KERNEL_BLOCK_ARRAY)
 
+///
+/// Prelinked kernel cache preferences.
+///
+#define OC_KERNEL_CACHE_FIELDS(_,__) \
+  _(BOOLEAN                     , Enabled          ,     , FALSE                                        , () ) \
+  _(BOOLEAN                     , Update           ,     , FALSE                                        , () )
+  OC_DECLARE (OC_KERNEL_CACHE)
+
 ///
 /// Kernel emulation preferences.
 ///
@@ -257,6 +265,7 @@
 #define OC_KERNEL_CONFIG_FIELDS(_, __) \
   _(OC_KERNEL_ADD_ARRAY         , Add              ,     , OC_CONSTR2 (OC_KERNEL_ADD_ARRAY, _, __)     , OC_DESTR (OC_KERNEL_ADD_ARRAY)) \
   _(OC_KERNEL_BLOCK_ARRAY       , Block            ,     , OC_CONSTR2 (OC_KERNEL_BLOCK_ARRAY, _, __)   , OC_DESTR (OC_KERNEL_BLOCK_ARRAY)) \
+  _(OC_KERNEL_CACHE             , Cache            ,     , OC_CONSTR2 (OC_KERNEL_CACHE, _, __)         , OC_DESTR (OC_KERNEL_CACHE)) \
   _(OC_KERNEL_EMULATE           , Emulate          ,     , OC_CONSTR2 (OC_KERNEL_EMULATE, _, __)       , OC_DESTR (OC_KERNEL_EMULATE)) \
   _(OC_KERNEL_PATCH_ARRAY       , Patch            ,     , OC_CONSTR2 (OC_KERNEL_PATCH_ARRAY, _, __)   , OC_DESTR (OC_KERNEL_PATCH_ARRAY)) \
   _(OC_KERNEL_QUIRKS            , Quirks           ,     , OC_CONSTR2 (OC_KERNEL_QUIRKS, _, __)        , OC_DESTR (OC_KERNEL_QUIRKS))
@@ -126,6 +126,15 @@ typedef struct SHA512_CONTEXT_ {
 
 typedef SHA512_CONTEXT SHA384_CONTEXT;
 
+//
+// SHA-2 block function implementations.
+//
+typedef enum {
+  OcSha2ImplementationGeneric,
+  OcSha2ImplementationAvx2,
+  OcSha2ImplementationShaNi
+} OC_SHA2_IMPLEMENTATION;
+
 #pragma pack(push, 1)
 
 ///
@@ -160,6 +169,29 @@ typedef PACKED struct {
 
 #pragma pack(pop)
 
+///
+/// The structure describing an RSA Public Key pre-processed at runtime.
+/// Unlike OC_RSA_PUBLIC_KEY, it uses native words and an arbitrary exponent.
+///
+typedef struct {
+  ///
+  /// The number of native words of N and RSqrMod each.
+  ///
+  UINT16 NumWords;
+  ///
+  /// The RSA exponent.
+  ///
+  UINT32 Exponent;
+  ///
+  /// The Montgomery Inverse in native word space: -1 / N[0] mod 2^#Bits(UINTN).
+  ///
+  UINTN  N0Inv;
+  ///
+  /// The Modulus and Montgomery's R^2 mod N in little endian native words.
+  ///
+  UINTN  Data[];
+} OC_RSA_PROCESSED_KEY;
+
 //
 // Functions prototypes
 //
@@ -294,6 +326,21 @@ Sha1 (
   UINTN  Len
   );
 
+/**
+  Select SHA-2 block function implementation.
+  By default the fastest implementation supported by the CPU is selected on first use.
+  Unsupported implementations fall back to AVX2 and then to generic code.
+  SHA-512 has no SHA extensions implementation and uses AVX2 unless generic code is requested.
+
+  @param[in] Implementation  Preferred SHA-256 implementation.
+
+  @retval SHA-256 implementation in use.
+**/
+OC_SHA2_IMPLEMENTATION
+OcSha2SetImplementation (
+  IN OC_SHA2_IMPLEMENTATION  Implementation
+  );
+
 VOID
 Sha256Init (
   SHA256_CONTEXT  *Context
@@ -415,10 +462,77 @@ RsaVerifySigHashFromKey (
   IN OC_SIG_HASH_TYPE         Algorithm
   );
 
+/**
+  Pre-process an RSA Public Key for repeated signature verification.
+  The modulus' size must be a multiple of the configured BIGNUM word size.
+
+  @param[in] Modulus      The RSA modulus byte array in big endian byte order.
+  @param[in] ModulusSize  The size, in bytes, of Modulus.
+  @param[in] Exponent     The RSA exponent, must be odd and at least 3.
+
+  @returns  Allocated pre-processed key to be freed with FreePool, or NULL.
+
+**/
+OC_RSA_PROCESSED_KEY *
+RsaProcessPublicKey (
+  IN CONST UINT8  *Modulus,
+  IN UINTN        ModulusSize,
+  IN UINT32       Exponent
+  );
+
+/**
+  Verify a RSA PKCS1.5 signature against an expected hash.
+
+  @param[in] Key            The pre-processed RSA Public Key.
+  @param[in] Signature      The RSA signature to be verified.
+  @param[in] SignatureSize  Size, in bytes, of Signature.
+  @param[in] Hash           The Hash digest of the signed data.
+  @param[in] HashSize       Size, in bytes, of Hash.
+  @param[in] Algorithm      The RSA algorithm used.
+
+  @returns  Whether the signature has been successfully verified as valid.
+
+**/
+BOOLEAN
+RsaVerifySigHashFromProcessedKey (
+  IN CONST OC_RSA_PROCESSED_KEY  *Key,
+  IN CONST UINT8                 *Signature,
+  IN UINTN                       SignatureSize,
+  IN CONST UINT8                 *Hash,
+  IN UINTN                       HashSize,
+  IN OC_SIG_HASH_TYPE            Algorithm
+  );
+
+/**
+  Verify RSA PKCS1.5 signed data against its signature.
+
+  @param[in] Key            The pre-processed RSA Public Key.
+  @param[in] Signature      The RSA signature to be verified.
+  @param[in] SignatureSize  Size, in bytes, of Signature.
+  @param[in] Data           The signed data to verify.
+  @param[in] DataSize       Size, in bytes, of Data.
+  @param[in] Algorithm      The RSA algorithm used.
+
+  @returns  Whether the signature has been successfully verified as valid.
+
+**/
+BOOLEAN
+RsaVerifySigDataFromProcessedKey (
+  IN CONST OC_RSA_PROCESSED_KEY  *Key,
+  IN CONST UINT8                 *Signature,
+  IN UINTN                       SignatureSize,
+  IN CONST UINT8                 *Data,
+  IN UINTN                       DataSize,
+  IN OC_SIG_HASH_TYPE            Algorithm
+  );
+
 /**
   Verify RSA PKCS1.5 signed data against its signature.
   The modulus' size must be a multiple of the configured BIGNUM word size.
   This will be true for any conventional RSA, which use two's potencies.
+  Pre-processed keys of recently used moduli are cached, so that verifying
+  certificate chains does not recompute Montgomery parameters. The cache
+  holds a fixed number of keys, which are kept until RsaFreeKeyCache is called.
 
   @param[in] Modulus        The RSA modulus byte array.
   @param[in] ModulusSize    The size, in bytes, of Modulus.
@@ -444,6 +558,15 @@ RsaVerifySigDataFromData (
   IN OC_SIG_HASH_TYPE  Algorithm
   );
 
+/**
+  Free pre-processed keys cached by RsaVerifySigDataFromData.
+  The cache is refilled on the next call to RsaVerifySigDataFromData.
+**/
+VOID
+RsaFreeKeyCache (
+  VOID
+  );
+
 /**
   Verify RSA PKCS1.5 signed data against its signature.
   The modulus' size must be a multiple of the configured BIGNUM word size.
@@ -51,6 +51,14 @@
 #error "Define target macro: OC_TARGET_<TARGET>!"
 #endif
 
+/**
+  Boot phase timing span, see OcLogSpanBegin.
+**/
+typedef struct {
+  CONST CHAR8  *Name;
+  UINT64       StartTsc;
+} OC_LOG_SPAN;
+
 /**
   Install or update the OcLog protocol with specified options.
 
@@ -170,4 +178,39 @@ DebugPrintHexDump (
   IN UINTN                     Size
   );
 
+/**
+  Start measuring boot phase timing span.
+
+  @param[out] Span  Span to start.
+  @param[in]  Name  Span name, must stay valid until the span is ended.
+**/
+VOID
+OcLogSpanBegin (
+  OUT OC_LOG_SPAN  *Span,
+  IN  CONST CHAR8  *Name
+  );
+
+/**
+  Finish measuring boot phase timing span and submit it to OcLog protocol.
+  Spans finished before OcLog protocol is installed are submitted with
+  the first span finished afterwards. Nested spans must be finished
+  before their parents.
+
+  @param[in] Span  Span started with OcLogSpanBegin.
+**/
+VOID
+OcLogSpanEnd (
+  IN CONST OC_LOG_SPAN  *Span
+  );
+
+/**
+  Write pending log contents to configured targets. Log file cannot be
+  written after ExitBootServices, so this must be called before starting
+  the operating system.
+**/
+VOID
+OcLogFlush (
+  VOID
+  );
+
 #endif // OC_DEBUG_LOG_LIB_H
@@ -41,6 +41,17 @@ typedef struct {
   MACH_NLIST_64         *IndirectSymbolTable;
   MACH_RELOCATION_INFO  *LocalRelocations;
   MACH_RELOCATION_INFO  *ExternRelocations;
+  //
+  // Relocation numbers sorted by address, extern ones followed by local.
+  // Built on first relocation lookup, see MachoFreeRelocationIndex.
+  //
+  UINT32                *RelocationIndex;
+  UINT32                NumIndexedExternRelocations;
+  UINT32                NumIndexedLocalRelocations;
+  //
+  // Disables RelocationIndex use, meant for benchmarking only.
+  //
+  BOOLEAN               DisableRelocationIndex;
 } OC_MACHO_CONTEXT;
 
 /**
@@ -60,6 +71,18 @@ MachoInitializeContext (
   IN  UINT32            FileSize
   );
 
+/**
+  Frees relocation index built by relocation lookups. This must be called
+  before the Context is discarded, or when its relocations are modified.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+**/
+VOID
+MachoFreeRelocationIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  );
+
 /**
   Returns the Mach-O Header structure.
 
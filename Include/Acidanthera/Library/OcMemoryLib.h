@@ -126,6 +126,7 @@ OcGetCurrentMemoryMapAlloc (
 
 /**
   Sort memory map entries based upon PhysicalStart, from low to high.
+  Entries with equal PhysicalStart are ordered by NumberOfPages and then by Type.
 
   @param  MemoryMapSize          Size, in bytes, of the MemoryMap buffer.
   @param  MemoryMap              A pointer to the buffer in which firmware places
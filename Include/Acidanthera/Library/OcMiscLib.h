@@ -51,6 +51,71 @@ ApplyPatch (
   IN UINT32        Skip
   );
 
+/**
+  Data patch description for ApplyPatchBatch.
+**/
+typedef struct {
+  //
+  // Find pattern or NULL to write Replace at DataOffset.
+  //
+  CONST UINT8  *Pattern;
+  //
+  // Find pattern mask or NULL.
+  //
+  CONST UINT8  *PatternMask;
+  //
+  // Replace bytes or NULL to ignore this patch.
+  //
+  CONST UINT8  *Replace;
+  //
+  // Replace mask or NULL, ignored without Pattern.
+  //
+  CONST UINT8  *ReplaceMask;
+  //
+  // Pattern and replace size.
+  //
+  UINT32       PatternSize;
+  //
+  // Search window offset in data.
+  //
+  UINT32       DataOffset;
+  //
+  // Search window size.
+  //
+  UINT32       DataSize;
+  //
+  // Replace count or 0 for all.
+  //
+  UINT32       Count;
+  //
+  // Skip count or 0 to start from 1 match.
+  //
+  UINT32       Skip;
+  //
+  // Performed replacement count, set by ApplyPatchBatch.
+  //
+  UINT32       ReplaceCount;
+} PATCH_BATCH_ENTRY;
+
+/**
+  Apply multiple patches in a single pass over the data.
+  The result is identical to calling ApplyPatch for every patch in order,
+  including Count and Skip handling and patches matching data changed
+  by earlier patches.
+
+  @param[in,out] Data        Data to patch.
+  @param[in]     DataSize    Data size.
+  @param[in,out] Patches     Patches to apply, ReplaceCount is updated.
+  @param[in]     PatchCount  Patch count.
+**/
+VOID
+ApplyPatchBatch (
+  IN OUT UINT8              *Data,
+  IN     UINT32             DataSize,
+  IN OUT PATCH_BATCH_ENTRY  *Patches,
+  IN     UINT32             PatchCount
+  );
+
 /**
   Obtain application arguments.
 
@@ -130,6 +195,28 @@ MultThenDivU64x64x32 (
   OUT UINT32  *Remainder  OPTIONAL
   );
 
+/**
+  Initial FNV-1a hash value for Fnv1aUpdate.
+**/
+#define OC_FNV1A_INIT  0x811C9DC5U
+
+/**
+  Update 32-bit FNV-1a hash with buffer data. Used for lookup tables,
+  not suitable for anything security related.
+
+  @param[in]  Hash    Current hash, OC_FNV1A_INIT for no data.
+  @param[in]  Buffer  Data buffer.
+  @param[in]  Length  Data buffer size.
+
+  @return  Updated hash.
+**/
+UINT32
+Fnv1aUpdate (
+  IN UINT32      Hash,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  );
+
 /**
   Internal worker macro that calls DebugPrint().
 
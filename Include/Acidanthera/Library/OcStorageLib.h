@@ -40,6 +40,12 @@
 **/
 #define OC_STORAGE_SAFE_PATH_MAX 128
 
+/**
+  Storage file read block size. Blocks are hashed right after being read,
+  while they are still in cache.
+**/
+#define OC_STORAGE_READ_BLOCK_SIZE BASE_256KB
+
 /**
   Structure declaration for valult file.
 **/
@@ -88,6 +94,15 @@ typedef struct {
   /// Vault status.
   ///
   BOOLEAN                          HasVault;
+  ///
+  /// Open addressing hash table of vault file indices + 1, 0 marks empty slots.
+  /// When NULL, digest lookup walks vault files.
+  ///
+  UINT32                           *VaultIndex;
+  ///
+  /// Vault index size - 1, size is a power of two.
+  ///
+  UINT32                           VaultIndexMask;
 } OC_STORAGE_CONTEXT;
 
 /**
@@ -122,7 +122,7 @@ typedef struct XML_NODE_ XML_NODE;
 // @warning `Buffer` will be referenced by the document, you may not free it
 //     until you free the XML_DOCUMENT
 // @warning You have to call XmlDocumentFree after you finished using the
-//     document
+//     document, all nodes are owned by the document
 // @warning `Buffer` contents are permanently modified during parsing
 //
 // @return The parsed xml fragment iff parsing was successful, 0 otherwise
@@ -134,6 +134,44 @@ XmlDocumentParse (
   BOOLEAN  WithRefs
   );
 
+//
+// Calculates exported document size without writing it anywhere.
+//
+// @param Document XML_DOCUMENT to export
+// @param Length   Resulting length of the export without trailing \0.
+// @param Skip     N root levels before exporting, normally 0.
+//
+// @return TRUE on success, FALSE when the document is too large.
+//
+BOOLEAN
+XmlDocumentExportSize (
+  XML_DOCUMENT  *Document,
+  UINT32        *Length,
+  UINT32        Skip
+  );
+
+//
+// Exports parsed document into caller-provided buffer. The buffer must
+// not overlap with the memory referenced by the document, and it should
+// be at least XmlDocumentExportSize + 1 bytes long.
+//
+// @param Document   XML_DOCUMENT to export
+// @param Buffer     Destination buffer.
+// @param BufferSize Destination buffer size including trailing \0.
+// @param Length     Resulting length of the export without trailing \0 (optional)
+// @param Skip       N root levels before exporting, normally 0.
+//
+// @return TRUE on success, FALSE when the buffer is too small.
+//
+BOOLEAN
+XmlDocumentExportToBuffer (
+  XML_DOCUMENT  *Document,
+  CHAR8         *Buffer,
+  UINT32        BufferSize,
+  UINT32        *Length,
+  UINT32        Skip
+  );
+
 //
 // Exports parsed document into the buffer.
 //
@@ -218,6 +256,7 @@ XmlEasyChild (
 //
 // Append new node to current node.
 //
+// @param  Document    Document owning current node.
 // @param  Node        Current node.
 // @param  Name        Name of the new node.
 // @param  Attributes  Attributes of the new node (optional).
@@ -229,6 +268,7 @@ XmlEasyChild (
 //
 XML_NODE *
 XmlNodeAppend (
+  XML_DOCUMENT *Document,
   XML_NODE     *Node,
   CONST CHAR8  *Name,
   CONST CHAR8  *Attributes,
@@ -241,6 +281,7 @@ XmlNodeAppend (
 //
 XML_NODE *
 XmlNodePrepend (
+  XML_DOCUMENT *Document,
   XML_NODE     *Node,
   CONST CHAR8  *Name,
   CONST CHAR8  *Attributes,
@@ -290,6 +331,22 @@ PlistDictChild (
   XML_NODE     **Value OPTIONAL
   );
 
+//
+// Looks up dictionary value by key. Dictionaries with many keys get
+// a key index on first lookup, which is dropped when children change.
+// The first value is returned for duplicate keys.
+//
+// @param Node  XML_NODE of dict type.
+// @param Key   Key name to look up.
+//
+// @return value XML_NODE or NULL when the key is missing.
+//
+XML_NODE *
+PlistDictLookup (
+  XML_NODE     *Node,
+  CONST CHAR8  *Key
+  );
+
 //
 // @return key value for valid type or NULL.
 //
@@ -57,6 +57,8 @@
 
 #define OPEN_CORE_NVRAM_PATH       L"nvram.plist"
 
+#define OPEN_CORE_KERNEL_CACHE_PATH L"kernelcache.bin"
+
 #define OPEN_CORE_ACPI_PATH        L"ACPI\\"
 
 #define OPEN_CORE_UEFI_DRIVER_PATH L"Drivers\\"
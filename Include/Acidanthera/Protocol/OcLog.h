@@ -21,7 +21,7 @@
 ///
 /// Current supported log protocol revision.
 ///
-#define OC_LOG_REVISION  0x01000A
+#define OC_LOG_REVISION  0x01000B
 
 ///
 /// The defines for the log flags.
@@ -33,6 +33,8 @@
 #define OC_LOG_VARIABLE     BIT4
 #define OC_LOG_NONVOLATILE  BIT5
 #define OC_LOG_FILE         BIT6
+#define OC_LOG_FILE_REWRITE BIT7
+#define OC_LOG_DEFERRED     BIT8
 
 typedef UINT32 OC_LOG_OPTIONS;
 
@@ -102,7 +104,7 @@ EFI_STATUS
   @param[in] NonVolatile  Variable.
   @param[in] FilePath     Filepath to save the log. OPTIONAL
 
-  @retval EFI_SUCCESS  The log was saved successfully.
+  @retval EFI_SUCCESS      The log was saved successfully.
 **/
 typedef
 EFI_STATUS
@@ -112,6 +114,27 @@ EFI_STATUS
   IN EFI_DEVICE_PATH_PROTOCOL  *FilePath OPTIONAL
   );
 
+/**
+  Add a completed timing span. Spans are reported when the log is saved
+  as a summary table in the log and as a trace file next to the log file.
+
+  @param[in] This      This protocol.
+  @param[in] Name      Span name, truncated when long.
+  @param[in] StartTsc  TSC value at span start.
+  @param[in] EndTsc    TSC value at span end.
+
+  @retval EFI_SUCCESS           The span was successfully added.
+  @retval EFI_OUT_OF_RESOURCES  There is no room for more spans.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *OC_LOG_ADD_SPAN) (
+  IN OC_LOG_PROTOCOL  *This,
+  IN CONST CHAR8      *Name,
+  IN UINT64           StartTsc,
+  IN UINT64           EndTsc
+  );
+
 /**
   The structure exposed by the OC_LOG_PROTOCOL.
 **/
@@ -128,6 +151,7 @@ struct OC_LOG_PROTOCOL_ {
   UINTN                   HaltLevel;    ///< The error level causing CPU dead loop.
   EFI_FILE_PROTOCOL       *FileSystem;  ///< Log file system root, not owned.
   CHAR16                  *FilePath;    ///< Log file path.
+  OC_LOG_ADD_SPAN         AddSpan;      ///< A pointer to the AddSpan function.
 };
 
 /// A global variable storing the GUID of the OC_LOG_PROTOCOL.
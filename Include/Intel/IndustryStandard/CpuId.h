@@ -108,6 +108,19 @@
 
 #define CPUID_EXTFEATURE_TSCI    BIT8  ///< TSC Invariant
 
+// The CPUID_LEAF7_FEATURE_XXX values define 32-bit values
+// returned in %ebx to a CPUID request with %eax of 0x07 and %ecx of 0:
+
+#define CPUID_LEAF7_FEATURE_AVX2 BIT5   ///< AVX2 instructions
+#define CPUID_LEAF7_FEATURE_BMI2 BIT8   ///< BMI2 instructions
+#define CPUID_LEAF7_FEATURE_SHA  BIT29  ///< SHA extensions
+
+// The XCR0_XXX values define the state components enabled in XCR0
+// by the OS, as returned by XGETBV with %ecx of 0:
+
+#define XCR0_SSE_STATE           BIT1   ///< XMM registers
+#define XCR0_AVX_STATE           BIT2   ///< Upper halves of YMM registers
+
 // When the EAX register contains a value of 2, the CPUID instruction loads
 // the EAX, EBX, ECX, and EDX registers with descriptors that indicate the
 // processor's cache and TLB characteristics.
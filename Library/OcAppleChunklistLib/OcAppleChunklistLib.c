@@ -139,6 +139,7 @@ OcAppleChunklistVerifyData (
 
   UINT32                      ChunkDataSize;
   VOID                        *ChunkData;
+  OC_APPLE_RAM_DISK_CURSOR    Cursor;
 
   ASSERT (Context != NULL);
   ASSERT (Context->Chunks != NULL);
@@ -161,12 +162,14 @@ OcAppleChunklistVerifyData (
     return FALSE;
   }
 
+  OcAppleRamDiskInitCursor (&Cursor, ExtentTable);
+
   CurrentOffset = 0;
   for (Index = 0; Index < Context->ChunkCount; Index++) {
     CurrentChunk = &Context->Chunks[Index];
 
-    Result = OcAppleRamDiskRead (
-               ExtentTable,
+    Result = OcAppleRamDiskCursorRead (
+               &Cursor,
                CurrentOffset,
                CurrentChunk->Length,
                ChunkData
@@ -192,3 +195,147 @@ OcAppleChunklistVerifyData (
   FreePool (ChunkData);
   return TRUE;
 }
+
+/**
+  Read file data into the load buffer and append it to RAM disk.
+
+  @param[in,out] Cursor       RAM disk cursor.
+  @param[in]     File         File protocol open for reading.
+  @param[in]     Offset       File and RAM disk offset.
+  @param[in]     Size         Amount of data to load, at most BASE_4MB.
+  @param[out]    Buffer       Load buffer of BASE_4MB bytes.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalLoadFileData (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     EFI_FILE_PROTOCOL         *File,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  OUT    UINT8                     *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       ReadSize;
+
+  ASSERT (Size <= BASE_4MB);
+
+  Status = File->SetPosition (File, Offset);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  ReadSize = Size;
+  Status   = File->Read (File, &ReadSize, Buffer);
+  if (EFI_ERROR (Status) || ReadSize != Size) {
+    return FALSE;
+  }
+
+  return OcAppleRamDiskCursorWrite (Cursor, Offset, Size, Buffer);
+}
+
+BOOLEAN
+OcAppleChunklistLoadFile (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     EFI_FILE_PROTOCOL                  *File,
+  IN     UINTN                              FileSize
+  )
+{
+  BOOLEAN                     Result;
+
+  UINTN                       Index;
+  UINT8                       ChunkHash[SHA256_DIGEST_SIZE];
+  CONST APPLE_CHUNKLIST_CHUNK *CurrentChunk;
+  UINTN                       CurrentOffset;
+  UINTN                       ChunkRemaining;
+  UINTN                       LoadSize;
+  SHA256_CONTEXT              Sha256Context;
+  UINT8                       *TmpBuffer;
+  OC_APPLE_RAM_DISK_CURSOR    Cursor;
+
+  ASSERT (Context != NULL);
+  ASSERT (Context->Chunks != NULL);
+  ASSERT (ExtentTable != NULL);
+  ASSERT (File != NULL);
+  ASSERT (FileSize > 0);
+
+  DEBUG_CODE (
+    ASSERT (Context->Signature == NULL);
+    );
+
+  //
+  // Same low memory load buffer as in OcAppleRamDiskLoadFile, see there for details.
+  //
+  TmpBuffer = AllocatePool (BASE_4MB);
+  if (TmpBuffer == NULL) {
+    return FALSE;
+  }
+
+  OcAppleRamDiskInitCursor (&Cursor, ExtentTable);
+
+  CurrentOffset = 0;
+  for (Index = 0; Index < Context->ChunkCount; ++Index) {
+    CurrentChunk = &Context->Chunks[Index];
+    if (CurrentChunk->Length > FileSize - CurrentOffset) {
+      DEBUG ((
+        DEBUG_INFO,
+        "OCCL: Chunk %lu of %lu exceeds file size %lu\n",
+        (UINT64)Index + 1,
+        (UINT64)Context->ChunkCount,
+        (UINT64)FileSize
+        ));
+      FreePool (TmpBuffer);
+      return FALSE;
+    }
+
+    DEBUG ((DEBUG_VERBOSE, "OCCL: Loading chunk %lu of %lu\n",
+      (UINT64)Index + 1, (UINT64)Context->ChunkCount));
+
+    Sha256Init (&Sha256Context);
+
+    ChunkRemaining = CurrentChunk->Length;
+    while (ChunkRemaining > 0) {
+      LoadSize = MIN (ChunkRemaining, BASE_4MB);
+      Result   = InternalLoadFileData (&Cursor, File, CurrentOffset, LoadSize, TmpBuffer);
+      if (!Result) {
+        FreePool (TmpBuffer);
+        return FALSE;
+      }
+
+      Sha256Update (&Sha256Context, TmpBuffer, LoadSize);
+
+      CurrentOffset  += LoadSize;
+      ChunkRemaining -= LoadSize;
+    }
+
+    Sha256Final (&Sha256Context, ChunkHash);
+    if (CompareMem (ChunkHash, CurrentChunk->Checksum, SHA256_DIGEST_SIZE) != 0) {
+      DEBUG ((
+        DEBUG_WARN,
+        "OCCL: Chunk %lu of %lu at %lu has been altered\n",
+        (UINT64)Index + 1,
+        (UINT64)Context->ChunkCount,
+        (UINT64)(CurrentOffset - CurrentChunk->Length)
+        ));
+      FreePool (TmpBuffer);
+      return FALSE;
+    }
+  }
+
+  while (CurrentOffset < FileSize) {
+    LoadSize = MIN (FileSize - CurrentOffset, BASE_4MB);
+    Result   = InternalLoadFileData (&Cursor, File, CurrentOffset, LoadSize, TmpBuffer);
+    if (!Result) {
+      FreePool (TmpBuffer);
+      return FALSE;
+    }
+
+    CurrentOffset += LoadSize;
+  }
+
+  FreePool (TmpBuffer);
+  return TRUE;
+}
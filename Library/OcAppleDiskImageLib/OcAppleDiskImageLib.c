@@ -26,11 +26,192 @@
 
 #include "OcAppleDiskImageLibInternal.h"
 
+STATIC
+VOID
+InternalFreeChunkCache (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  UINT32  Index;
+
+  if (Context->Cache != NULL) {
+    for (Index = 0; Index < Context->CacheCapacity; ++Index) {
+      if (Context->Cache[Index].Data != NULL) {
+        FreePool (Context->Cache[Index].Data);
+      }
+    }
+
+    FreePool (Context->Cache);
+    Context->Cache = NULL;
+  }
+}
+
+/**
+  Decompress chunk into Data.
+
+  @param[in]  Context      Disk image context.
+  @param[in]  Chunk        Compressed chunk.
+  @param[out] Data         Buffer of at least ChunkLength bytes.
+  @param[in]  ChunkLength  Decompressed chunk size.
+
+  @retval TRUE on success.
+**/
+STATIC
 BOOLEAN
-OcAppleDiskImageInitializeContext (
-  OUT OC_APPLE_DISK_IMAGE_CONTEXT        *Context,
-  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
-  IN  UINTN                              FileSize
+InternalDecompressChunk (
+  IN  OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN  CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  OUT UINT8                         *Data,
+  IN  UINTN                         ChunkLength
+  )
+{
+  BOOLEAN  Result;
+  UINT8    *ChunkDataCompressed;
+  UINTN    OutSize;
+
+  ChunkDataCompressed = AllocatePool ((UINTN)Chunk->CompressedLength);
+  if (ChunkDataCompressed == NULL) {
+    return FALSE;
+  }
+
+  Result = OcAppleRamDiskCursorRead (
+             &Context->ExtentCursor,
+             (UINTN)Chunk->CompressedOffset,
+             (UINTN)Chunk->CompressedLength,
+             ChunkDataCompressed
+             );
+  if (Result) {
+    OutSize = DecompressZLIB (
+                Data,
+                ChunkLength,
+                ChunkDataCompressed,
+                (UINTN)Chunk->CompressedLength
+                );
+    Result = OutSize == ChunkLength;
+  }
+
+  FreePool (ChunkDataCompressed);
+  return Result;
+}
+
+/**
+  Get decompressed chunk data from cache, decompressing it on miss.
+  The least recently used entry is replaced on miss.
+
+  @param[in,out] Context      Disk image context with enabled cache.
+  @param[in]     Chunk        Compressed chunk.
+  @param[in]     ChunkLength  Decompressed chunk size.
+
+  @retval Decompressed data owned by the cache or NULL.
+**/
+STATIC
+UINT8 *
+InternalGetCachedChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN     UINTN                         ChunkLength
+  )
+{
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Entry;
+  OC_APPLE_DISK_IMAGE_CACHE_ENTRY  *Victim;
+  UINT32                           Index;
+
+  ASSERT (Context->CacheCapacity > 0);
+
+  if (Context->Cache == NULL) {
+    Context->Cache = AllocateZeroPool (Context->CacheCapacity * sizeof (*Context->Cache));
+    if (Context->Cache == NULL) {
+      return NULL;
+    }
+  }
+
+  ++Context->CacheTick;
+
+  Victim = &Context->Cache[0];
+  for (Index = 0; Index < Context->CacheCapacity; ++Index) {
+    Entry = &Context->Cache[Index];
+    if (Entry->Chunk == Chunk) {
+      ++Context->CacheHits;
+      Entry->LastUse = Context->CacheTick;
+      return Entry->Data;
+    }
+
+    if (Entry->LastUse < Victim->LastUse) {
+      Victim = Entry;
+    }
+  }
+
+  ++Context->CacheMisses;
+
+  Victim->Chunk = NULL;
+  if (Victim->Data != NULL && Victim->DataSize < ChunkLength) {
+    FreePool (Victim->Data);
+    Victim->Data = NULL;
+  }
+
+  if (Victim->Data == NULL) {
+    Victim->Data = AllocatePool (ChunkLength);
+    if (Victim->Data == NULL) {
+      return NULL;
+    }
+
+    Victim->DataSize = ChunkLength;
+  }
+
+  if (!InternalDecompressChunk (Context, Chunk, Victim->Data, ChunkLength)) {
+    return NULL;
+  }
+
+  Victim->Chunk   = Chunk;
+  Victim->LastUse = Context->CacheTick;
+  return Victim->Data;
+}
+
+/**
+  Free image metadata and data derived from it.
+
+  @param[in,out] Context  Disk image context.
+**/
+STATIC
+VOID
+InternalFreeImageMetadata (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  UINT32 Index;
+
+  InternalFreeChunkCache (Context);
+
+  if (Context->ChunkRanges != NULL) {
+    FreePool (Context->ChunkRanges);
+    Context->ChunkRanges     = NULL;
+    Context->ChunkRangeCount = 0;
+  }
+
+  if (Context->Blocks != NULL) {
+    for (Index = 0; Index < Context->BlockCount; ++Index) {
+      FreePool (Context->Blocks[Index]);
+    }
+
+    FreePool (Context->Blocks);
+    Context->Blocks     = NULL;
+    Context->BlockCount = 0;
+  }
+}
+
+/**
+  Parse image trailer and plist read through the context.
+
+  @param[in,out] Context   Disk image context with image data in RAM disk.
+  @param[in]     FileSize  Image file size.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalParseImage (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        FileSize
   )
 {
   BOOLEAN                     Result;
@@ -52,10 +233,6 @@ OcAppleDiskImageInitializeContext (
 
   CHAR8                       *PlistData;
 
-  ASSERT (Context != NULL);
-  ASSERT (ExtentTable != NULL);
-  ASSERT (FileSize > 0);
-
   if (FileSize <= sizeof (Trailer)) {
     DEBUG ((
       DEBUG_INFO,
@@ -70,8 +247,8 @@ OcAppleDiskImageInitializeContext (
 
   TrailerOffset = (FileSize - sizeof (Trailer));
 
-  Result = OcAppleRamDiskRead (
-             ExtentTable,
+  Result = OcAppleRamDiskCursorRead (
+             &Context->ExtentCursor,
              TrailerOffset,
              sizeof (Trailer),
              &Trailer
@@ -155,8 +332,8 @@ OcAppleDiskImageInitializeContext (
     return FALSE;
   }
 
-  Result = OcAppleRamDiskRead (
-             ExtentTable,
+  Result = OcAppleRamDiskCursorRead (
+             &Context->ExtentCursor,
              (UINTN)XmlOffset,
              (UINTN)XmlLength,
              PlistData
@@ -184,18 +361,39 @@ OcAppleDiskImageInitializeContext (
     return FALSE;
   }
 
-  Context->ExtentTable = ExtentTable;
   Context->BlockCount  = DmgBlockCount;
   Context->Blocks      = DmgBlocks;
   Context->SectorCount = (UINTN)SectorCount;
 
+  InternalBuildChunkRanges (Context);
+
   return TRUE;
 }
 
+BOOLEAN
+OcAppleDiskImageInitializeContext (
+  OUT OC_APPLE_DISK_IMAGE_CONTEXT        *Context,
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN  UINTN                              FileSize
+  )
+{
+  ASSERT (Context != NULL);
+  ASSERT (ExtentTable != NULL);
+  ASSERT (FileSize > 0);
+
+  ZeroMem (Context, sizeof (*Context));
+  Context->ExtentTable   = ExtentTable;
+  Context->CacheCapacity = OC_APPLE_DISK_IMAGE_DEFAULT_CACHE_CAPACITY;
+  OcAppleRamDiskInitCursor (&Context->ExtentCursor, ExtentTable);
+
+  return InternalParseImage (Context, FileSize);
+}
+
 BOOLEAN
 OcAppleDiskImageInitializeFromFile (
-  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  EFI_FILE_PROTOCOL            *File
+  OUT    OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     EFI_FILE_PROTOCOL            *File,
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext OPTIONAL
   )
 {
   EFI_STATUS                        Status;
@@ -219,7 +417,12 @@ OcAppleDiskImageInitializeFromFile (
     return FALSE;
   }
 
-  Result = OcAppleRamDiskLoadFile (ExtentTable, File, FileSize);
+  if (ChunklistContext != NULL) {
+    Result = OcAppleChunklistLoadFile (ChunklistContext, ExtentTable, File, FileSize);
+  } else {
+    Result = OcAppleRamDiskLoadFile (ExtentTable, File, FileSize);
+  }
+
   if (!Result) {
     DEBUG ((DEBUG_INFO, "OCDI: Failed to load DMG file\n"));
 
@@ -258,15 +461,16 @@ OcAppleDiskImageFreeContext (
   IN OC_APPLE_DISK_IMAGE_CONTEXT  *Context
   )
 {
-  UINT32 Index;
-
   ASSERT (Context != NULL);
 
-  for (Index = 0; Index < Context->BlockCount; ++Index) {
-    FreePool (Context->Blocks[Index]);
-  }
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "OCDI: Chunk cache had %Lu hits and %Lu misses\n",
+    Context->CacheHits,
+    Context->CacheMisses
+    ));
 
-  FreePool (Context->Blocks);
+  InternalFreeImageMetadata (Context);
 }
 
 VOID
@@ -278,6 +482,18 @@ OcAppleDiskImageFreeFile (
   OcAppleDiskImageFreeContext (Context);
 }
 
+VOID
+OcAppleDiskImageSetCacheCapacity (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       Capacity
+  )
+{
+  ASSERT (Context != NULL);
+
+  InternalFreeChunkCache (Context);
+  Context->CacheCapacity = Capacity;
+}
+
 BOOLEAN
 OcAppleDiskImageRead (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -294,7 +510,6 @@ OcAppleDiskImageRead (
   UINT64                      ChunkLength;
   UINT64                      ChunkOffset;
   UINT8                       *ChunkData;
-  UINT8                       *ChunkDataCompressed;
 
   UINTN                       LbaCurrent;
   UINTN                       LbaOffset;
@@ -303,8 +518,6 @@ OcAppleDiskImageRead (
   UINTN                       BufferChunkSize;
   UINT8                       *BufferCurrent;
 
-  UINTN                       OutSize;
-
   ASSERT (Context != NULL);
   ASSERT (Buffer != NULL);
   ASSERT (Lba < Context->SectorCount);
@@ -354,8 +567,8 @@ OcAppleDiskImageRead (
 
       case APPLE_DISK_IMAGE_CHUNK_TYPE_RAW:
       {
-        Result = OcAppleRamDiskRead (
-                   Context->ExtentTable,
+        Result = OcAppleRamDiskCursorRead (
+                   &Context->ExtentCursor,
                    (UINTN)(Chunk->CompressedOffset + ChunkOffset),
                    BufferChunkSize,
                    BufferCurrent
@@ -369,30 +582,23 @@ OcAppleDiskImageRead (
 
       case APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB:
       {
-        ChunkData = AllocatePool ((UINTN)(ChunkTotalLength + Chunk->CompressedLength));
-        if (ChunkData == NULL) {
-          return FALSE;
+        if (Context->CacheCapacity > 0) {
+          ChunkData = InternalGetCachedChunk (Context, Chunk, (UINTN)ChunkTotalLength);
+          if (ChunkData == NULL) {
+            return FALSE;
+          }
+
+          CopyMem (BufferCurrent, (ChunkData + ChunkOffset), BufferChunkSize);
+          break;
         }
 
-        ChunkDataCompressed = (ChunkData + (UINTN)ChunkTotalLength);
-        Result = OcAppleRamDiskRead (
-                   Context->ExtentTable,
-                   (UINTN)Chunk->CompressedOffset,
-                   (UINTN)Chunk->CompressedLength,
-                   ChunkDataCompressed
-                   );
-        if (!Result) {
-          FreePool (ChunkData);
+        ChunkData = AllocatePool ((UINTN)ChunkTotalLength);
+        if (ChunkData == NULL) {
           return FALSE;
         }
 
-        OutSize = DecompressZLIB (
-                    ChunkData,
-                    (UINTN)ChunkTotalLength,
-                    ChunkDataCompressed,
-                    (UINTN)Chunk->CompressedLength
-                    );
-        if (OutSize != (UINTN)ChunkTotalLength) {
+        Result = InternalDecompressChunk (Context, Chunk, ChunkData, (UINTN)ChunkTotalLength);
+        if (!Result) {
           FreePool (ChunkData);
           return FALSE;
         }
@@ -13,6 +13,7 @@
 #include <Uefi.h>
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleDiskImageLib.h>
@@ -26,7 +27,6 @@ BOOLEAN
 InternalFindPlistDictChild (
   IN  XML_NODE  *Node,
   IN  CHAR8     *KeyName,
-  OUT XML_NODE  **Key,
   OUT XML_NODE  **Value
   )
 {
@@ -38,9 +38,12 @@ InternalFindPlistDictChild (
 
   ASSERT (Node != NULL);
   ASSERT (KeyName != NULL);
-  ASSERT (Key != NULL);
   ASSERT (Value != NULL);
 
+  //
+  // Stop at the first malformed pair rather than skipping it as
+  // PlistDictLookup does, image plists are expected to be well-formed.
+  //
   ChildCount = PlistDictChildren (Node);
   for (Index = 0; Index < ChildCount; ++Index) {
     ChildKey = PlistDictChild (Node, Index, &ChildValue);
@@ -54,7 +57,6 @@ InternalFindPlistDictChild (
     }
 
     if (AsciiStrCmp (ChildKeyName, KeyName) == 0) {
-      *Key   = ChildKey;
       *Value = ChildValue;
       return TRUE;
     }
@@ -175,13 +177,10 @@ InternalParsePlist (
 
   XML_DOCUMENT                *XmlPlistDoc;
   XML_NODE                    *NodeRoot;
-  XML_NODE                    *NodeResourceForkKey;
   XML_NODE                    *NodeResourceForkValue;
-  XML_NODE                    *NodeBlockListKey;
   XML_NODE                    *NodeBlockListValue;
 
   XML_NODE                    *NodeBlockDict;
-  XML_NODE                    *BlockDictChildKey;
   XML_NODE                    *BlockDictChildValue;
   UINT32                      BlockDictChildDataSize;
 
@@ -216,7 +215,6 @@ InternalParsePlist (
   Result = InternalFindPlistDictChild (
              NodeRoot,
              DMG_PLIST_RESOURCE_FORK_KEY,
-             &NodeResourceForkKey,
              &NodeResourceForkValue
              );
   if (!Result) {
@@ -226,7 +224,6 @@ InternalParsePlist (
   Result = InternalFindPlistDictChild (
              NodeResourceForkValue,
              DMG_PLIST_BLOCK_LIST_KEY,
-             &NodeBlockListKey,
              &NodeBlockListValue
              );
   if (!Result) {
@@ -256,7 +253,6 @@ InternalParsePlist (
     Result = InternalFindPlistDictChild (
                NodeBlockDict,
                DMG_PLIST_DATA,
-               &BlockDictChildKey,
                &BlockDictChildValue
                );
     if (!Result) {
@@ -320,6 +316,204 @@ DONE_ERROR:
   return Result;
 }
 
+STATIC
+VOID
+InternalSiftDownChunkRanges (
+  IN OUT OC_APPLE_DISK_IMAGE_CHUNK_RANGE  *Ranges,
+  IN     UINT32                           Root,
+  IN     UINT32                           Count
+  )
+{
+  UINT32                           Child;
+  OC_APPLE_DISK_IMAGE_CHUNK_RANGE  Temp;
+
+  while (Root < Count / 2) {
+    Child = 2 * Root + 1;
+    if (Child + 1 < Count
+      && Ranges[Child].SectorStart < Ranges[Child + 1].SectorStart) {
+      ++Child;
+    }
+
+    if (Ranges[Root].SectorStart >= Ranges[Child].SectorStart) {
+      return;
+    }
+
+    CopyMem (&Temp, &Ranges[Root], sizeof (Temp));
+    CopyMem (&Ranges[Root], &Ranges[Child], sizeof (Temp));
+    CopyMem (&Ranges[Child], &Temp, sizeof (Temp));
+    Root = Child;
+  }
+}
+
+/**
+  Build sector sorted chunk ranges for InternalGetBlockChunk.
+  Ranges are optional and are not built when memory is not available
+  or when chunks overlap, as the lookup result would be ambiguous.
+
+  @param[in,out] Context  Disk image context with parsed blocks.
+**/
+VOID
+InternalBuildChunkRanges (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  OC_APPLE_DISK_IMAGE_CHUNK_RANGE  *Ranges;
+  OC_APPLE_DISK_IMAGE_CHUNK_RANGE  Temp;
+  APPLE_DISK_IMAGE_BLOCK_DATA      *BlockData;
+  APPLE_DISK_IMAGE_CHUNK           *Chunk;
+  UINT32                           BlockIndex;
+  UINT32                           ChunkIndex;
+  UINT32                           Count;
+  UINT32                           Index;
+  UINT32                           RangesSize;
+  UINT64                           SectorStart;
+  UINT64                           SectorEnd;
+  BOOLEAN                          Sorted;
+
+  Context->ChunkRanges      = NULL;
+  Context->ChunkRangeCount  = 0;
+  Context->ChunkRangeCursor = 0;
+
+  Count = 0;
+  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    if (OcOverflowAddU32 (Count, Context->Blocks[BlockIndex]->ChunkCount, &Count)) {
+      return;
+    }
+  }
+
+  if (Count == 0
+    || OcOverflowMulU32 (Count, sizeof (*Ranges), &RangesSize)) {
+    return;
+  }
+
+  Ranges = AllocatePool (RangesSize);
+  if (Ranges == NULL) {
+    return;
+  }
+
+  Count  = 0;
+  Sorted = TRUE;
+
+  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    BlockData = Context->Blocks[BlockIndex];
+
+    for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
+      Chunk = &BlockData->Chunks[ChunkIndex];
+
+      //
+      // Chunk sectors are verified not to overflow at plist parsing.
+      //
+      SectorStart = MAX (BlockData->SectorNumber, DMG_SECTOR_START_ABS (BlockData, Chunk));
+      SectorEnd   = MIN (
+                      BlockData->SectorNumber + BlockData->SectorCount,
+                      DMG_SECTOR_START_ABS (BlockData, Chunk) + Chunk->SectorCount
+                      );
+      if (SectorStart >= SectorEnd) {
+        continue;
+      }
+
+      if (Count > 0 && Ranges[Count - 1].SectorStart > SectorStart) {
+        Sorted = FALSE;
+      }
+
+      Ranges[Count].SectorStart = SectorStart;
+      Ranges[Count].SectorEnd   = SectorEnd;
+      Ranges[Count].BlockData   = BlockData;
+      Ranges[Count].Chunk       = Chunk;
+      ++Count;
+    }
+  }
+
+  if (!Sorted) {
+    for (Index = Count / 2; Index > 0; --Index) {
+      InternalSiftDownChunkRanges (Ranges, Index - 1, Count);
+    }
+
+    for (Index = Count; Index > 1; --Index) {
+      CopyMem (&Temp, &Ranges[0], sizeof (Temp));
+      CopyMem (&Ranges[0], &Ranges[Index - 1], sizeof (Temp));
+      CopyMem (&Ranges[Index - 1], &Temp, sizeof (Temp));
+      InternalSiftDownChunkRanges (Ranges, 0, Index - 1);
+    }
+  }
+
+  for (Index = 1; Index < Count; ++Index) {
+    if (Ranges[Index - 1].SectorEnd > Ranges[Index].SectorStart) {
+      DEBUG ((DEBUG_INFO, "OCDI: DMG chunks overlap at sector %Lu\n", Ranges[Index].SectorStart));
+      FreePool (Ranges);
+      return;
+    }
+  }
+
+  if (Count == 0) {
+    FreePool (Ranges);
+    return;
+  }
+
+  Context->ChunkRanges     = Ranges;
+  Context->ChunkRangeCount = Count;
+}
+
+/**
+  Find chunk range containing Lba, trying ranges at and after the
+  cursor first to make sequential reads constant time.
+
+  @param[in,out] Context  Disk image context with chunk ranges.
+  @param[in]     Lba      Sector to look up.
+
+  @retval Chunk range or NULL.
+**/
+STATIC
+OC_APPLE_DISK_IMAGE_CHUNK_RANGE *
+InternalFindChunkRange (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Lba
+  )
+{
+  OC_APPLE_DISK_IMAGE_CHUNK_RANGE  *Ranges;
+  UINT32                           Cursor;
+  UINT32                           Low;
+  UINT32                           High;
+  UINT32                           Middle;
+
+  Ranges = Context->ChunkRanges;
+  Cursor = Context->ChunkRangeCursor;
+
+  if (Lba >= Ranges[Cursor].SectorStart) {
+    if (Lba < Ranges[Cursor].SectorEnd) {
+      return &Ranges[Cursor];
+    }
+
+    if (Cursor + 1 < Context->ChunkRangeCount
+      && Lba >= Ranges[Cursor + 1].SectorStart
+      && Lba < Ranges[Cursor + 1].SectorEnd) {
+      Context->ChunkRangeCursor = Cursor + 1;
+      return &Ranges[Cursor + 1];
+    }
+  }
+
+  //
+  // Find the last range starting at or before Lba.
+  //
+  Low  = 0;
+  High = Context->ChunkRangeCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Ranges[Middle].SectorStart <= Lba) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if (Low == 0 || Lba >= Ranges[Low - 1].SectorEnd) {
+    return NULL;
+  }
+
+  Context->ChunkRangeCursor = Low - 1;
+  return &Ranges[Low - 1];
+}
+
 BOOLEAN
 InternalGetBlockChunk (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -328,10 +522,22 @@ InternalGetBlockChunk (
   OUT APPLE_DISK_IMAGE_CHUNK       **Chunk
   )
 {
-  UINT32                      BlockIndex;
-  UINT32                      ChunkIndex;
-  APPLE_DISK_IMAGE_BLOCK_DATA *BlockData;
-  APPLE_DISK_IMAGE_CHUNK      *BlockChunk;
+  UINT32                          BlockIndex;
+  UINT32                          ChunkIndex;
+  APPLE_DISK_IMAGE_BLOCK_DATA     *BlockData;
+  APPLE_DISK_IMAGE_CHUNK          *BlockChunk;
+  OC_APPLE_DISK_IMAGE_CHUNK_RANGE *Range;
+
+  if (Context->ChunkRanges != NULL) {
+    Range = InternalFindChunkRange (Context, Lba);
+    if (Range == NULL) {
+      return FALSE;
+    }
+
+    *Data  = Range->BlockData;
+    *Chunk = Range->Chunk;
+    return TRUE;
+  }
 
   for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
     BlockData = Context->Blocks[BlockIndex];
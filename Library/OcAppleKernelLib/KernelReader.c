@@ -142,6 +142,7 @@ ParseCompressedHeader (
   UINT32            CompressedSize;
   UINT32            DecompressedSize;
   UINT32            DecompressedHash;
+  UINT32            Checksum;
 
   CompHeader       = (MACH_COMP_HEADER *)*Buffer;
   CompressionType  = CompHeader->Compression;
@@ -178,21 +179,23 @@ ParseCompressedHeader (
     return KernelSize;
   }
 
+  //
+  // Checksum is calculated during decompression to avoid another pass over the kernel.
+  //
+  Checksum = 0;
   if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZVN) {
-    KernelSize = (UINT32)DecompressLZVN (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize);
+    KernelSize = (UINT32)DecompressLZVNWithChecksum (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize, &Checksum);
   } else if (CompressionType == MACH_COMPRESSED_BINARY_INVERT_LZSS) {
-    KernelSize = (UINT32)DecompressLZSS (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize);
+    KernelSize = (UINT32)DecompressLZSSWithChecksum (*Buffer, DecompressedSize, CompressedBuffer, CompressedSize, &Checksum);
   }
 
   if (KernelSize != DecompressedSize) {
     KernelSize = 0;
+  } else if (Checksum != DecompressedHash) {
+    DEBUG ((DEBUG_WARN, "OCAK: Comp kernel adler32 %08X mismatches %08X at %08X\n", Checksum, DecompressedHash, Offset));
+    KernelSize = 0;
   }
 
-  //
-  // TODO: implement adler32 hash verification.
-  //
-  (VOID) DecompressedHash;
-
   FreePool (CompressedBuffer);
 
   return KernelSize;
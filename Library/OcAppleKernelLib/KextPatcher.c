@@ -19,6 +19,7 @@
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleKernelLib.h>
 #include <Library/OcMachoLib.h>
 #include <Library/OcMiscLib.h>
@@ -118,21 +119,31 @@ PatcherGetSymbolAddress (
   return EFI_SUCCESS;
 }
 
+/**
+  Resolve generic patch lookup window.
+
+  @param[in,out] Context  Patcher context.
+  @param[in]     Patch    Patch description.
+  @param[out]    Base     Window start.
+  @param[out]    Size     Window size, not limited by Patch->Limit.
+
+  @return  EFI_SUCCESS on success.
+**/
+STATIC
 EFI_STATUS
-PatcherApplyGenericPatch (
+PatcherGetPatchWindow (
   IN OUT PATCHER_CONTEXT        *Context,
-  IN     PATCHER_GENERIC_PATCH  *Patch
+  IN     PATCHER_GENERIC_PATCH  *Patch,
+     OUT UINT8                  **Base,
+     OUT UINT32                 *Size
   )
 {
   EFI_STATUS     Status;
-  UINT8          *Base;
-  UINT32         Size;
-  UINT32         ReplaceCount;
 
-  Base = (UINT8 *)MachoGetMachHeader64 (&Context->MachContext);
-  Size = MachoGetFileSize (&Context->MachContext);
+  *Base = (UINT8 *)MachoGetMachHeader64 (&Context->MachContext);
+  *Size = MachoGetFileSize (&Context->MachContext);
   if (Patch->Base != NULL) {
-    Status = PatcherGetSymbolAddress (Context, Patch->Base, &Base);
+    Status = PatcherGetSymbolAddress (Context, Patch->Base, Base);
     if (EFI_ERROR (Status)) {
       DEBUG ((
         DEBUG_INFO,
@@ -143,38 +154,36 @@ PatcherApplyGenericPatch (
       return Status;
     }
 
-    Size -= (UINT32)(Base - (UINT8 *)MachoGetMachHeader64 (&Context->MachContext));
+    *Size -= (UINT32)(*Base - (UINT8 *)MachoGetMachHeader64 (&Context->MachContext));
   }
 
-  if (Patch->Find == NULL) {
-    if (Size < Patch->Size) {
-      DEBUG ((
-        DEBUG_INFO,
-        "OCAK: %a is borked, not found\n",
-        Patch->Comment != NULL ? Patch->Comment : "Patch"
-        ));
-      return EFI_NOT_FOUND;
-    }
-    CopyMem (Base, Patch->Replace, Patch->Size);
-    return EFI_SUCCESS;
+  if (Patch->Find == NULL && *Size < Patch->Size) {
+    DEBUG ((
+      DEBUG_INFO,
+      "OCAK: %a is borked, not found\n",
+      Patch->Comment != NULL ? Patch->Comment : "Patch"
+      ));
+    return EFI_NOT_FOUND;
   }
 
-  if (Patch->Limit > 0 && Patch->Limit < Size) {
-    Size = Patch->Limit;
-  }
+  return EFI_SUCCESS;
+}
 
-  ReplaceCount = ApplyPatch (
-    Patch->Find,
-    Patch->Mask,
-    Patch->Size,
-    Patch->Replace,
-    Patch->ReplaceMask,
-    Base,
-    Size,
-    Patch->Count,
-    Patch->Skip
-    );
+/**
+  Report generic patch replace count.
 
+  @param[in] Patch         Patch description.
+  @param[in] ReplaceCount  Performed replacements.
+
+  @return  EFI_SUCCESS when anything was replaced.
+**/
+STATIC
+EFI_STATUS
+PatcherReportReplaceCount (
+  IN PATCHER_GENERIC_PATCH  *Patch,
+  IN UINT32                 ReplaceCount
+  )
+{
   DEBUG ((
     DEBUG_INFO,
     "OCAK: %a replace count - %u\n",
@@ -199,6 +208,102 @@ PatcherApplyGenericPatch (
   return EFI_NOT_FOUND;
 }
 
+EFI_STATUS
+PatcherApplyGenericPatch (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patch
+  )
+{
+  EFI_STATUS     Status;
+  UINT8          *Base;
+  UINT32         Size;
+  UINT32         ReplaceCount;
+
+  Status = PatcherGetPatchWindow (Context, Patch, &Base, &Size);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Patch->Find == NULL) {
+    CopyMem (Base, Patch->Replace, Patch->Size);
+    return EFI_SUCCESS;
+  }
+
+  if (Patch->Limit > 0 && Patch->Limit < Size) {
+    Size = Patch->Limit;
+  }
+
+  ReplaceCount = ApplyPatch (
+    Patch->Find,
+    Patch->Mask,
+    Patch->Size,
+    Patch->Replace,
+    Patch->ReplaceMask,
+    Base,
+    Size,
+    Patch->Count,
+    Patch->Skip
+    );
+
+  return PatcherReportReplaceCount (Patch, ReplaceCount);
+}
+
+VOID
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 PatchCount,
+     OUT EFI_STATUS             *Results
+  )
+{
+  PATCH_BATCH_ENTRY  *Entries;
+  UINT8              *Header;
+  UINT8              *Base;
+  UINT32             Size;
+  UINT32             Index;
+
+  Entries = AllocateZeroPool (PatchCount * sizeof (*Entries));
+  if (Entries == NULL) {
+    for (Index = 0; Index < PatchCount; ++Index) {
+      Results[Index] = PatcherApplyGenericPatch (Context, &Patches[Index]);
+    }
+    return;
+  }
+
+  Header = (UINT8 *)MachoGetMachHeader64 (&Context->MachContext);
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Results[Index] = PatcherGetPatchWindow (Context, &Patches[Index], &Base, &Size);
+    if (EFI_ERROR (Results[Index])) {
+      continue;
+    }
+
+    if (Patches[Index].Find != NULL && Patches[Index].Limit > 0 && Patches[Index].Limit < Size) {
+      Size = Patches[Index].Limit;
+    }
+
+    Entries[Index].Pattern     = Patches[Index].Find;
+    Entries[Index].PatternMask = Patches[Index].Mask;
+    Entries[Index].Replace     = Patches[Index].Replace;
+    Entries[Index].ReplaceMask = Patches[Index].ReplaceMask;
+    Entries[Index].PatternSize = Patches[Index].Size;
+    Entries[Index].DataOffset  = (UINT32)(Base - Header);
+    Entries[Index].DataSize    = Size;
+    Entries[Index].Count       = Patches[Index].Count;
+    Entries[Index].Skip        = Patches[Index].Skip;
+  }
+
+  ApplyPatchBatch (Header, MachoGetFileSize (&Context->MachContext), Entries, PatchCount);
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    if (!EFI_ERROR (Results[Index]) && Patches[Index].Find != NULL) {
+      Results[Index] = PatcherReportReplaceCount (&Patches[Index], Entries[Index].ReplaceCount);
+    }
+  }
+
+  FreePool (Entries);
+}
+
 EFI_STATUS
 PatcherBlockKext (
   IN OUT PATCHER_CONTEXT        *Context
@@ -24,6 +24,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/OcAppleKernelLib.h>
 #include <Library/OcGuardLib.h>
 #include <Library/OcMachoLib.h>
+#include <Library/OcMiscLib.h>
 
 #include "PrelinkedInternal.h"
 
@@ -34,12 +35,63 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 // Symbols
 //
 
+UINT32
+InternalGetSymbolNameHash (
+  IN CONST CHAR8  *Name,
+  IN UINT32       Length
+  )
+{
+  //
+  // Mangled C++ names have long common prefixes, so hash every byte.
+  //
+  return Fnv1aUpdate (OC_FNV1A_INIT, Name, Length);
+}
+
+STATIC
+CONST PRELINKED_KEXT_SYMBOL *
+InternalOcGetSymbolWorkerIndexedName (
+  IN PRELINKED_KEXT                   *Kext,
+  IN CONST CHAR8                      *LookupValue,
+  IN UINT32                           LookupValueLength,
+  IN UINT32                           LookupValueHash,
+  IN OC_GET_SYMBOL_LEVEL              SymbolLevel
+  )
+{
+  CONST PRELINKED_KEXT_SYMBOL *Symbol;
+  UINT32                      Slot;
+  UINT32                      SymbolIndex;
+  UINT32                      CxxIndex;
+
+  CxxIndex = Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols;
+
+  //
+  // Slots are filled in LinkedSymbolTable order, so the first match along
+  // the probe sequence is the same symbol a linear scan would find.
+  //
+  Slot = LookupValueHash & Kext->LinkedSymbolIndexMask;
+  while (Kext->LinkedSymbolIndex[Slot] != 0) {
+    SymbolIndex = Kext->LinkedSymbolIndex[Slot] - 1;
+    Symbol      = &Kext->LinkedSymbolTable[SymbolIndex];
+
+    if (Symbol->Length == LookupValueLength
+      && (SymbolLevel != OcGetSymbolOnlyCxx || SymbolIndex >= CxxIndex)
+      && CompareMem (Symbol->Name, LookupValue, LookupValueLength) == 0) {
+      return Symbol;
+    }
+
+    Slot = (Slot + 1) & Kext->LinkedSymbolIndexMask;
+  }
+
+  return NULL;
+}
+
 STATIC
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolWorkerName (
   IN PRELINKED_KEXT                   *Kext,
   IN CONST CHAR8                      *LookupValue,
   IN UINT32                           LookupValueLength,
+  IN UINT32                           LookupValueHash,
   IN OC_GET_SYMBOL_LEVEL              SymbolLevel
   )
 {
@@ -54,7 +106,18 @@ InternalOcGetSymbolWorkerName (
   //
   Kext->Processed = TRUE;
 
-  if (Kext->LinkedSymbolTable != NULL) {
+  if (Kext->LinkedSymbolIndex != NULL) {
+    Symbols = InternalOcGetSymbolWorkerIndexedName (
+                Kext,
+                LookupValue,
+                LookupValueLength,
+                LookupValueHash,
+                SymbolLevel
+                );
+    if (Symbols != NULL) {
+      return Symbols;
+    }
+  } else if (Kext->LinkedSymbolTable != NULL) {
     NumSymbols = Kext->NumberOfSymbols;
     Symbols    = Kext->LinkedSymbolTable;
 
@@ -102,6 +165,7 @@ InternalOcGetSymbolWorkerName (
                  Dependency,
                  LookupValue,
                  LookupValueLength,
+                 LookupValueHash,
                  OcGetSymbolOnlyCxx
                  );
       if (Symbols != NULL) {
@@ -113,6 +177,43 @@ InternalOcGetSymbolWorkerName (
   return NULL;
 }
 
+STATIC
+CONST PRELINKED_KEXT_SYMBOL *
+InternalOcGetSymbolWorkerIndexedValue (
+  IN PRELINKED_KEXT                   *Kext,
+  IN UINT64                           LookupValue
+  )
+{
+  CONST UINT32  *SymbolIndices;
+  UINT32        Low;
+  UINT32        High;
+  UINT32        Middle;
+
+  //
+  // Find the first C++ symbol with the requested value. Equal values are
+  // ordered by LinkedSymbolTable index, which matches the linear scan.
+  //
+  SymbolIndices = Kext->LinkedCxxSymbolsByValue;
+  Low           = 0;
+  High          = Kext->NumberOfCxxSymbols;
+
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Kext->LinkedSymbolTable[SymbolIndices[Middle]].Value < LookupValue) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if (Low < Kext->NumberOfCxxSymbols
+    && Kext->LinkedSymbolTable[SymbolIndices[Low]].Value == LookupValue) {
+    return &Kext->LinkedSymbolTable[SymbolIndices[Low]];
+  }
+
+  return NULL;
+}
+
 STATIC
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolWorkerValue (
@@ -132,7 +233,12 @@ InternalOcGetSymbolWorkerValue (
   //
   Kext->Processed = TRUE;
 
-  if (Kext->LinkedSymbolTable != NULL) {
+  if (SymbolLevel == OcGetSymbolOnlyCxx && Kext->LinkedCxxSymbolsByValue != NULL) {
+    Symbols = InternalOcGetSymbolWorkerIndexedValue (Kext, LookupValue);
+    if (Symbols != NULL) {
+      return Symbols;
+    }
+  } else if (Kext->LinkedSymbolTable != NULL) {
     NumSymbols = Kext->NumberOfSymbols;
     Symbols    = Kext->LinkedSymbolTable;
 
@@ -195,6 +301,7 @@ InternalOcGetSymbolName (
   PRELINKED_KEXT              *Dependency;
   UINT32                      Index;
   UINT32                      LookupValueLength;
+  UINT32                      LookupValueHash;
 
   Symbol = NULL;
   LookupValueLength = (UINT32)AsciiStrLen (LookupValue);
@@ -206,11 +313,14 @@ InternalOcGetSymbolName (
     return NULL;
   }
 
+  LookupValueHash = InternalGetSymbolNameHash (LookupValue, LookupValueLength);
+
   if ((SymbolLevel == OcGetSymbolOnlyCxx) && (Kext->LinkedSymbolTable != NULL)) {
     Symbol = InternalOcGetSymbolWorkerName (
       Kext,
       LookupValue,
       LookupValueLength,
+      LookupValueHash,
       SymbolLevel
       );
   } else {
@@ -224,6 +334,7 @@ InternalOcGetSymbolName (
                  Dependency,
                  LookupValue,
                  LookupValueLength,
+                 LookupValueHash,
                  SymbolLevel
                  );
       if (Symbol != NULL) {
@@ -1424,6 +1535,10 @@ InternalPrelinkKext64 (
   // Create and patch the KEXT's VTables.
   //
   Result = InternalPatchByVtables64 (Context, Kext);
+  //
+  // Relocations are rewritten below, drop the lookup index built for vtables.
+  //
+  MachoFreeRelocationIndex (MachoContext);
   if (!Result) {
     DEBUG ((DEBUG_INFO, "OCAK: Vtable patching failed for kext %a\n", Kext->Identifier));
     return EFI_LOAD_ERROR;
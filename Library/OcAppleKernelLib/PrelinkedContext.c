@@ -34,10 +34,7 @@ PrelinkedFindLastLoadAddress (
 {
   UINT32       KextCount;
   UINT32       KextIndex;
-  UINT32       FieldIndex;
-  UINT32       FieldCount;
   XML_NODE     *LastKext;
-  CONST CHAR8  *KextPlistKey;
   XML_NODE     *KextPlistValue;
   UINT64       LoadAddress;
   UINT64       LoadSize;
@@ -60,26 +57,16 @@ PrelinkedFindLastLoadAddress (
     LoadAddress = 0;
     LoadSize = 0;
 
-    FieldCount = PlistDictChildren (LastKext);
-    for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
-      KextPlistKey = PlistKeyValue (PlistDictChild (LastKext, FieldIndex, &KextPlistValue));
-      if (KextPlistKey == NULL) {
-        continue;
-      }
-
-      if (LoadAddress == 0 && AsciiStrCmp (KextPlistKey, PRELINK_INFO_EXECUTABLE_LOAD_ADDR_KEY) == 0) {
-        if (!PlistIntegerValue (KextPlistValue, &LoadAddress, sizeof (LoadAddress), TRUE)) {
-          return 0;
-        }
-      } else if (LoadSize == 0 && AsciiStrCmp (KextPlistKey, PRELINK_INFO_EXECUTABLE_SIZE_KEY) == 0) {
-        if (!PlistIntegerValue (KextPlistValue, &LoadSize, sizeof (LoadSize), TRUE)) {
-          return 0;
-        }
-      }
+    KextPlistValue = PlistDictLookup (LastKext, PRELINK_INFO_EXECUTABLE_LOAD_ADDR_KEY);
+    if (KextPlistValue != NULL
+      && !PlistIntegerValue (KextPlistValue, &LoadAddress, sizeof (LoadAddress), TRUE)) {
+      return 0;
+    }
 
-      if (LoadSize != 0 && LoadAddress != 0) {
-        break;
-      }
+    KextPlistValue = PlistDictLookup (LastKext, PRELINK_INFO_EXECUTABLE_SIZE_KEY);
+    if (KextPlistValue != NULL
+      && !PlistIntegerValue (KextPlistValue, &LoadSize, sizeof (LoadSize), TRUE)) {
+      return 0;
     }
 
     if (OcOverflowAddU64 (LoadAddress, LoadSize, &LoadAddress)) {
@@ -154,9 +141,6 @@ PrelinkedContextInit (
   )
 {
   XML_NODE     *PrelinkedInfoRoot;
-  CONST CHAR8  *PrelinkedInfoRootKey;
-  UINT32       PrelinkedInfoRootIndex;
-  UINT32       PrelinkedInfoRootCount;
 
   ASSERT (Context != NULL);
   ASSERT (Prelinked != NULL);
@@ -257,21 +241,18 @@ PrelinkedContextInit (
     return EFI_INVALID_PARAMETER;
   }
 
-  PrelinkedInfoRootCount = PlistDictChildren (PrelinkedInfoRoot);
-  for (PrelinkedInfoRootIndex = 0; PrelinkedInfoRootIndex < PrelinkedInfoRootCount; ++PrelinkedInfoRootIndex) {
-    PrelinkedInfoRootKey = PlistKeyValue (PlistDictChild (PrelinkedInfoRoot, PrelinkedInfoRootIndex, &Context->KextList));
-    if (PrelinkedInfoRootKey == NULL) {
-      continue;
-    }
-
-    if (AsciiStrCmp (PrelinkedInfoRootKey, PRELINK_INFO_DICTIONARY_KEY) == 0) {
-      if (PlistNodeCast (Context->KextList, PLIST_NODE_TYPE_ARRAY) != NULL) {
-        Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context->KextList);
-        if (Context->PrelinkedLastLoadAddress != 0) {
-          return EFI_SUCCESS;
-        }
-      }
-      break;
+  Context->KextList = PlistNodeCast (
+    PlistDictLookup (PrelinkedInfoRoot, PRELINK_INFO_DICTIONARY_KEY),
+    PLIST_NODE_TYPE_ARRAY
+    );
+  if (Context->KextList != NULL) {
+    Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context->KextList);
+    if (Context->PrelinkedLastLoadAddress != 0) {
+      //
+      // Index is optional, lookups fall back to KextList walk without it.
+      //
+      InternalBuildPrelinkedKextIndex (Context);
+      return EFI_SUCCESS;
     }
   }
 
@@ -306,6 +287,11 @@ PrelinkedContextFree (
     Context->PooledBuffers = NULL;
   }
 
+  if (Context->KextIndex != NULL) {
+    FreePool (Context->KextIndex);
+    Context->KextIndex = NULL;
+  }
+
   if (Context->LinkBuffer != NULL) {
     ZeroMem (Context->LinkBuffer, Context->LinkBufferSize);
     FreePool (Context->LinkBuffer);
@@ -408,12 +394,15 @@ PrelinkedInjectComplete (
   IN OUT PRELINKED_CONTEXT  *Context
   )
 {
-  CHAR8       *ExportedInfo;
   UINT32      ExportedInfoSize;
   UINT32      NewSize;
 
-  ExportedInfo = XmlDocumentExport (Context->PrelinkedInfoDocument, &ExportedInfoSize, 0);
-  if (ExportedInfo == NULL) {
+  //
+  // Export straight into the prelinked image after measuring the plist.
+  // The document references its own copy of __PRELINK_INFO, so the
+  // destination does not overlap with the data being exported.
+  //
+  if (!XmlDocumentExportSize (Context->PrelinkedInfoDocument, &ExportedInfoSize, 0)) {
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -424,10 +413,19 @@ PrelinkedInjectComplete (
 
   if (OcOverflowAddU32 (Context->PrelinkedSize, MACHO_ALIGN (ExportedInfoSize), &NewSize)
     || NewSize > Context->PrelinkedAllocSize) {
-    FreePool (ExportedInfo);
     return EFI_BUFFER_TOO_SMALL;
   }
 
+  if (!XmlDocumentExportToBuffer (
+    Context->PrelinkedInfoDocument,
+    (CHAR8 *) &Context->Prelinked[Context->PrelinkedSize],
+    ExportedInfoSize,
+    NULL,
+    0
+    )) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   Context->PrelinkedInfoSegment->VirtualAddress = Context->PrelinkedLastAddress;
   Context->PrelinkedInfoSegment->Size           = ExportedInfoSize;
   Context->PrelinkedInfoSegment->FileOffset     = Context->PrelinkedSize;
@@ -436,12 +434,6 @@ PrelinkedInjectComplete (
   Context->PrelinkedInfoSection->Size           = ExportedInfoSize;
   Context->PrelinkedInfoSection->Offset         = Context->PrelinkedSize;
 
-  CopyMem (
-    &Context->Prelinked[Context->PrelinkedSize],
-    ExportedInfo,
-    ExportedInfoSize
-    );
-
   ZeroMem (
     &Context->Prelinked[Context->PrelinkedSize + ExportedInfoSize],
     MACHO_ALIGN (ExportedInfoSize) - ExportedInfoSize
@@ -450,8 +442,6 @@ PrelinkedInjectComplete (
   Context->PrelinkedLastAddress += MACHO_ALIGN (ExportedInfoSize);
   Context->PrelinkedSize        += MACHO_ALIGN (ExportedInfoSize);
 
-  FreePool (ExportedInfo);
-
   return EFI_SUCCESS;
 }
 
@@ -513,9 +503,6 @@ PrelinkedInjectKext (
   CHAR8             *TmpInfoPlist;
   CHAR8             *NewInfoPlist;
   OC_MACHO_CONTEXT  ExecutableContext;
-  CONST CHAR8       *TmpKeyValue;
-  UINT32            FieldCount;
-  UINT32            FieldIndex;
   UINT32            NewInfoPlistSize;
   UINT32            NewPrelinkedSize;
   UINT32            AlignedExecutableSize;
@@ -598,41 +585,31 @@ PrelinkedInjectKext (
   // code in debug mode to diagnose it.
   //
   DEBUG_CODE_BEGIN ();
-  if (Executable == NULL) {
-    FieldCount = PlistDictChildren (InfoPlistRoot);
-    for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
-      TmpKeyValue = PlistKeyValue (PlistDictChild (InfoPlistRoot, FieldIndex, NULL));
-      if (TmpKeyValue == NULL) {
-        continue;
-      }
-
-      if (AsciiStrCmp (TmpKeyValue, INFO_BUNDLE_EXECUTABLE_KEY) == 0) {
-        DEBUG ((DEBUG_ERROR, "OCAK: Plist-only kext has %a key\n", INFO_BUNDLE_EXECUTABLE_KEY));
-        ASSERT (FALSE);
-        CpuDeadLoop ();
-      }
-    }
+  if (Executable == NULL && PlistDictLookup (InfoPlistRoot, INFO_BUNDLE_EXECUTABLE_KEY) != NULL) {
+    DEBUG ((DEBUG_ERROR, "OCAK: Plist-only kext has %a key\n", INFO_BUNDLE_EXECUTABLE_KEY));
+    ASSERT (FALSE);
+    CpuDeadLoop ();
   }
   DEBUG_CODE_END ();
 
   Failed = FALSE;
-  Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_BUNDLE_PATH_KEY) == NULL;
-  Failed |= XmlNodeAppend (InfoPlistRoot, "string", NULL, BundlePath) == NULL;
+  Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_BUNDLE_PATH_KEY) == NULL;
+  Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "string", NULL, BundlePath) == NULL;
   if (Executable != NULL) {
-    Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_RELATIVE_PATH_KEY) == NULL;
-    Failed |= XmlNodeAppend (InfoPlistRoot, "string", NULL, ExecutablePath) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_RELATIVE_PATH_KEY) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "string", NULL, ExecutablePath) == NULL;
     Failed |= !AsciiUint64ToLowerHex (ExecutableSourceAddrStr, sizeof (ExecutableSourceAddrStr), Context->PrelinkedLastAddress);
-    Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_SOURCE_ADDR_KEY) == NULL;
-    Failed |= XmlNodeAppend (InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableSourceAddrStr) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_SOURCE_ADDR_KEY) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableSourceAddrStr) == NULL;
     Failed |= !AsciiUint64ToLowerHex (ExecutableLoadAddrStr, sizeof (ExecutableLoadAddrStr), Context->PrelinkedLastLoadAddress);
-    Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_LOAD_ADDR_KEY) == NULL;
-    Failed |= XmlNodeAppend (InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableLoadAddrStr) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_LOAD_ADDR_KEY) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableLoadAddrStr) == NULL;
     Failed |= !AsciiUint64ToLowerHex (ExecutableSizeStr, sizeof (ExecutableSizeStr), AlignedExecutableSize);
-    Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_SIZE_KEY) == NULL;
-    Failed |= XmlNodeAppend (InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableSizeStr) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_EXECUTABLE_SIZE_KEY) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, ExecutableSizeStr) == NULL;
     Failed |= !AsciiUint64ToLowerHex (KmodInfoStr, sizeof (KmodInfoStr), KmodAddress);
-    Failed |= XmlNodeAppend (InfoPlistRoot, "key", NULL, PRELINK_INFO_KMOD_INFO_KEY) == NULL;
-    Failed |= XmlNodeAppend (InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, KmodInfoStr) == NULL;  
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "key", NULL, PRELINK_INFO_KMOD_INFO_KEY) == NULL;
+    Failed |= XmlNodeAppend (InfoPlistDocument, InfoPlistRoot, "integer", PRELINK_INFO_INTEGER_ATTRIBUTES, KmodInfoStr) == NULL;  
   }
 
   if (Failed) {
@@ -692,7 +669,7 @@ PrelinkedInjectKext (
     return Status;
   }
 
-  if (XmlNodeAppend (Context->KextList, "dict", NULL, NewInfoPlist) == NULL) {
+  if (XmlNodeAppend (Context->PrelinkedInfoDocument, Context->KextList, "dict", NULL, NewInfoPlist) == NULL) {
     if (PrelinkedKext != NULL) {
       InternalFreePrelinkedKext (PrelinkedKext);
     }
@@ -704,6 +681,10 @@ PrelinkedInjectKext (
   //
   if (PrelinkedKext != NULL) {
     InsertTailList (&Context->PrelinkedKexts, &PrelinkedKext->Link);
+    //
+    // Unindexed kexts are still found in PrelinkedKexts.
+    //
+    InternalInsertPrelinkedKextIndex (Context, PrelinkedKext);
   }
 
   return EFI_SUCCESS;
@@ -27,6 +27,12 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 #define MAX_KEXT_DEPEDENCIES 16
 
+//
+// Minimum amount of linked symbols to build a name hash index for.
+// Smaller tables are faster to scan linearly.
+//
+#define PRELINKED_KEXT_SYMBOL_INDEX_MIN 64U
+
 typedef struct PRELINKED_KEXT_ PRELINKED_KEXT;
 
 typedef struct {
@@ -110,6 +116,20 @@ struct PRELINKED_KEXT_ {
   //
   PRELINKED_KEXT_SYMBOL    *LinkedSymbolTable;
   //
+  // Open addressing hash index over LinkedSymbolTable names, may be NULL.
+  // Each slot contains LinkedSymbolTable index + 1 or 0 when unused.
+  //
+  UINT32                   *LinkedSymbolIndex;
+  //
+  // LinkedSymbolIndex slot count - 1, slot count is a power of two.
+  //
+  UINT32                   LinkedSymbolIndexMask;
+  //
+  // LinkedSymbolTable indices of C++ symbols sorted by value, may be NULL.
+  // Contains NumberOfCxxSymbols entries.
+  //
+  UINT32                   *LinkedCxxSymbolsByValue;
+  //
   // A flag set during dependency walk BFS to avoid going through the same path.
   //
   BOOLEAN                  Processed;
@@ -141,6 +161,33 @@ struct PRELINKED_KEXT_ {
     PRELINKED_KEXT_SIGNATURE                \
     ))
 
+//
+// PRELINKED_CONTEXT KextIndex slot.
+//
+typedef struct {
+  //
+  // Kext CFBundleIdentifier or NULL for unused slots.
+  //
+  CONST CHAR8     *Identifier;
+  //
+  // Identifier hash, see InternalGetSymbolNameHash.
+  //
+  UINT32          Hash;
+  //
+  // Kext plist from KextList or NULL for injected kexts.
+  //
+  XML_NODE        *KextPlist;
+  //
+  // Cached kext or NULL when not yet created.
+  //
+  PRELINKED_KEXT  *Kext;
+} PRELINKED_KEXT_INDEX_ENTRY;
+
+//
+// Initial amount of KextIndex slots reserved for injected kexts.
+//
+#define PRELINKED_KEXT_INDEX_RESERVE 64U
+
 /**
   Creates new PRELINKED_KEXT from OC_MACHO_CONTEXT.
 **/
@@ -167,6 +214,32 @@ InternalCachedPrelinkedKext (
   IN     CONST CHAR8        *Identifier
   );
 
+/**
+  Build kext identifier index for PRELINKED_CONTEXT KextList.
+
+  @param[in,out] Prelinked  Prelinked context with KextList.
+
+  @return  EFI_SUCCESS on success.
+**/
+EFI_STATUS
+InternalBuildPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked
+  );
+
+/**
+  Insert injected kext into PRELINKED_CONTEXT kext identifier index.
+
+  @param[in,out] Prelinked  Prelinked context.
+  @param[in]     Kext       Injected kext.
+
+  @return  EFI_SUCCESS on success.
+**/
+EFI_STATUS
+InternalInsertPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN     PRELINKED_KEXT     *Kext
+  );
+
 /**
   Gets cached kernel PRELINKED_KEXT from PRELINKED_CONTEXT.
 **/
@@ -342,6 +415,20 @@ typedef enum {
   OcGetSymbolOnlyCxx
 } OC_GET_SYMBOL_LEVEL;
 
+/**
+  Calculate symbol name hash for LinkedSymbolIndex lookup.
+
+  @param[in] Name    Symbol name.
+  @param[in] Length  Symbol name length.
+
+  @return  symbol name hash.
+**/
+UINT32
+InternalGetSymbolNameHash (
+  IN CONST CHAR8  *Name,
+  IN UINT32       Length
+  );
+
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolName (
   IN PRELINKED_CONTEXT    *Context,
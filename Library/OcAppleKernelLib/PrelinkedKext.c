@@ -194,6 +194,151 @@ InternalScanCurrentPrelinkedKextLinkInfo (
   }
 }
 
+/**
+  Build LinkedSymbolIndex for faster symbol name lookup.
+  The index is optional and is not built for smaller tables
+  or when memory is not available.
+
+  @param[in,out] Kext  Kext with constructed LinkedSymbolTable.
+**/
+STATIC
+VOID
+InternalScanBuildLinkedSymbolIndex (
+  IN OUT PRELINKED_KEXT  *Kext
+  )
+{
+  UINT32                      *SymbolIndex;
+  UINT32                      NumSlots;
+  UINT32                      Mask;
+  UINT32                      Slot;
+  UINT32                      Index;
+  CONST PRELINKED_KEXT_SYMBOL *Symbol;
+
+  if (Kext->NumberOfSymbols < PRELINKED_KEXT_SYMBOL_INDEX_MIN
+    || Kext->NumberOfSymbols > MAX_UINT32 / 4) {
+    return;
+  }
+
+  //
+  // Keep load factor at or below 50% for short probe sequences.
+  //
+  NumSlots = 1;
+  while (NumSlots < Kext->NumberOfSymbols * 2) {
+    NumSlots <<= 1U;
+  }
+
+  SymbolIndex = AllocateZeroPool (NumSlots * sizeof (*SymbolIndex));
+  if (SymbolIndex == NULL) {
+    return;
+  }
+
+  Mask = NumSlots - 1;
+
+  for (Index = 0; Index < Kext->NumberOfSymbols; ++Index) {
+    Symbol = &Kext->LinkedSymbolTable[Index];
+    Slot   = InternalGetSymbolNameHash (Symbol->Name, Symbol->Length) & Mask;
+    while (SymbolIndex[Slot] != 0) {
+      Slot = (Slot + 1) & Mask;
+    }
+
+    SymbolIndex[Slot] = Index + 1;
+  }
+
+  Kext->LinkedSymbolIndex     = SymbolIndex;
+  Kext->LinkedSymbolIndexMask = Mask;
+}
+
+STATIC
+BOOLEAN
+InternalSymbolValueLess (
+  IN CONST PRELINKED_KEXT_SYMBOL  *SymbolTable,
+  IN UINT32                       First,
+  IN UINT32                       Second
+  )
+{
+  if (SymbolTable[First].Value != SymbolTable[Second].Value) {
+    return SymbolTable[First].Value < SymbolTable[Second].Value;
+  }
+
+  return First < Second;
+}
+
+STATIC
+VOID
+InternalSiftDownSymbolIndices (
+  IN     CONST PRELINKED_KEXT_SYMBOL  *SymbolTable,
+  IN OUT UINT32                       *SymbolIndices,
+  IN     UINT32                       Root,
+  IN     UINT32                       Count
+  )
+{
+  UINT32  Child;
+  UINT32  Temp;
+
+  while (Root < Count / 2) {
+    Child = 2 * Root + 1;
+    if (Child + 1 < Count
+      && InternalSymbolValueLess (SymbolTable, SymbolIndices[Child], SymbolIndices[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalSymbolValueLess (SymbolTable, SymbolIndices[Root], SymbolIndices[Child])) {
+      return;
+    }
+
+    Temp                 = SymbolIndices[Root];
+    SymbolIndices[Root]  = SymbolIndices[Child];
+    SymbolIndices[Child] = Temp;
+    Root                 = Child;
+  }
+}
+
+/**
+  Build LinkedCxxSymbolsByValue for faster C++ symbol value lookup.
+  Heap sort is used as it needs no extra memory and has no bad cases.
+  The view is optional and is not built when memory is not available.
+
+  @param[in,out] Kext  Kext with constructed LinkedSymbolTable.
+**/
+STATIC
+VOID
+InternalScanBuildLinkedCxxSymbolsByValue (
+  IN OUT PRELINKED_KEXT  *Kext
+  )
+{
+  UINT32  *SymbolIndices;
+  UINT32  Count;
+  UINT32  Index;
+  UINT32  Temp;
+
+  Count = Kext->NumberOfCxxSymbols;
+  if (Count == 0) {
+    return;
+  }
+
+  SymbolIndices = AllocatePool (Count * sizeof (*SymbolIndices));
+  if (SymbolIndices == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < Count; ++Index) {
+    SymbolIndices[Index] = Kext->NumberOfSymbols - Count + Index;
+  }
+
+  for (Index = Count / 2; Index > 0; --Index) {
+    InternalSiftDownSymbolIndices (Kext->LinkedSymbolTable, SymbolIndices, Index - 1, Count);
+  }
+
+  for (Index = Count - 1; Index > 0; --Index) {
+    Temp                 = SymbolIndices[0];
+    SymbolIndices[0]     = SymbolIndices[Index];
+    SymbolIndices[Index] = Temp;
+    InternalSiftDownSymbolIndices (Kext->LinkedSymbolTable, SymbolIndices, 0, Index);
+  }
+
+  Kext->LinkedCxxSymbolsByValue = SymbolIndices;
+}
+
 STATIC
 EFI_STATUS
 InternalScanBuildLinkedSymbolTable (
@@ -312,6 +457,11 @@ InternalScanBuildLinkedSymbolTable (
   Kext->NumberOfCxxSymbols = NumCxxSymbols;
   Kext->LinkedSymbolTable  = SymbolTable;
 
+  if (!Context->DisableSymbolIndices) {
+    InternalScanBuildLinkedSymbolIndex (Kext);
+    InternalScanBuildLinkedCxxSymbolsByValue (Kext);
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -519,25 +669,297 @@ InternalFreePrelinkedKext (
     Kext->LinkedSymbolTable = NULL;
   }
 
+  if (Kext->LinkedSymbolIndex != NULL) {
+    FreePool (Kext->LinkedSymbolIndex);
+    Kext->LinkedSymbolIndex = NULL;
+  }
+
+  if (Kext->LinkedCxxSymbolsByValue != NULL) {
+    FreePool (Kext->LinkedCxxSymbolsByValue);
+    Kext->LinkedCxxSymbolsByValue = NULL;
+  }
+
   if (Kext->LinkedVtables != NULL) {
     FreePool (Kext->LinkedVtables);
     Kext->LinkedVtables = NULL;
   }
 
+  MachoFreeRelocationIndex (&Kext->Context.MachContext);
+
   FreePool (Kext);
 }
 
+/**
+  Find kext identifier index slot.
+
+  @param[in] Entries     Index slots.
+  @param[in] Mask        Index slot count - 1.
+  @param[in] Identifier  Kext identifier.
+  @param[in] Hash        Kext identifier hash.
+
+  @return  slot with matching identifier or first unused slot.
+**/
+STATIC
+PRELINKED_KEXT_INDEX_ENTRY *
+InternalFindPrelinkedKextIndexSlot (
+  IN PRELINKED_KEXT_INDEX_ENTRY  *Entries,
+  IN UINT32                      Mask,
+  IN CONST CHAR8                 *Identifier,
+  IN UINT32                      Hash
+  )
+{
+  UINT32  Slot;
+
+  Slot = Hash & Mask;
+  while (Entries[Slot].Identifier != NULL) {
+    if (Entries[Slot].Hash == Hash && AsciiStrCmp (Entries[Slot].Identifier, Identifier) == 0) {
+      break;
+    }
+
+    Slot = (Slot + 1) & Mask;
+  }
+
+  return &Entries[Slot];
+}
+
+/**
+  Ensure kext identifier index can fit one more entry at 50% load.
+
+  @param[in,out] Prelinked  Prelinked context.
+
+  @return  EFI_SUCCESS on success.
+**/
+STATIC
+EFI_STATUS
+InternalGrowPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked
+  )
+{
+  PRELINKED_KEXT_INDEX_ENTRY  *OldEntries;
+  PRELINKED_KEXT_INDEX_ENTRY  *NewEntries;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+  UINT32                      NumSlots;
+  UINT32                      Index;
+
+  NumSlots = Prelinked->KextIndexMask + 1;
+  if (Prelinked->KextIndex != NULL && (Prelinked->KextIndexCount + 1) * 2 <= NumSlots) {
+    return EFI_SUCCESS;
+  }
+
+  if (NumSlots > MAX_UINT32 / 2 / sizeof (*NewEntries)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  NewEntries = AllocateZeroPool (NumSlots * 2 * sizeof (*NewEntries));
+  if (NewEntries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  OldEntries = Prelinked->KextIndex;
+  if (OldEntries != NULL) {
+    for (Index = 0; Index < NumSlots; ++Index) {
+      if (OldEntries[Index].Identifier != NULL) {
+        Entry = InternalFindPrelinkedKextIndexSlot (
+          NewEntries,
+          NumSlots * 2 - 1,
+          OldEntries[Index].Identifier,
+          OldEntries[Index].Hash
+          );
+        CopyMem (Entry, &OldEntries[Index], sizeof (*Entry));
+      }
+    }
+
+    FreePool (OldEntries);
+  }
+
+  Prelinked->KextIndex     = NewEntries;
+  Prelinked->KextIndexMask = NumSlots * 2 - 1;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get kext identifier index slot for new or existing identifier.
+
+  @param[in,out] Prelinked   Prelinked context.
+  @param[in]     Identifier  Kext identifier.
+
+  @return  slot or NULL when out of resources.
+**/
+STATIC
+PRELINKED_KEXT_INDEX_ENTRY *
+InternalInsertPrelinkedKextIndexSlot (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN     CONST CHAR8        *Identifier
+  )
+{
+  EFI_STATUS                  Status;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+  UINT32                      Hash;
+
+  Status = InternalGrowPrelinkedKextIndex (Prelinked);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  Hash  = InternalGetSymbolNameHash (Identifier, (UINT32) AsciiStrLen (Identifier));
+  Entry = InternalFindPrelinkedKextIndexSlot (
+    Prelinked->KextIndex,
+    Prelinked->KextIndexMask,
+    Identifier,
+    Hash
+    );
+
+  if (Entry->Identifier == NULL) {
+    Entry->Identifier = Identifier;
+    Entry->Hash       = Hash;
+    ++Prelinked->KextIndexCount;
+  }
+
+  return Entry;
+}
+
+EFI_STATUS
+InternalBuildPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked
+  )
+{
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+  UINT32                      KextCount;
+  UINT32                      KextIndex;
+  UINT32                      NumSlots;
+  XML_NODE                    *KextPlist;
+  XML_NODE                    *KextPlistValue;
+  CONST CHAR8                 *KextIdentifier;
+
+  ASSERT (Prelinked->KextIndex == NULL);
+
+  KextCount = XmlNodeChildren (Prelinked->KextList);
+
+  //
+  // Reserve enough slots for all entries and some injected kexts
+  // to avoid rehashing later on.
+  //
+  NumSlots = 1;
+  while (NumSlots < (KextCount + PRELINKED_KEXT_INDEX_RESERVE) * 2) {
+    NumSlots <<= 1U;
+  }
+
+  Prelinked->KextIndex = AllocateZeroPool (NumSlots * sizeof (*Entry));
+  if (Prelinked->KextIndex == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Prelinked->KextIndexCount = 0;
+  Prelinked->KextIndexMask  = NumSlots - 1;
+
+  for (KextIndex = 0; KextIndex < KextCount; ++KextIndex) {
+    KextPlist = PlistNodeCast (XmlNodeChild (Prelinked->KextList, KextIndex), PLIST_NODE_TYPE_DICT);
+    if (KextPlist == NULL) {
+      continue;
+    }
+
+    KextIdentifier = NULL;
+    KextPlistValue = PlistNodeCast (PlistDictLookup (KextPlist, INFO_BUNDLE_IDENTIFIER_KEY), PLIST_NODE_TYPE_STRING);
+    if (KextPlistValue != NULL) {
+      KextIdentifier = XmlNodeContent (KextPlistValue);
+    }
+
+    if (KextIdentifier == NULL) {
+      continue;
+    }
+
+    Entry = InternalInsertPrelinkedKextIndexSlot (Prelinked, KextIdentifier);
+    if (Entry == NULL) {
+      FreePool (Prelinked->KextIndex);
+      Prelinked->KextIndex      = NULL;
+      Prelinked->KextIndexCount = 0;
+      Prelinked->KextIndexMask  = 0;
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    //
+    // Keep the first entry for duplicate identifiers like the KextList scan did.
+    //
+    if (Entry->KextPlist == NULL) {
+      Entry->KextPlist = KextPlist;
+    }
+  }
+
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "OCAK: Indexed %u kext identifiers of %u prelinked entries in %u slots\n",
+    Prelinked->KextIndexCount,
+    KextCount,
+    NumSlots
+    ));
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+InternalInsertPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN     PRELINKED_KEXT     *Kext
+  )
+{
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+
+  if (Prelinked->KextIndex == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Entry = InternalInsertPrelinkedKextIndexSlot (Prelinked, Kext->Identifier);
+  if (Entry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Earlier cached kexts take precedence like in PrelinkedKexts list order.
+  //
+  if (Entry->Kext == NULL) {
+    Entry->Kext = Kext;
+  }
+
+  return EFI_SUCCESS;
+}
+
 PRELINKED_KEXT *
 InternalCachedPrelinkedKext (
   IN OUT PRELINKED_CONTEXT  *Prelinked,
   IN     CONST CHAR8        *Identifier
   )
 {
-  PRELINKED_KEXT  *NewKext;
-  LIST_ENTRY      *Kext;
-  UINT32          Index;
-  UINT32          KextCount;
-  XML_NODE        *KextPlist;
+  PRELINKED_KEXT              *NewKext;
+  LIST_ENTRY                  *Kext;
+  UINT32                      Index;
+  UINT32                      KextCount;
+  XML_NODE                    *KextPlist;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+
+  //
+  // Find indexed entry if any. Kexts missing from the index (e.g. kernel)
+  // are still looked up in the cache below.
+  //
+  Entry = NULL;
+  if (Prelinked->KextIndex != NULL) {
+    Entry = InternalFindPrelinkedKextIndexSlot (
+      Prelinked->KextIndex,
+      Prelinked->KextIndexMask,
+      Identifier,
+      InternalGetSymbolNameHash (Identifier, (UINT32) AsciiStrLen (Identifier))
+      );
+    if (Entry->Kext != NULL) {
+      return Entry->Kext;
+    } else if (Entry->KextPlist != NULL) {
+      NewKext = InternalCreatePrelinkedKext (Prelinked, Entry->KextPlist, Identifier);
+      if (NewKext != NULL) {
+        Entry->Kext = NewKext;
+        InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
+        return NewKext;
+      }
+    }
+  }
 
   //
   // Find cached entry if any.
@@ -551,6 +973,14 @@ InternalCachedPrelinkedKext (
     Kext = GetNextNode (&Prelinked->PrelinkedKexts, Kext);
   }
 
+  //
+  // All KextList entries are indexed, no need to walk it again unless
+  // the first entry with this identifier failed and a duplicate may follow.
+  //
+  if (Entry != NULL && Entry->KextPlist == NULL) {
+    return NULL;
+  }
+
   //
   // Try with real entry.
   //
@@ -559,7 +989,7 @@ InternalCachedPrelinkedKext (
   for (Index = 0; Index < KextCount; ++Index) {
     KextPlist = PlistNodeCast (XmlNodeChild (Prelinked->KextList, Index), PLIST_NODE_TYPE_DICT);
 
-    if (KextPlist == NULL) {
+    if (KextPlist == NULL || (Entry != NULL && KextPlist == Entry->KextPlist)) {
       continue;
     }
 
@@ -573,6 +1003,10 @@ InternalCachedPrelinkedKext (
     return NULL;
   }
 
+  if (Entry != NULL) {
+    Entry->Kext = NewKext;
+  }
+
   InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
 
   return NewKext;
@@ -465,6 +465,176 @@ OcAppleRamDiskWrite (
   return FALSE;
 }
 
+VOID
+OcAppleRamDiskInitCursor (
+  OUT OC_APPLE_RAM_DISK_CURSOR           *Cursor,
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
+  )
+{
+  UINT32  Index;
+
+  ASSERT (Cursor != NULL);
+  ASSERT (ExtentTable != NULL);
+  INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
+
+  Cursor->ExtentTable = ExtentTable;
+  Cursor->Extent      = 0;
+
+  //
+  // As per the allocation algorithm, the sum over all Extent->Length must be
+  // smaller than MAX_UINTN.
+  //
+  Cursor->ExtentOffsets[0] = 0;
+  for (Index = 0; Index < ExtentTable->ExtentCount; ++Index) {
+    ASSERT (ExtentTable->Extents[Index].Start <= MAX_UINTN);
+    ASSERT (ExtentTable->Extents[Index].Length <= MAX_UINTN);
+
+    Cursor->ExtentOffsets[Index + 1] = Cursor->ExtentOffsets[Index]
+      + (UINTN) ExtentTable->Extents[Index].Length;
+  }
+}
+
+/**
+  Find extent containing RAM disk offset. The last accessed extent and
+  the one following it are tried first, then extent offsets are searched.
+
+  @param[in,out] Cursor  Initialised RAM disk cursor.
+  @param[in]     Offset  Offset in RAM disk.
+
+  @retval Extent index or ExtentCount when Offset is out of RAM disk.
+**/
+STATIC
+UINT32
+InternalCursorFindExtent (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset
+  )
+{
+  UINT32  Count;
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Count = Cursor->ExtentTable->ExtentCount;
+
+  if (Offset >= Cursor->ExtentOffsets[Count]) {
+    return Count;
+  }
+
+  Low = Cursor->Extent;
+  if (Offset >= Cursor->ExtentOffsets[Low]) {
+    if (Offset < Cursor->ExtentOffsets[Low + 1]) {
+      return Low;
+    }
+
+    if (Low + 1 < Count && Offset < Cursor->ExtentOffsets[Low + 2]) {
+      Cursor->Extent = Low + 1;
+      return Low + 1;
+    }
+  }
+
+  //
+  // Find the last extent starting at or before Offset, empty extents are skipped.
+  //
+  Low  = 0;
+  High = Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Cursor->ExtentOffsets[Middle] <= Offset) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  ASSERT (Low > 0);
+
+  Cursor->Extent = Low - 1;
+  return Low - 1;
+}
+
+/**
+  Copy data between RAM disk and buffer through cursor.
+
+  @param[in,out] Cursor  Initialised RAM disk cursor.
+  @param[in]     Offset  Offset in RAM disk.
+  @param[in]     Size    Amount of data to copy.
+  @param[in,out] Buffer  Buffer to read to or write from.
+  @param[in]     Write   Copy from Buffer to RAM disk.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalCursorCopy (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  IN OUT UINT8                     *Buffer,
+  IN     BOOLEAN                   Write
+  )
+{
+  UINT32                      Index;
+  CONST APPLE_RAM_DISK_EXTENT *Extent;
+  UINT8                       *ExtentData;
+  UINTN                       LocalOffset;
+  UINTN                       LocalSize;
+
+  ASSERT (Cursor != NULL);
+  ASSERT (Cursor->ExtentTable != NULL);
+  ASSERT (Size > 0);
+  ASSERT (Buffer != NULL);
+
+  Index = InternalCursorFindExtent (Cursor, Offset);
+
+  for (; Index < Cursor->ExtentTable->ExtentCount; ++Index) {
+    Extent      = &Cursor->ExtentTable->Extents[Index];
+    LocalOffset = Offset - Cursor->ExtentOffsets[Index];
+    LocalSize   = (UINTN)MIN ((Extent->Length - LocalOffset), Size);
+    ExtentData  = (UINT8 *)(UINTN) Extent->Start + LocalOffset;
+
+    if (Write) {
+      CopyMem (ExtentData, Buffer, LocalSize);
+    } else {
+      CopyMem (Buffer, ExtentData, LocalSize);
+    }
+
+    Cursor->Extent = Index;
+
+    Size -= LocalSize;
+    if (Size == 0) {
+      return TRUE;
+    }
+
+    Buffer += LocalSize;
+    Offset += LocalSize;
+  }
+
+  return FALSE;
+}
+
+BOOLEAN
+OcAppleRamDiskCursorRead (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  OUT    VOID                      *Buffer
+  )
+{
+  return InternalCursorCopy (Cursor, Offset, Size, Buffer, FALSE);
+}
+
+BOOLEAN
+OcAppleRamDiskCursorWrite (
+  IN OUT OC_APPLE_RAM_DISK_CURSOR  *Cursor,
+  IN     UINTN                     Offset,
+  IN     UINTN                     Size,
+  IN     CONST VOID                *Buffer
+  )
+{
+  return InternalCursorCopy (Cursor, Offset, Size, (UINT8 *) Buffer, TRUE);
+}
+
 BOOLEAN
 OcAppleRamDiskLoadFile (
   IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
@@ -106,37 +106,42 @@ InternalGetFirstDeviceBootFilePath (
   return BootDevicePath;
 }
 
+/**
+  Prepare DMG chunklist for image verification according to policy.
+
+  @param[in]  Policy               Load policy.
+  @param[in]  ChunklistBuffer      Chunklist file data, optional.
+  @param[in]  ChunklistBufferSize  Chunklist file size.
+  @param[out] ChunklistContext     Chunklist context to initialise.
+  @param[out] VerifyData           Whether the image must be verified against
+                                   ChunklistContext.
+
+  @retval FALSE when loading must be aborted.
+**/
 STATIC
-EFI_DEVICE_PATH_PROTOCOL *
-InternalGetDiskImageBootFile (
-  OUT INTERNAL_DMG_LOAD_CONTEXT   *Context,
+BOOLEAN
+InternalPrepareDmgChunklist (
   IN  UINT32                      Policy,
-  IN  UINTN                       DmgFileSize,
   IN  VOID                        *ChunklistBuffer OPTIONAL,
-  IN  UINT32                      ChunklistBufferSize OPTIONAL
+  IN  UINT32                      ChunklistBufferSize OPTIONAL,
+  OUT OC_APPLE_CHUNKLIST_CONTEXT  *ChunklistContext,
+  OUT BOOLEAN                     *VerifyData
   )
 {
-  EFI_DEVICE_PATH_PROTOCOL       *DevPath;
-
-  BOOLEAN                        Result;
-  OC_APPLE_CHUNKLIST_CONTEXT     ChunklistContext;
+  BOOLEAN  Result;
 
-  CONST EFI_DEVICE_PATH_PROTOCOL *DmgDevicePath;
-  UINTN                          DmgDevicePathSize;
-
-  ASSERT (Context != NULL);
-  ASSERT (DmgFileSize > 0);
+  *VerifyData = FALSE;
 
   if (ChunklistBuffer == NULL) {
     if ((Policy & OC_LOAD_REQUIRE_APPLE_SIGN) != 0) {
       DEBUG ((DEBUG_WARN, "OCB: Missing DMG signature, aborting\n"));
-      return NULL;
+      return FALSE;
     }
   } else if ((Policy & (OC_LOAD_VERIFY_APPLE_SIGN | OC_LOAD_REQUIRE_TRUSTED_KEY)) != 0) {
     ASSERT (ChunklistBufferSize > 0);
 
     Result = OcAppleChunklistInitializeContext (
-                &ChunklistContext,
+                ChunklistContext,
                 ChunklistBuffer,
                 ChunklistBufferSize
                 );
@@ -145,7 +150,7 @@ InternalGetDiskImageBootFile (
         DEBUG_INFO,
         "OCB: Failed to initialise DMG Chunklist context\n"
         ));
-      return NULL;
+      return FALSE;
     }
 
     if ((Policy & OC_LOAD_REQUIRE_TRUSTED_KEY) != 0) {
@@ -155,38 +160,45 @@ InternalGetDiskImageBootFile (
       //
       if ((Policy & OC_LOAD_TRUST_APPLE_V1_KEY) != 0) {
         Result = OcAppleChunklistVerifySignature (
-                   &ChunklistContext,
+                   ChunklistContext,
                    PkDataBase[0].PublicKey
                    );
       }
 
       if (!Result && ((Policy & OC_LOAD_TRUST_APPLE_V2_KEY) != 0)) {
         Result = OcAppleChunklistVerifySignature (
-                   &ChunklistContext,
+                   ChunklistContext,
                    PkDataBase[1].PublicKey
                    );
       }
 
       if (!Result) {
         DEBUG ((DEBUG_WARN, "OCB: DMG is not trusted, aborting\n"));
-        return NULL;
+        return FALSE;
       }
     }
 
-    Result = OcAppleDiskImageVerifyData (
-               Context->DmgContext,
-               &ChunklistContext
-               );
-    if (!Result) {
-      DEBUG ((DEBUG_WARN, "OCB: DMG has been altered\n"));
-      //
-      // FIXME: Warn user instead of aborting when OC_LOAD_REQUIRE_TRUSTED_KEY
-      //        is not set.
-      //
-      return NULL;
-    }
+    *VerifyData = TRUE;
   }
 
+  return TRUE;
+}
+
+STATIC
+EFI_DEVICE_PATH_PROTOCOL *
+InternalGetDiskImageBootFile (
+  OUT INTERNAL_DMG_LOAD_CONTEXT   *Context,
+  IN  UINTN                       DmgFileSize
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL       *DevPath;
+
+  CONST EFI_DEVICE_PATH_PROTOCOL *DmgDevicePath;
+  UINTN                          DmgDevicePathSize;
+
+  ASSERT (Context != NULL);
+  ASSERT (DmgFileSize > 0);
+
   Context->BlockIoHandle = OcAppleDiskImageInstallBlockIo (
                              Context->DmgContext,
                              DmgFileSize,
@@ -343,6 +355,8 @@ InternalLoadDmg (
   EFI_FILE_PROTOCOL        *ChunklistFile;
   UINT32                   ChunklistFileSize;
   VOID                     *ChunklistBuffer;
+  OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
+  BOOLEAN                  VerifyData;
 
   CHAR16 *DevPathText;
 
@@ -411,25 +425,9 @@ InternalLoadDmg (
     return NULL;
   }
 
-  Context->DmgContext = AllocatePool (sizeof (*Context->DmgContext));
-  if (Context->DmgContext == NULL) {
-    DEBUG ((DEBUG_INFO, "OCB: Failed to allocate DMG context\n"));
-    return NULL;
-  }
-
-  Result = OcAppleDiskImageInitializeFromFile (Context->DmgContext, DmgFile);
-
-  DmgFile->Close (DmgFile);
-
-  if (!Result) {
-    DEBUG ((DEBUG_INFO, "OCB: Failed to initialise DMG from file\n"));
-
-    FreePool (DmgFileInfo);
-    FreePool (Context->DmgContext);
-    DmgDir->Close (DmgDir);
-    return NULL;
-  }
-
+  //
+  // Chunklist is read first to verify the DMG while loading it.
+  //
   ChunklistBuffer   = NULL;
   ChunklistFileSize = 0;
 
@@ -473,13 +471,58 @@ InternalLoadDmg (
 
   DmgDir->Close (DmgDir);
 
-  DevPath = InternalGetDiskImageBootFile (
-              Context,
-              Policy,
-              DmgFileSize,
-              ChunklistBuffer,
-              ChunklistFileSize
-              );
+  Result = InternalPrepareDmgChunklist (
+             Policy,
+             ChunklistBuffer,
+             ChunklistFileSize,
+             &ChunklistContext,
+             &VerifyData
+             );
+  if (!Result) {
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
+
+    DmgFile->Close (DmgFile);
+    return NULL;
+  }
+
+  Context->DmgContext = AllocatePool (sizeof (*Context->DmgContext));
+  if (Context->DmgContext == NULL) {
+    DEBUG ((DEBUG_INFO, "OCB: Failed to allocate DMG context\n"));
+
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
+
+    DmgFile->Close (DmgFile);
+    return NULL;
+  }
+
+  Result = OcAppleDiskImageInitializeFromFile (
+             Context->DmgContext,
+             DmgFile,
+             VerifyData ? &ChunklistContext : NULL
+             );
+
+  DmgFile->Close (DmgFile);
+
+  if (ChunklistBuffer != NULL) {
+    FreePool (ChunklistBuffer);
+  }
+
+  if (!Result) {
+    //
+    // FIXME: Warn user instead of aborting when DMG has been altered and
+    //        OC_LOAD_REQUIRE_TRUSTED_KEY is not set.
+    //
+    DEBUG ((DEBUG_INFO, "OCB: Failed to initialise DMG from file\n"));
+
+    FreePool (Context->DmgContext);
+    return NULL;
+  }
+
+  DevPath = InternalGetDiskImageBootFile (Context, DmgFileSize);
   Context->DevicePath = DevPath;
 
   if (DevPath == NULL) {
@@ -489,10 +532,6 @@ InternalLoadDmg (
     FreePool (Context->DmgContext);
   }
 
-  if (ChunklistBuffer != NULL) {
-    FreePool (ChunklistBuffer);
-  }
-
   return DevPath;
 }
 
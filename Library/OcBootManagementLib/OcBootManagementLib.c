@@ -505,6 +505,7 @@ OcRunBootPicker (
   OC_BOOT_CONTEXT                    *BootContext;
   OC_BOOT_ENTRY                      *Chosen;
   BOOLEAN                            SaidWelcome;
+  OC_LOG_SPAN                        Span;
 
   SaidWelcome = FALSE;
 
@@ -557,6 +558,7 @@ OcRunBootPicker (
     //
     // Turbo-boost scanning when bypassing picker.
     //
+    OcLogSpanBegin (&Span, "Boot entry scan");
     if (Context->PickerCommand == OcPickerDefault) {
       BootContext = OcScanForDefaultBootEntry (Context);
     } else {
@@ -568,6 +570,7 @@ OcRunBootPicker (
 
       BootContext = OcScanForBootEntries (Context);
     }
+    OcLogSpanEnd (&Span);
 
     //
     // We have no entries at all or have auxiliary entries.
@@ -597,7 +600,9 @@ OcRunBootPicker (
         SaidWelcome = TRUE;
       }
 
+      OcLogSpanBegin (&Span, "Boot picker");
       Status = RunShowMenu (BootContext, &Chosen);
+      OcLogSpanEnd (&Span);
 
       if (EFI_ERROR (Status) && Status != EFI_ABORTED) {
         DEBUG ((DEBUG_ERROR, "OCB: ShowMenu failed - %r\n", Status));
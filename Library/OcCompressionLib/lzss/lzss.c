@@ -85,13 +85,36 @@ struct encode_state {
 };
 
 
+/*
+ * Largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1, see zlib adler32.c.
+ */
+#define ADLER_BASE 65521U
+#define ADLER_NMAX 5552
+
+/*
+ * Emit decompressed byte, updating Adler-32 sums when requested.
+ */
+#define EMIT_BYTE(c) do {                                   \
+    *dst++ = (c);                                           \
+    if (checksum != NULL) {                                 \
+        lowHalf += (c);                                     \
+        highHalf += lowHalf;                                \
+        if (++pending == ADLER_NMAX) {                      \
+            lowHalf %= ADLER_BASE;                          \
+            highHalf %= ADLER_BASE;                         \
+            pending = 0;                                    \
+        }                                                   \
+    }                                                       \
+} while (0)
+
 /*******************************************************************************
 *******************************************************************************/
-u_int32_t decompress_lzss(
+static u_int32_t decompress_lzss_worker(
     u_int8_t       * dst,
     u_int32_t        dstlen,
     u_int8_t       * src,
-    u_int32_t        srclen)
+    u_int32_t        srclen,
+    u_int32_t      * checksum)
 {
     /* ring buffer of size N, with extra F-1 bytes to aid string comparison */
     u_int8_t text_buf[N + F - 1];
@@ -101,11 +124,16 @@ u_int32_t decompress_lzss(
     int  i, j, k, r;
     u_int8_t c;
     unsigned int flags;
+    u_int32_t lowHalf, highHalf, pending;
 
     if (dstlen > OC_COMPRESSION_MAX_LENGTH || srclen > OC_COMPRESSION_MAX_LENGTH) {
         return 0;
     }
 
+    lowHalf = 1;
+    highHalf = 0;
+    pending = 0;
+
     dst = dststart;
     memset(text_buf, ' ', N - F);
     r = N - F;
@@ -117,7 +145,7 @@ u_int32_t decompress_lzss(
         }   /* to count eight */
         if (flags & 1) {
             if (src < srcend) c = *src++; else break;
-            if (dst < dstend) *dst++ = c; else break;
+            if (dst < dstend) EMIT_BYTE(c); else break;
             text_buf[r++] = c;
             r &= (N - 1);
         } else {
@@ -127,16 +155,43 @@ u_int32_t decompress_lzss(
             j  =  (j & 0x0F) + THRESHOLD;
             for (k = 0; k <= j; k++) {
                 c = text_buf[(i + k) & (N - 1)];
-                if (dst < dstend) *dst++ = c; else break;
+                if (dst < dstend) EMIT_BYTE(c); else break;
                 text_buf[r++] = c;
                 r &= (N - 1);
             }
         }
     }
 
+    if (checksum != NULL) {
+        *checksum = ((highHalf % ADLER_BASE) << 16) | (lowHalf % ADLER_BASE);
+    }
+
     return (u_int32_t)(dst - dststart);
 }
 
+/*******************************************************************************
+*******************************************************************************/
+u_int32_t decompress_lzss(
+    u_int8_t       * dst,
+    u_int32_t        dstlen,
+    u_int8_t       * src,
+    u_int32_t        srclen)
+{
+    return decompress_lzss_worker(dst, dstlen, src, srclen, NULL);
+}
+
+/*******************************************************************************
+*******************************************************************************/
+u_int32_t decompress_lzss_checksum(
+    u_int8_t       * dst,
+    u_int32_t        dstlen,
+    u_int8_t       * src,
+    u_int32_t        srclen,
+    u_int32_t      * checksum)
+{
+    return decompress_lzss_worker(dst, dstlen, src, srclen, checksum);
+}
+
 /*
  * initialize state, mostly the trees
  *
@@ -148,10 +203,14 @@ u_int32_t decompress_lzss(
  * Note there are 256 trees. */
 static void init_state(struct encode_state *sp)
 {
+    int  i;
+
     bzero(sp, sizeof(*sp));
     memset(&sp->text_buf[0], ' ', N - F);
-    bzero(&sp->rchild[N + 1], 256 * sizeof(sp->rchild[0]));
-    bzero(&sp->parent[0], N * sizeof(sp->parent[0]));
+    for (i = N + 1; i <= N + 256; i++)
+        sp->rchild[i] = NIL;
+    for (i = 0; i < N; i++)
+        sp->parent[i] = NIL;
 }
 
 /*
@@ -843,3 +843,43 @@ size_t lzvn_decode_buffer(unsigned char *dst, size_t dst_size,
   // This is how much we decompressed
   return dstate.dst - dst;
 }
+
+size_t lzvn_decode_buffer_checksum(unsigned char *dst, size_t dst_size,
+                                   const unsigned char *src, size_t src_size,
+                                   uint32_t *checksum) {
+  // Init LZVN decoder state
+  lzvn_decoder_state dstate;
+  unsigned char *dst_window;
+  uint32_t adler;
+
+  if (dst_size > OC_COMPRESSION_MAX_LENGTH || src_size > OC_COMPRESSION_MAX_LENGTH) {
+    return 0;
+  }
+
+  memset(&dstate, 0x00, sizeof(dstate));
+  dstate.src = src;
+  dstate.src_end = src + src_size;
+
+  dstate.dst_begin = dst;
+  dstate.dst = dst;
+
+  dstate.d_prev = 0;
+  dstate.end_of_stream = 0;
+
+  // Decode one window at a time and checksum it while it is still in cache.
+  // The decoder saves partially expanded matches in state and resumes them.
+  adler = 1;
+  do {
+    dst_window = dstate.dst;
+    dstate.dst_end = dst_window + MIN((size_t)(dst + dst_size - dst_window), (size_t)OC_LZVN_CHECKSUM_WINDOW);
+
+    lzvn_decode(&dstate);
+
+    adler = Adler32Update(adler, dst_window, dstate.dst - dst_window);
+  } while (dstate.dst == dstate.dst_end && dstate.dst < dst + dst_size);
+
+  *checksum = adler;
+
+  // This is how much we decompressed
+  return dstate.dst - dst;
+}
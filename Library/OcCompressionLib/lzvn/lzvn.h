@@ -30,6 +30,7 @@ typedef UINTN size_t;
 typedef UINTN uintmax_t;
 
 #define lzvn_decode_buffer DecompressLZVN
+#define lzvn_decode_buffer_checksum DecompressLZVNWithChecksum
 
 #ifdef memset
 #undef memset
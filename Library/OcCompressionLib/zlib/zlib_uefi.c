@@ -34,6 +34,16 @@ void ZLIB_INTERNAL zcfree (opaque, ptr)
   FreePool (ptr);
 }
 
+UINT32
+Adler32Update (
+  IN UINT32       Adler,
+  IN CONST UINT8  *Buffer,
+  IN UINTN        Length
+  )
+{
+  return (UINT32) adler32_z (Adler, Buffer, Length);
+}
+
 UINT8 *
 CompressZLIB (
   OUT UINT8        *Dst,
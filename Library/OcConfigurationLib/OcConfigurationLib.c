@@ -37,6 +37,7 @@ OC_STRUCTORS       (OC_KERNEL_ADD_ENTRY, ())
 OC_ARRAY_STRUCTORS (OC_KERNEL_ADD_ARRAY)
 OC_STRUCTORS       (OC_KERNEL_BLOCK_ENTRY, ())
 OC_ARRAY_STRUCTORS (OC_KERNEL_BLOCK_ARRAY)
+OC_STRUCTORS       (OC_KERNEL_CACHE, ())
 OC_STRUCTORS       (OC_KERNEL_EMULATE, ())
 OC_STRUCTORS       (OC_KERNEL_PATCH_ENTRY, ())
 OC_ARRAY_STRUCTORS (OC_KERNEL_PATCH_ARRAY)
@@ -255,6 +256,13 @@ STATIC
 OC_SCHEMA
 mKernelBlockSchema = OC_SCHEMA_DICT (NULL, mKernelBlockSchemaEntry);
 
+STATIC
+OC_SCHEMA
+mKernelCacheSchema[] = {
+  OC_SCHEMA_BOOLEAN_IN ("Enabled",          OC_GLOBAL_CONFIG, Kernel.Cache.Enabled),
+  OC_SCHEMA_BOOLEAN_IN ("Update",           OC_GLOBAL_CONFIG, Kernel.Cache.Update),
+};
+
 STATIC
 OC_SCHEMA
 mKernelEmulateSchema[] = {
@@ -309,6 +317,7 @@ OC_SCHEMA
 mKernelConfigurationSchema[] = {
   OC_SCHEMA_ARRAY_IN   ("Add",     OC_GLOBAL_CONFIG, Kernel.Add, &mKernelAddSchema),
   OC_SCHEMA_ARRAY_IN   ("Block",   OC_GLOBAL_CONFIG, Kernel.Block, &mKernelBlockSchema),
+  OC_SCHEMA_DICT       ("Cache",   mKernelCacheSchema),
   OC_SCHEMA_DICT       ("Emulate", mKernelEmulateSchema),
   OC_SCHEMA_ARRAY_IN   ("Patch",   OC_GLOBAL_CONFIG, Kernel.Patch, &mKernelPatchSchema),
   OC_SCHEMA_DICT       ("Quirks",  mKernelQuirksSchema),
@@ -99,7 +99,7 @@ BigNumCalculateMontParams (
   @param[in,out] Result    The buffer to return the result into.
   @param[in]     NumWords  The number of Words of Result, A, N and RSqrMod.
   @param[in]     A         The base.
-  @param[in]     B         The exponent.
+  @param[in]     B         The exponent, must be odd and at least 3.
   @param[in]     N         The modulus.
   @param[in]     N0Inv     The Montgomery Inverse of N.
   @param[in]     RSqrMod   Montgomery's R^2 mod N.
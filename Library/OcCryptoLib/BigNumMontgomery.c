@@ -31,6 +31,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <Base.h>
 
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -566,6 +567,174 @@ BigNumMontMul1 (
   //
 }
 
+/**
+  Returns the sliding window size for exponent B.
+  Precomputing the odd powers of a window of W bits costs 2^(W-1) Montgomery
+  Multiplications, while the exponentiation costs about #Bits(B) / (W + 1),
+  so larger windows only pay off for longer exponents.
+
+  @param[in] NumBits  The number of significant bits of the exponent.
+
+  @returns  The window size in bits.
+
+**/
+STATIC
+UINT8
+BigNumPowModWindowBits (
+  IN UINT8  NumBits
+  )
+{
+  if (NumBits <= 8) {
+    return 1;
+  }
+
+  if (NumBits <= 24) {
+    return 2;
+  }
+
+  return 3;
+}
+
+/**
+  Calculates the exponentiation of A with B mod N with left-to-right sliding
+  window exponentiation. The result is not reduced mod N.
+
+  @param[in,out] Result    The buffer to return the result into.
+  @param[in]     NumWords  The number of Words of Result, A, N and RSqrMod.
+  @param[in]     A         The base.
+  @param[in]     B         The exponent, must not be 0.
+  @param[in]     N         The modulus.
+  @param[in]     N0Inv     The Montgomery Inverse of N.
+  @param[in]     RSqrMod   Montgomery's R^2 mod N.
+
+  @returns  Whether the operation was completed successfully.
+
+**/
+STATIC
+BOOLEAN
+BigNumPowModWindow (
+  IN OUT OC_BN_WORD        *Result,
+  IN     OC_BN_NUM_WORDS   NumWords,
+  IN     CONST OC_BN_WORD  *A,
+  IN     UINT32            B,
+  IN     CONST OC_BN_WORD  *N,
+  IN     OC_BN_WORD        N0Inv,
+  IN     CONST OC_BN_WORD  *RSqrMod
+  )
+{
+  OC_BN_WORD *Memory;
+  OC_BN_WORD *Powers;
+  OC_BN_WORD *Acc;
+  OC_BN_WORD *Tmp;
+  OC_BN_WORD *Swap;
+
+  UINT8      NumBits;
+  UINT8      WindowBits;
+  UINT8      NumPowers;
+  INT8       Bit;
+  INT8       Low;
+  UINT32     Window;
+  BOOLEAN    Started;
+  UINTN      Index;
+
+  ASSERT (B != 0);
+
+  NumBits    = (UINT8) (HighBitSet32 (B) + 1);
+  WindowBits = BigNumPowModWindowBits (NumBits);
+  NumPowers  = (UINT8) (1U << (WindowBits - 1));
+
+  STATIC_ASSERT (
+    OC_BN_MAX_SIZE <= MAX_UINTN / 6,
+    "An overflow verification must be added"
+    );
+
+  Memory = AllocatePool ((NumPowers + 2) * (UINTN)NumWords * OC_BN_WORD_SIZE);
+  if (Memory == NULL) {
+    DEBUG ((DEBUG_INFO, "OCCR: Memory allocation failure in ModPow\n"));
+    return FALSE;
+  }
+
+  Powers = Memory;
+  Acc    = &Memory[(UINTN)NumPowers * NumWords];
+  Tmp    = &Acc[NumWords];
+  //
+  // Calculate the odd powers A^1, A^3, ..., A^(2^WindowBits - 1) in the
+  // Montgomery Domain.
+  // Powers[0] = MM (A, R^2 mod N)
+  // Powers[I] = MM (Powers[I - 1], MM (Powers[0], Powers[0]))
+  //
+  BigNumMontMul (Powers, NumWords, A, RSqrMod, N, N0Inv);
+  if (NumPowers > 1) {
+    BigNumMontMul (Tmp, NumWords, Powers, Powers, N, N0Inv);
+    for (Index = 1; Index < NumPowers; ++Index) {
+      BigNumMontMul (
+        &Powers[Index * NumWords],
+        NumWords,
+        &Powers[(Index - 1) * NumWords],
+        Tmp,
+        N,
+        N0Inv
+        );
+    }
+  }
+  //
+  // Scan the exponent from the most significant bit. Each window starts and
+  // ends with a set bit, so that its value is odd and can be multiplied from
+  // the precomputed powers. The leading window initialises the accumulator.
+  //
+  Started = FALSE;
+  Bit     = (INT8) (NumBits - 1);
+  while (Bit >= 0) {
+    if ((B & (1U << Bit)) == 0) {
+      BigNumMontMul (Tmp, NumWords, Acc, Acc, N, N0Inv);
+      Swap = Acc;
+      Acc  = Tmp;
+      Tmp  = Swap;
+      --Bit;
+      continue;
+    }
+
+    Low = (INT8) MAX (Bit - WindowBits + 1, 0);
+    while ((B & (1U << Low)) == 0) {
+      ++Low;
+    }
+
+    Window = (B >> Low) & ((1U << (Bit - Low + 1)) - 1U);
+
+    if (!Started) {
+      CopyMem (
+        Acc,
+        &Powers[(Window >> 1U) * NumWords],
+        (UINTN)NumWords * OC_BN_WORD_SIZE
+        );
+      Started = TRUE;
+    } else {
+      for (Index = 0; Index < (UINTN) (Bit - Low + 1); ++Index) {
+        BigNumMontMul (Tmp, NumWords, Acc, Acc, N, N0Inv);
+        Swap = Acc;
+        Acc  = Tmp;
+        Tmp  = Swap;
+      }
+
+      BigNumMontMul (Tmp, NumWords, Acc, &Powers[(Window >> 1U) * NumWords], N, N0Inv);
+      Swap = Acc;
+      Acc  = Tmp;
+      Tmp  = Swap;
+    }
+
+    Bit = Low - 1;
+  }
+  //
+  // Perform a Montgomery Multiplication with 1, which effectively is a
+  // division by R, taking the result out of the Montgomery Domain.
+  // C = MM (Acc, 1)
+  //
+  BigNumMontMul1 (Result, NumWords, Acc, N, N0Inv);
+
+  FreePool (Memory);
+  return TRUE;
+}
+
 BOOLEAN
 BigNumPowMod (
   IN OUT OC_BN_WORD        *Result,
@@ -588,12 +757,28 @@ BigNumPowMod (
   ASSERT (N0Inv != 0);
   ASSERT (RSqrMod != NULL);
   //
-  // Currently, only the most frequent exponents are supported.
+  // RSA public exponents are odd and at least 3, anything else is either
+  // not a valid key or does not provide any security.
   //
-  if (B != 0x10001 && B != 3) {
+  if (B < 3 || (B & 1U) == 0) {
     DEBUG ((DEBUG_INFO, "OCCR: Unsupported exponent: %x\n", B));
     return FALSE;
   }
+  //
+  // The most frequent exponents use dedicated addition chains, others are
+  // handled by sliding window exponentiation.
+  //
+  if (B != 0x10001 && B != 3) {
+    if (!BigNumPowModWindow (Result, NumWords, A, B, N, N0Inv, RSqrMod)) {
+      return FALSE;
+    }
+
+    if (BigNumCmp (Result, NumWords, N) >= 0) {
+      BigNumSub (Result, NumWords, Result, N);
+    }
+
+    return TRUE;
+  }
 
   ATmp = AllocatePool ((UINTN)NumWords * OC_BN_WORD_SIZE);
   if (ATmp == NULL) {
@@ -632,16 +817,13 @@ BigNumPowMod (
     //
     BigNumMontMul (Result, NumWords, ATmp, ATmp, N, N0Inv);
     //
-    // ATmp = MM (Result, ATmp)
-    //
-    BigNumMontMul (ATmp, NumWords, Result, ATmp, N, N0Inv);
-    //
-    // Perform a Montgomery Multiplication with 1, which effectively is a
-    // division by R, taking the result out of the Montgomery Domain.
-    // C = MM (ATmp, 1)
-    // TODO: Is this needed or can we just multiply with A above?
+    // BigNumMontMul zeroes its result first, so it must not alias the inputs.
+    // As with 65537, multiplying with A, which is not within the Montgomery
+    // Domain, takes the result out of the Montgomery Domain.
+    // ATmp = MM (Result, A)
     //
-    BigNumMontMul1 (Result, NumWords, ATmp, N, N0Inv);
+    BigNumMontMul (ATmp, NumWords, Result, A, N, N0Inv);
+    CopyMem (Result, ATmp, (UINTN)NumWords * OC_BN_WORD_SIZE);
   }
   //
   // The Montgomery Multiplications above only ensure the result is mod N when
@@ -49,6 +49,16 @@ STATIC CONST UINT8 mPkcsDigestEncodingPrefixSha512[] = {
   0x02, 0x03, 0x05, 0x00, 0x04, 0x40
 };
 
+//
+// Number of pre-processed keys cached by RsaVerifySigDataFromData.
+// Certificate chains are verified with few distinct keys, most recently
+// used keys are kept at the beginning. Keys stay allocated until
+// RsaFreeKeyCache is called, which bounds the cache to this many keys.
+//
+#define OC_RSA_KEY_CACHE_SIZE  4
+
+STATIC OC_RSA_PROCESSED_KEY  *mRsaKeyCache[OC_RSA_KEY_CACHE_SIZE];
+
 /**
   Returns whether the RSA modulus size is allowed.
 
@@ -464,6 +474,203 @@ RsaVerifySigDataFromProcessed (
            );
 }
 
+OC_RSA_PROCESSED_KEY *
+RsaProcessPublicKey (
+  IN CONST UINT8  *Modulus,
+  IN UINTN        ModulusSize,
+  IN UINT32       Exponent
+  )
+{
+  UINTN                 ModulusNumWordsTmp;
+  OC_BN_NUM_WORDS       ModulusNumWords;
+  OC_RSA_PROCESSED_KEY  *Key;
+
+  ASSERT (Modulus != NULL);
+  ASSERT (ModulusSize > 0);
+
+  STATIC_ASSERT (
+    sizeof (OC_BN_WORD) == sizeof (Key->Data[0]),
+    "The key layout must match BIGNUM words."
+    );
+
+  ModulusNumWordsTmp = ModulusSize / OC_BN_WORD_SIZE;
+  if (Exponent < 3
+   || (Exponent & 1U) == 0
+   || ModulusNumWordsTmp == 0
+   || ModulusNumWordsTmp > OC_BN_MAX_LEN
+   || (ModulusSize % OC_BN_WORD_SIZE) != 0) {
+    return NULL;
+  }
+
+  ModulusNumWords = (OC_BN_NUM_WORDS)ModulusNumWordsTmp;
+
+  STATIC_ASSERT (
+    OC_BN_MAX_SIZE <= (MAX_UINTN - sizeof (OC_RSA_PROCESSED_KEY)) / 2,
+    "An overflow verification must be added"
+    );
+
+  Key = AllocatePool (sizeof (*Key) + 2 * ModulusSize);
+  if (Key == NULL) {
+    return NULL;
+  }
+
+  Key->NumWords = ModulusNumWords;
+  Key->Exponent = Exponent;
+
+  BigNumParseBuffer (Key->Data, ModulusNumWords, Modulus, ModulusSize);
+
+  Key->N0Inv = BigNumCalculateMontParams (
+                 &Key->Data[ModulusNumWords],
+                 ModulusNumWords,
+                 Key->Data
+                 );
+  if (Key->N0Inv == 0) {
+    FreePool (Key);
+    return NULL;
+  }
+
+  return Key;
+}
+
+BOOLEAN
+RsaVerifySigHashFromProcessedKey (
+  IN CONST OC_RSA_PROCESSED_KEY  *Key,
+  IN CONST UINT8                 *Signature,
+  IN UINTN                       SignatureSize,
+  IN CONST UINT8                 *Hash,
+  IN UINTN                       HashSize,
+  IN OC_SIG_HASH_TYPE            Algorithm
+  )
+{
+  ASSERT (Key != NULL);
+
+  return RsaVerifySigHashFromProcessed (
+           Key->Data,
+           Key->NumWords,
+           Key->N0Inv,
+           &Key->Data[Key->NumWords],
+           Key->Exponent,
+           Signature,
+           SignatureSize,
+           Hash,
+           HashSize,
+           Algorithm
+           );
+}
+
+BOOLEAN
+RsaVerifySigDataFromProcessedKey (
+  IN CONST OC_RSA_PROCESSED_KEY  *Key,
+  IN CONST UINT8                 *Signature,
+  IN UINTN                       SignatureSize,
+  IN CONST UINT8                 *Data,
+  IN UINTN                       DataSize,
+  IN OC_SIG_HASH_TYPE            Algorithm
+  )
+{
+  ASSERT (Key != NULL);
+
+  return RsaVerifySigDataFromProcessed (
+           Key->Data,
+           Key->NumWords,
+           Key->N0Inv,
+           &Key->Data[Key->NumWords],
+           Key->Exponent,
+           Signature,
+           SignatureSize,
+           Data,
+           DataSize,
+           Algorithm
+           );
+}
+
+/**
+  Get a pre-processed key for Modulus and Exponent from the key cache,
+  processing and caching it on miss.
+
+  @param[in] Modulus      The RSA modulus byte array.
+  @param[in] ModulusSize  The size, in bytes, of Modulus.
+  @param[in] Exponent     The RSA exponent.
+
+  @returns  Pre-processed key owned by the cache or NULL.
+
+**/
+STATIC
+CONST OC_RSA_PROCESSED_KEY *
+InternalRsaGetCachedKey (
+  IN CONST UINT8  *Modulus,
+  IN UINTN        ModulusSize,
+  IN UINT32       Exponent
+  )
+{
+  OC_RSA_PROCESSED_KEY  *Key;
+  OC_BN_WORD            *N;
+  UINTN                 NumWords;
+  UINTN                 Index;
+
+  NumWords = ModulusSize / OC_BN_WORD_SIZE;
+  if (NumWords == 0
+   || NumWords > OC_BN_MAX_LEN
+   || (ModulusSize % OC_BN_WORD_SIZE) != 0) {
+    return NULL;
+  }
+
+  N = AllocatePool (ModulusSize);
+  if (N == NULL) {
+    return NULL;
+  }
+
+  BigNumParseBuffer (N, (OC_BN_NUM_WORDS)NumWords, Modulus, ModulusSize);
+
+  Key = NULL;
+  for (Index = 0; Index < OC_RSA_KEY_CACHE_SIZE && mRsaKeyCache[Index] != NULL; ++Index) {
+    if (mRsaKeyCache[Index]->NumWords == NumWords
+      && mRsaKeyCache[Index]->Exponent == Exponent
+      && CompareMem (mRsaKeyCache[Index]->Data, N, ModulusSize) == 0) {
+      Key = mRsaKeyCache[Index];
+      break;
+    }
+  }
+
+  FreePool (N);
+
+  if (Key == NULL) {
+    Key = RsaProcessPublicKey (Modulus, ModulusSize, Exponent);
+    if (Key == NULL) {
+      return NULL;
+    }
+    //
+    // Evict the least recently used key.
+    //
+    Index = OC_RSA_KEY_CACHE_SIZE - 1;
+    if (mRsaKeyCache[Index] != NULL) {
+      FreePool (mRsaKeyCache[Index]);
+    }
+  }
+  //
+  // Move the key to the beginning.
+  //
+  for (; Index > 0; --Index) {
+    mRsaKeyCache[Index] = mRsaKeyCache[Index - 1];
+  }
+
+  mRsaKeyCache[0] = Key;
+  return Key;
+}
+
+VOID
+RsaFreeKeyCache (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < OC_RSA_KEY_CACHE_SIZE && mRsaKeyCache[Index] != NULL; ++Index) {
+    FreePool (mRsaKeyCache[Index]);
+    mRsaKeyCache[Index] = NULL;
+  }
+}
+
 BOOLEAN
 RsaVerifySigDataFromData (
   IN CONST UINT8       *Modulus,
@@ -476,15 +683,7 @@ RsaVerifySigDataFromData (
   IN OC_SIG_HASH_TYPE  Algorithm
   )
 {
-  UINTN           ModulusNumWordsTmp;
-  OC_BN_NUM_WORDS ModulusNumWords;
-
-  VOID            *Memory;
-  OC_BN_WORD      *N;
-  OC_BN_WORD      *RSqrMod;
-
-  OC_BN_WORD      N0Inv;
-  BOOLEAN         Result;
+  CONST OC_RSA_PROCESSED_KEY  *Key;
 
   ASSERT (Modulus != NULL);
   ASSERT (ModulusSize > 0);
@@ -494,50 +693,19 @@ RsaVerifySigDataFromData (
   ASSERT (Data != NULL);
   ASSERT (DataSize > 0);
 
-  ModulusNumWordsTmp = ModulusSize / OC_BN_WORD_SIZE;
-  if (ModulusNumWordsTmp > OC_BN_MAX_LEN
-   || (ModulusSize % OC_BN_WORD_SIZE) != 0) {
-    return FALSE;
-  }
-
-  ModulusNumWords = (OC_BN_NUM_WORDS)ModulusNumWordsTmp;
-
-  STATIC_ASSERT (
-    OC_BN_MAX_SIZE <= MAX_UINTN / 2,
-    "An overflow verification must be added"
-    );
-
-  Memory = AllocatePool (2 * ModulusSize);
-  if (Memory == NULL) {
+  Key = InternalRsaGetCachedKey (Modulus, ModulusSize, Exponent);
+  if (Key == NULL) {
     return FALSE;
   }
 
-  N       = (OC_BN_WORD *)Memory;
-  RSqrMod = (OC_BN_WORD *)((UINTN)N + ModulusSize);
-
-  BigNumParseBuffer (N, ModulusNumWords, Modulus, ModulusSize);
-
-  N0Inv = BigNumCalculateMontParams (RSqrMod, ModulusNumWords, N);
-  if (N0Inv == 0) {
-    FreePool (Memory);
-    return FALSE;
-  }
-
-  Result = RsaVerifySigDataFromProcessed (
-             N,
-             ModulusNumWords,
-             N0Inv,
-             RSqrMod,
-             Exponent,
-             Signature,
-             SignatureSize,
-             Data,
-             DataSize,
-             Algorithm
-             );
-
-  FreePool (Memory);
-  return Result;
+  return RsaVerifySigDataFromProcessedKey (
+           Key,
+           Signature,
+           SignatureSize,
+           Data,
+           DataSize,
+           Algorithm
+           );
 }
 
 BOOLEAN
@@ -37,6 +37,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <Library/OcCryptoLib.h>
 
+#include "Sha2Internal.h"
+
 
 #define UNPACK64(x, str)                         \
   do {                                           \
@@ -93,7 +95,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 
 
-STATIC CONST UINT32 SHA256_K[64] = {
+CONST UINT32 SHA256_K[64] = {
   0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
   0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
   0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
@@ -105,7 +107,7 @@ STATIC CONST UINT32 SHA256_K[64] = {
 };
 
 
-STATIC UINT64 SHA512_K[80] = {
+CONST UINT64 SHA512_K[80] = {
   0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
   0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
   0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
@@ -163,6 +165,41 @@ STATIC CONST UINT64 SHA512_H0[8] = {
   0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
 };
 
+//
+// Block function implementations, selected on first use.
+//
+STATIC BOOLEAN                 mSha2ImplementationSet;
+STATIC OC_SHA2_IMPLEMENTATION  mSha256Implementation;
+STATIC OC_SHA2_IMPLEMENTATION  mSha512Implementation;
+
+OC_SHA2_IMPLEMENTATION
+OcSha2SetImplementation (
+  IN OC_SHA2_IMPLEMENTATION  Implementation
+  )
+{
+  UINT32  Supported;
+
+  Supported = InternalSha2GetSupportedImplementations ();
+
+  if (Implementation == OcSha2ImplementationShaNi
+    && (Supported & (1U << OcSha2ImplementationShaNi)) == 0) {
+    Implementation = OcSha2ImplementationAvx2;
+  }
+
+  if (Implementation == OcSha2ImplementationAvx2
+    && (Supported & (1U << OcSha2ImplementationAvx2)) == 0) {
+    Implementation = OcSha2ImplementationGeneric;
+  }
+
+  mSha256Implementation = Implementation;
+  mSha512Implementation = Implementation == OcSha2ImplementationGeneric
+    || (Supported & (1U << OcSha2ImplementationAvx2)) == 0
+    ? OcSha2ImplementationGeneric : OcSha2ImplementationAvx2;
+  mSha2ImplementationSet = TRUE;
+
+  return mSha256Implementation;
+}
+
 //
 // Sha 256 functions
 //
@@ -219,6 +256,40 @@ Sha256Transform (
   Context->State[7] += H;
 }
 
+STATIC
+VOID
+Sha256Blocks (
+  SHA256_CONTEXT  *Context,
+  CONST UINT8     *Data,
+  UINTN           BlockNb
+  )
+{
+#ifdef OC_CRYPTO_SHA2_ACCEL
+  UINTN  Processed;
+
+  if (!mSha2ImplementationSet) {
+    OcSha2SetImplementation (OcSha2ImplementationShaNi);
+  }
+
+  if (mSha256Implementation == OcSha2ImplementationShaNi) {
+    InternalSha256BlocksShaNi (Context->State, Data, BlockNb);
+    return;
+  }
+
+  if (mSha256Implementation == OcSha2ImplementationAvx2) {
+    Processed = InternalSha256BlocksAvx2 (Context->State, Data, BlockNb);
+    Data     += Processed * SHA256_BLOCK_SIZE;
+    BlockNb  -= Processed;
+  }
+#endif
+
+  while (BlockNb > 0) {
+    Sha256Transform (Context, Data);
+    Data += SHA256_BLOCK_SIZE;
+    --BlockNb;
+  }
+}
+
 VOID
 Sha256Init (
   SHA256_CONTEXT *Context
@@ -239,17 +310,41 @@ Sha256Update (
   UINTN          Len
   )
 {
-  UINT32 Index;
-
-  for (Index = 0; Index < Len; ++Index) {
-    Context->Data[Context->DataLen] = Data[Index];
-    Context->DataLen++;
-    if (Context->DataLen == 64) {
-      Sha256Transform (Context, Context->Data);
-      Context->BitLen += 512;
-      Context->DataLen = 0;
+  UINTN  CopyLen;
+  UINTN  BlockNb;
+
+  //
+  // Complete the buffered block first.
+  //
+  if (Context->DataLen > 0) {
+    CopyLen = MIN (Len, SHA256_BLOCK_SIZE - Context->DataLen);
+    CopyMem (&Context->Data[Context->DataLen], Data, CopyLen);
+    Context->DataLen += (UINT32) CopyLen;
+    Data += CopyLen;
+    Len  -= CopyLen;
+
+    if (Context->DataLen < SHA256_BLOCK_SIZE) {
+      return;
     }
+
+    Sha256Blocks (Context, Context->Data, 1);
+    Context->BitLen += 512;
+    Context->DataLen = 0;
+  }
+
+  //
+  // Process whole blocks in place, so that block functions see all of them at once.
+  //
+  BlockNb = Len / SHA256_BLOCK_SIZE;
+  if (BlockNb > 0) {
+    Sha256Blocks (Context, Data, BlockNb);
+    Context->BitLen += LShiftU64 (BlockNb, 9);
+    Data += BlockNb * SHA256_BLOCK_SIZE;
+    Len  -= BlockNb * SHA256_BLOCK_SIZE;
   }
+
+  CopyMem (Context->Data, Data, Len);
+  Context->DataLen = (UINT32) Len;
 }
 
 VOID
@@ -271,7 +366,7 @@ Sha256Final (
   } else {
     Context->Data[Index++] = 0x80;
     ZeroMem (Context->Data + Index, 64-Index);
-    Sha256Transform (Context, Context->Data);
+    Sha256Blocks (Context, Context->Data, 1);
     ZeroMem (Context->Data, 56);
   }
 
@@ -287,7 +382,7 @@ Sha256Final (
   Context->Data[58] = (UINT8) (Context->BitLen >> 40);
   Context->Data[57] = (UINT8) (Context->BitLen >> 48);
   Context->Data[56] = (UINT8) (Context->BitLen >> 56);
-  Sha256Transform (Context, Context->Data);
+  Sha256Blocks (Context, Context->Data, 1);
 
   //
   // Since this implementation uses little endian byte ordering and SHA uses big endian,
@@ -338,6 +433,19 @@ Sha512Transform (
   CONST UINT8  *SubBlock;
   UINTN        Index1;
   UINTN        Index2;
+#ifdef OC_CRYPTO_SHA2_ACCEL
+  UINTN        Processed;
+
+  if (!mSha2ImplementationSet) {
+    OcSha2SetImplementation (OcSha2ImplementationShaNi);
+  }
+
+  if (mSha512Implementation == OcSha2ImplementationAvx2) {
+    Processed = InternalSha512BlocksAvx2 (Context->State, Data, BlockNb);
+    Data     += Processed * SHA512_BLOCK_SIZE;
+    BlockNb  -= Processed;
+  }
+#endif
 
   for (Index1 = 0; Index1 < BlockNb; ++Index1) {
     SubBlock = Data + (Index1 << 7);
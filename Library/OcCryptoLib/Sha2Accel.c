@@ -0,0 +1,376 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+/**
+  SHA-2 block functions using SHA extensions and AVX2.
+
+  These functions are only called after InternalSha2GetSupportedImplementations
+  confirmed that the CPU supports the instructions and that the firmware enabled
+  the corresponding register state in XCR0. UEFI X64 requires SSE state to be
+  available to drivers, and XMM registers preserved across calls are saved by the
+  compiler according to the calling convention. YMM upper halves are not preserved
+  by any UEFI calling convention, so AVX2 functions only clear them on exit to
+  avoid SSE transition penalties in the callers.
+**/
+
+#ifdef EFIAPI
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#endif
+
+#include <IndustryStandard/CpuId.h>
+
+#include "Sha2Internal.h"
+
+#ifdef OC_CRYPTO_SHA2_ACCEL
+
+//
+// Intrinsic headers try to pull mm_malloc.h, which depends on hosted stdlib.h.
+//
+#define _MM_MALLOC_H_INCLUDED
+#define __MM_MALLOC_H
+#include <immintrin.h>
+
+#define SHA256_NI_ROUNDS(Msg, Index)                                             \
+  do {                                                                           \
+    Tmp    = _mm_add_epi32 ((Msg), _mm_loadu_si128 ((CONST __m128i *) &SHA256_K[Index])); \
+    State1 = _mm_sha256rnds2_epu32 (State1, State0, Tmp);                        \
+    Tmp    = _mm_shuffle_epi32 (Tmp, 0x0E);                                      \
+    State0 = _mm_sha256rnds2_epu32 (State0, State1, Tmp);                        \
+  } while (0)
+
+//
+// Computes the next 4 message words into Q0 from the previous 16 words in Q0-Q3.
+//
+#define SHA256_NI_SCHEDULE(Q0, Q1, Q2, Q3)                                       \
+  do {                                                                           \
+    (Q0) = _mm_sha256msg2_epu32 (                                                \
+      _mm_add_epi32 (_mm_sha256msg1_epu32 ((Q0), (Q1)), _mm_alignr_epi8 ((Q3), (Q2), 4)), \
+      (Q3)                                                                       \
+      );                                                                         \
+  } while (0)
+
+#define SHA256_AVX2_ROR(X, N) \
+  _mm256_or_si256 (_mm256_srli_epi32 ((X), (N)), _mm256_slli_epi32 ((X), 32 - (N)))
+#define SHA256_AVX2_SIG0(X) \
+  _mm256_xor_si256 (_mm256_xor_si256 (SHA256_AVX2_ROR (X, 7), SHA256_AVX2_ROR (X, 18)), _mm256_srli_epi32 ((X), 3))
+#define SHA256_AVX2_SIG1(X) \
+  _mm256_xor_si256 (_mm256_xor_si256 (SHA256_AVX2_ROR (X, 17), SHA256_AVX2_ROR (X, 19)), _mm256_srli_epi32 ((X), 10))
+
+#define SHA512_AVX2_ROR(X, N) \
+  _mm256_or_si256 (_mm256_srli_epi64 ((X), (N)), _mm256_slli_epi64 ((X), 64 - (N)))
+#define SHA512_AVX2_SIG0(X) \
+  _mm256_xor_si256 (_mm256_xor_si256 (SHA512_AVX2_ROR (X, 1), SHA512_AVX2_ROR (X, 8)), _mm256_srli_epi64 ((X), 7))
+#define SHA512_AVX2_SIG1(X) \
+  _mm256_xor_si256 (_mm256_xor_si256 (SHA512_AVX2_ROR (X, 19), SHA512_AVX2_ROR (X, 61)), _mm256_srli_epi64 ((X), 6))
+
+#define SHA2_ROR32(X, N) (((X) >> (N)) | ((X) << (32 - (N))))
+#define SHA2_ROR64(X, N) (((X) >> (N)) | ((X) << (64 - (N))))
+#define SHA2_CH(X, Y, Z)  (((X) & (Y)) ^ (~(X) & (Z)))
+#define SHA2_MAJ(X, Y, Z) (((X) & (Y)) ^ ((X) & (Z)) ^ ((Y) & (Z)))
+
+//
+// Low 32 bits of XCR0.
+//
+STATIC
+UINT32
+InternalXGetBv0 (
+  VOID
+  )
+{
+  UINT32  Eax;
+  UINT32  Edx;
+
+  __asm__ __volatile__ ("xgetbv" : "=a" (Eax), "=d" (Edx) : "c" (0));
+  return Eax;
+}
+
+__attribute__ ((target ("sha,sse4.1,ssse3")))
+VOID
+InternalSha256BlocksShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  __m128i  State0;
+  __m128i  State1;
+  __m128i  Tmp;
+  __m128i  Msg0;
+  __m128i  Msg1;
+  __m128i  Msg2;
+  __m128i  Msg3;
+  __m128i  Abef;
+  __m128i  Cdgh;
+  __m128i  Mask;
+  UINTN    Index;
+
+  Mask = _mm_set_epi64x (0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+  //
+  // SHA-NI operates on ABEF and CDGH register halves.
+  //
+  Tmp    = _mm_loadu_si128 ((CONST __m128i *) &State[0]);
+  State1 = _mm_loadu_si128 ((CONST __m128i *) &State[4]);
+  Tmp    = _mm_shuffle_epi32 (Tmp, 0xB1);
+  State1 = _mm_shuffle_epi32 (State1, 0x1B);
+  State0 = _mm_alignr_epi8 (Tmp, State1, 8);
+  State1 = _mm_blend_epi16 (State1, Tmp, 0xF0);
+
+  while (BlockNb > 0) {
+    Abef = State0;
+    Cdgh = State1;
+
+    Msg0 = _mm_shuffle_epi8 (_mm_loadu_si128 ((CONST __m128i *) &Data[0]), Mask);
+    Msg1 = _mm_shuffle_epi8 (_mm_loadu_si128 ((CONST __m128i *) &Data[16]), Mask);
+    Msg2 = _mm_shuffle_epi8 (_mm_loadu_si128 ((CONST __m128i *) &Data[32]), Mask);
+    Msg3 = _mm_shuffle_epi8 (_mm_loadu_si128 ((CONST __m128i *) &Data[48]), Mask);
+
+    SHA256_NI_ROUNDS (Msg0, 0);
+    SHA256_NI_ROUNDS (Msg1, 4);
+    SHA256_NI_ROUNDS (Msg2, 8);
+    SHA256_NI_ROUNDS (Msg3, 12);
+
+    for (Index = 16; Index < 64; Index += 16) {
+      SHA256_NI_SCHEDULE (Msg0, Msg1, Msg2, Msg3);
+      SHA256_NI_ROUNDS (Msg0, Index);
+      SHA256_NI_SCHEDULE (Msg1, Msg2, Msg3, Msg0);
+      SHA256_NI_ROUNDS (Msg1, Index + 4);
+      SHA256_NI_SCHEDULE (Msg2, Msg3, Msg0, Msg1);
+      SHA256_NI_ROUNDS (Msg2, Index + 8);
+      SHA256_NI_SCHEDULE (Msg3, Msg0, Msg1, Msg2);
+      SHA256_NI_ROUNDS (Msg3, Index + 12);
+    }
+
+    State0 = _mm_add_epi32 (State0, Abef);
+    State1 = _mm_add_epi32 (State1, Cdgh);
+
+    Data += SHA256_BLOCK_SIZE;
+    --BlockNb;
+  }
+
+  Tmp    = _mm_shuffle_epi32 (State0, 0x1B);
+  State1 = _mm_shuffle_epi32 (State1, 0xB1);
+  State0 = _mm_blend_epi16 (Tmp, State1, 0xF0);
+  State1 = _mm_alignr_epi8 (State1, Tmp, 8);
+
+  _mm_storeu_si128 ((__m128i *) &State[0], State0);
+  _mm_storeu_si128 ((__m128i *) &State[4], State1);
+}
+
+__attribute__ ((target ("avx2,bmi2")))
+UINTN
+InternalSha256BlocksAvx2 (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  __m256i  W[64];
+  __m256i  Offsets;
+  __m256i  Swap;
+  UINT32   Wv[8];
+  UINT32   T1;
+  UINT32   T2;
+  UINTN    Processed;
+  UINTN    Index;
+  UINTN    Lane;
+
+  //
+  // Lane N holds message words of block N.
+  //
+  Offsets = _mm256_setr_epi32 (0, 16, 32, 48, 64, 80, 96, 112);
+  Swap    = _mm256_setr_epi8 (
+              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+              3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+              );
+
+  for (Processed = 0; BlockNb - Processed >= SHA256_AVX2_BLOCKS; Processed += SHA256_AVX2_BLOCKS) {
+    for (Index = 0; Index < 16; ++Index) {
+      W[Index] = _mm256_shuffle_epi8 (
+                   _mm256_i32gather_epi32 ((CONST VOID *) &Data[Index * sizeof (UINT32)], Offsets, 4),
+                   Swap
+                   );
+    }
+
+    for (Index = 16; Index < 64; ++Index) {
+      W[Index] = _mm256_add_epi32 (
+                   _mm256_add_epi32 (SHA256_AVX2_SIG1 (W[Index - 2]), W[Index - 7]),
+                   _mm256_add_epi32 (SHA256_AVX2_SIG0 (W[Index - 15]), W[Index - 16])
+                   );
+    }
+
+    for (Index = 0; Index < 64; ++Index) {
+      W[Index] = _mm256_add_epi32 (W[Index], _mm256_set1_epi32 ((INT32) SHA256_K[Index]));
+    }
+
+    //
+    // Blocks are chained, so compression runs lane by lane.
+    //
+    for (Lane = 0; Lane < SHA256_AVX2_BLOCKS; ++Lane) {
+      for (Index = 0; Index < 8; ++Index) {
+        Wv[Index] = State[Index];
+      }
+
+      for (Index = 0; Index < 64; ++Index) {
+        T1 = Wv[7] + (SHA2_ROR32 (Wv[4], 6) ^ SHA2_ROR32 (Wv[4], 11) ^ SHA2_ROR32 (Wv[4], 25))
+          + SHA2_CH (Wv[4], Wv[5], Wv[6]) + ((CONST UINT32 *) &W[Index])[Lane];
+        T2 = (SHA2_ROR32 (Wv[0], 2) ^ SHA2_ROR32 (Wv[0], 13) ^ SHA2_ROR32 (Wv[0], 22))
+          + SHA2_MAJ (Wv[0], Wv[1], Wv[2]);
+        Wv[7] = Wv[6];
+        Wv[6] = Wv[5];
+        Wv[5] = Wv[4];
+        Wv[4] = Wv[3] + T1;
+        Wv[3] = Wv[2];
+        Wv[2] = Wv[1];
+        Wv[1] = Wv[0];
+        Wv[0] = T1 + T2;
+      }
+
+      for (Index = 0; Index < 8; ++Index) {
+        State[Index] += Wv[Index];
+      }
+    }
+
+    Data += SHA256_AVX2_BLOCKS * SHA256_BLOCK_SIZE;
+  }
+
+  _mm256_zeroupper ();
+
+  return Processed;
+}
+
+__attribute__ ((target ("avx2,bmi2")))
+UINTN
+InternalSha512BlocksAvx2 (
+  IN OUT UINT64       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  )
+{
+  __m256i  W[80];
+  __m256i  Offsets;
+  __m256i  Swap;
+  UINT64   Wv[8];
+  UINT64   T1;
+  UINT64   T2;
+  UINTN    Processed;
+  UINTN    Index;
+  UINTN    Lane;
+
+  Offsets = _mm256_setr_epi64x (0, 16, 32, 48);
+  Swap    = _mm256_setr_epi8 (
+              7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+              7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+              );
+
+  for (Processed = 0; BlockNb - Processed >= SHA512_AVX2_BLOCKS; Processed += SHA512_AVX2_BLOCKS) {
+    for (Index = 0; Index < 16; ++Index) {
+      W[Index] = _mm256_shuffle_epi8 (
+                   _mm256_i64gather_epi64 ((CONST VOID *) &Data[Index * sizeof (UINT64)], Offsets, 8),
+                   Swap
+                   );
+    }
+
+    for (Index = 16; Index < 80; ++Index) {
+      W[Index] = _mm256_add_epi64 (
+                   _mm256_add_epi64 (SHA512_AVX2_SIG1 (W[Index - 2]), W[Index - 7]),
+                   _mm256_add_epi64 (SHA512_AVX2_SIG0 (W[Index - 15]), W[Index - 16])
+                   );
+    }
+
+    for (Index = 0; Index < 80; ++Index) {
+      W[Index] = _mm256_add_epi64 (W[Index], _mm256_set1_epi64x ((INT64) SHA512_K[Index]));
+    }
+
+    for (Lane = 0; Lane < SHA512_AVX2_BLOCKS; ++Lane) {
+      for (Index = 0; Index < 8; ++Index) {
+        Wv[Index] = State[Index];
+      }
+
+      for (Index = 0; Index < 80; ++Index) {
+        T1 = Wv[7] + (SHA2_ROR64 (Wv[4], 14) ^ SHA2_ROR64 (Wv[4], 18) ^ SHA2_ROR64 (Wv[4], 41))
+          + SHA2_CH (Wv[4], Wv[5], Wv[6]) + ((CONST UINT64 *) &W[Index])[Lane];
+        T2 = (SHA2_ROR64 (Wv[0], 28) ^ SHA2_ROR64 (Wv[0], 34) ^ SHA2_ROR64 (Wv[0], 39))
+          + SHA2_MAJ (Wv[0], Wv[1], Wv[2]);
+        Wv[7] = Wv[6];
+        Wv[6] = Wv[5];
+        Wv[5] = Wv[4];
+        Wv[4] = Wv[3] + T1;
+        Wv[3] = Wv[2];
+        Wv[2] = Wv[1];
+        Wv[1] = Wv[0];
+        Wv[0] = T1 + T2;
+      }
+
+      for (Index = 0; Index < 8; ++Index) {
+        State[Index] += Wv[Index];
+      }
+    }
+
+    Data += SHA512_AVX2_BLOCKS * SHA512_BLOCK_SIZE;
+  }
+
+  _mm256_zeroupper ();
+
+  return Processed;
+}
+
+#endif // OC_CRYPTO_SHA2_ACCEL
+
+UINT32
+InternalSha2GetSupportedImplementations (
+  VOID
+  )
+{
+  UINT32  Supported;
+#ifdef OC_CRYPTO_SHA2_ACCEL
+  UINT32  MaxLeaf;
+  UINT32  FeaturesEcx;
+  UINT32  FeaturesEdx;
+  UINT32  Leaf7Ebx;
+  UINT64  Features;
+  UINT32  Xcr0;
+#endif
+
+  Supported = 1U << OcSha2ImplementationGeneric;
+
+#ifdef OC_CRYPTO_SHA2_ACCEL
+  AsmCpuid (CPUID_SIGNATURE, &MaxLeaf, NULL, NULL, NULL);
+  if (MaxLeaf < CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS) {
+    return Supported;
+  }
+
+  AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &FeaturesEcx, &FeaturesEdx);
+  AsmCpuidEx (CPUID_STRUCTURED_EXTENDED_FEATURE_FLAGS, 0, NULL, &Leaf7Ebx, NULL, NULL);
+  Features = LShiftU64 (FeaturesEcx, 32) | FeaturesEdx;
+
+  if ((Leaf7Ebx & CPUID_LEAF7_FEATURE_SHA) != 0
+    && (Features & (CPUID_FEATURE_SSSE3 | CPUID_FEATURE_SSE4_1)) == (CPUID_FEATURE_SSSE3 | CPUID_FEATURE_SSE4_1)) {
+    Supported |= 1U << OcSha2ImplementationShaNi;
+  }
+
+  //
+  // AVX2 may only be used when the firmware enabled YMM state, otherwise it raises #UD.
+  //
+  if ((Leaf7Ebx & (CPUID_LEAF7_FEATURE_AVX2 | CPUID_LEAF7_FEATURE_BMI2))
+      == (CPUID_LEAF7_FEATURE_AVX2 | CPUID_LEAF7_FEATURE_BMI2)
+    && (Features & CPUID_FEATURE_OSXSAVE) != 0) {
+    Xcr0 = InternalXGetBv0 ();
+    if ((Xcr0 & (XCR0_SSE_STATE | XCR0_AVX_STATE)) == (XCR0_SSE_STATE | XCR0_AVX_STATE)) {
+      Supported |= 1U << OcSha2ImplementationAvx2;
+    }
+  }
+#endif
+
+  return Supported;
+}
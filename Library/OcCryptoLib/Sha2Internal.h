@@ -0,0 +1,98 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#ifndef SHA2_INTERNAL_H
+#define SHA2_INTERNAL_H
+
+#include <Library/OcCryptoLib.h>
+
+//
+// Accelerated block functions need per-function target attributes and
+// compiler intrinsics, which are only used with GCC-compatible X64 compilers.
+//
+#if defined (MDE_CPU_X64) && defined (__GNUC__)
+#define OC_CRYPTO_SHA2_ACCEL
+#endif
+
+//
+// Number of blocks processed at once by AVX2 block functions.
+//
+#define SHA256_AVX2_BLOCKS  8
+#define SHA512_AVX2_BLOCKS  4
+
+extern CONST UINT32 SHA256_K[64];
+extern CONST UINT64 SHA512_K[80];
+
+/**
+  Detect SHA-2 implementations supported by the CPU and enabled by the firmware.
+
+  @retval Bitmask of supported OC_SHA2_IMPLEMENTATION values, always containing
+          OcSha2ImplementationGeneric.
+**/
+UINT32
+InternalSha2GetSupportedImplementations (
+  VOID
+  );
+
+#ifdef OC_CRYPTO_SHA2_ACCEL
+
+/**
+  Process SHA-256 blocks with SHA extensions.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Number of 64-byte blocks in Data.
+**/
+VOID
+InternalSha256BlocksShaNi (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
+
+/**
+  Process SHA-256 blocks with AVX2 message schedule for SHA256_AVX2_BLOCKS
+  blocks at a time. Remaining blocks are left for the caller.
+
+  @param[in,out] State    SHA-256 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Number of 64-byte blocks in Data.
+
+  @retval Number of processed blocks.
+**/
+UINTN
+InternalSha256BlocksAvx2 (
+  IN OUT UINT32       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
+
+/**
+  Process SHA-512 blocks with AVX2 message schedule for SHA512_AVX2_BLOCKS
+  blocks at a time. Remaining blocks are left for the caller.
+
+  @param[in,out] State    SHA-512 state.
+  @param[in]     Data     Message blocks.
+  @param[in]     BlockNb  Number of 128-byte blocks in Data.
+
+  @retval Number of processed blocks.
+**/
+UINTN
+InternalSha512BlocksAvx2 (
+  IN OUT UINT64       *State,
+  IN     CONST UINT8  *Data,
+  IN     UINTN        BlockNb
+  );
+
+#endif // OC_CRYPTO_SHA2_ACCEL
+
+#endif // SHA2_INTERNAL_H
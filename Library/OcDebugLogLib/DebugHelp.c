@@ -13,12 +13,28 @@
 **/
 
 #include <Uefi.h>
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/OcDebugLogLib.h>
 #include <Library/OcMiscLib.h>
 
+#include "OcLogInternal.h"
+
+//
+// Spans finished before OcLog protocol is installed.
+//
+#define OC_LOG_MAX_PENDING_SPANS  8
+
+typedef struct {
+  OC_LOG_SPAN  Span;
+  UINT64       EndTsc;
+} OC_LOG_PENDING_SPAN;
+
+STATIC OC_LOG_PENDING_SPAN  mPendingSpans[OC_LOG_MAX_PENDING_SPANS];
+STATIC UINT32               mPendingSpanCount;
+
 VOID
 #if defined(__GNUC__) || defined(__clang__)
 __attribute__ ((noinline))
@@ -63,3 +79,83 @@ WaitForKeyPress (
     DebugBreak ();
   }
 }
+
+/**
+  Submit spans finished before OcLog protocol was installed.
+
+  @param[in] OcLog  OcLog protocol.
+**/
+STATIC
+VOID
+SubmitPendingSpans (
+  IN OC_LOG_PROTOCOL  *OcLog
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < mPendingSpanCount; ++Index) {
+    OcLog->AddSpan (
+      OcLog,
+      mPendingSpans[Index].Span.Name,
+      mPendingSpans[Index].Span.StartTsc,
+      mPendingSpans[Index].EndTsc
+      );
+  }
+  mPendingSpanCount = 0;
+}
+
+VOID
+OcLogSpanBegin (
+  OUT OC_LOG_SPAN  *Span,
+  IN  CONST CHAR8  *Name
+  )
+{
+  Span->Name     = Name;
+  Span->StartTsc = AsmReadTsc ();
+}
+
+VOID
+OcLogSpanEnd (
+  IN CONST OC_LOG_SPAN  *Span
+  )
+{
+  UINT64           EndTsc;
+  OC_LOG_PROTOCOL  *OcLog;
+
+  EndTsc = AsmReadTsc ();
+  OcLog  = InternalGetOcLog ();
+
+  if (OcLog == NULL) {
+    //
+    // Storage and configuration are loaded before logging is configured.
+    //
+    if (mPendingSpanCount < OC_LOG_MAX_PENDING_SPANS) {
+      mPendingSpans[mPendingSpanCount].Span.Name     = Span->Name;
+      mPendingSpans[mPendingSpanCount].Span.StartTsc = Span->StartTsc;
+      mPendingSpans[mPendingSpanCount].EndTsc        = EndTsc;
+      ++mPendingSpanCount;
+    }
+    return;
+  }
+
+  SubmitPendingSpans (OcLog);
+
+  OcLog->AddSpan (OcLog, Span->Name, Span->StartTsc, EndTsc);
+}
+
+VOID
+OcLogFlush (
+  VOID
+  )
+{
+  OC_LOG_PROTOCOL  *OcLog;
+
+  OcLog = InternalGetOcLog ();
+  if (OcLog == NULL) {
+    return;
+  }
+
+  SubmitPendingSpans (OcLog);
+
+  OcLog->SaveLog (OcLog, 0, NULL);
+}
@@ -31,6 +31,7 @@
 #include <Library/OcStringLib.h>
 #include <Library/OcTimerLib.h>
 #include <Library/SerialPortLib.h>
+#include <Library/SynchronizationLib.h>
 #include <Library/UefiLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
@@ -40,7 +41,8 @@
 STATIC
 CHAR8 *
 GetTiming  (
-  IN OC_LOG_PROTOCOL  *This
+  IN OC_LOG_PROTOCOL  *This,
+  IN UINT64           Tsc
   )
 {
   OC_LOG_PRIVATE_DATA *Private = NULL;
@@ -65,15 +67,17 @@ GetTiming  (
     Private->TscFrequency = OcGetTSCFrequency ();
 
     if (Private->TscFrequency != 0) {
-      CurrentTsc = AsmReadTsc ();
-
-      Private->TscStart = CurrentTsc;
-      Private->TscLast  = CurrentTsc;
+      Private->TscStart = Tsc;
+      Private->TscLast  = Tsc;
     }
   }
 
   if (Private->TscFrequency > 0) {
-    CurrentTsc = AsmReadTsc ();
+    //
+    // Entries recorded into the ring may be written after newer entries
+    // when draining is interrupted.
+    //
+    CurrentTsc = MAX (Tsc, Private->TscLast);
 
     dTStartMs  = DivU64x64Remainder (MultU64x32 (CurrentTsc - Private->TscStart, 1000), Private->TscFrequency, NULL);
     dTStartSec = DivU64x64Remainder (dTStartMs, 1000, &dTStartMs);
@@ -139,50 +143,343 @@ GetLogPath (
   return LogPath;
 }
 
+/**
+  Check whether at least Interval milliseconds passed since LastTsc.
+  Always passes when TSC frequency is unknown.
+
+  @param[in] Private   Log private data.
+  @param[in] Tsc       Current TSC value.
+  @param[in] LastTsc   Previous TSC value.
+  @param[in] Interval  Interval in milliseconds.
+
+  @retval TRUE when interval has passed.
+**/
+STATIC
+BOOLEAN
+LogIntervalElapsed (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN UINT64               Tsc,
+  IN UINT64               LastTsc,
+  IN UINT32               Interval
+  )
+{
+  if (Private->TscFrequency == 0) {
+    return TRUE;
+  }
+
+  return MultU64x32 (Tsc - LastTsc, 1000) >= MultU64x32 (Private->TscFrequency, Interval);
+}
+
+/**
+  Append a string to a log buffer keeping it null-terminated.
+
+  @param[in,out] Buffer        Log buffer.
+  @param[in]     BufferSize    Log buffer size including null terminator.
+  @param[in,out] Length        Log buffer string length, updated on success.
+  @param[in]     String        String to append.
+  @param[in]     StringLength  String length.
+
+  @retval EFI_SUCCESS           The string was appended.
+  @retval EFI_BUFFER_TOO_SMALL  There is not enough space for the string.
+**/
+STATIC
 EFI_STATUS
-EFIAPI
-OcLogAddEntry  (
-  IN OC_LOG_PROTOCOL    *OcLog,
-  IN UINTN              ErrorLevel,
-  IN CONST CHAR8        *FormatString,
-  IN VA_LIST            Marker
+AppendLogBuffer (
+  IN OUT CHAR8        *Buffer,
+  IN     UINTN        BufferSize,
+  IN OUT UINTN        *Length,
+  IN     CONST CHAR8  *String,
+  IN     UINTN        StringLength
   )
 {
-  EFI_STATUS                  Status;
+  ASSERT (*Length < BufferSize);
 
-  OC_LOG_PRIVATE_DATA         *Private;
-  UINT32                      Attributes;
-  UINT32                      TimingLength;
-  UINT32                      LineLength;
-  APPLE_PLATFORM_DATA_RECORD  *Entry;
-  UINT32                      KeySize;
-  UINT32                      DataSize;
-  UINT32                      TotalSize;
+  if (BufferSize - *Length <= StringLength) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
 
-  Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog);
+  CopyMem (&Buffer[*Length], String, StringLength);
+  *Length += StringLength;
+  Buffer[*Length] = '\0';
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Append new log contents to the log file. Verifies that file size matches
+  the log size after writing to detect file system drivers corrupting data.
+
+  @param[in] Private  Log private data.
+  @param[in] LogSize  Current log size.
+
+  @retval EFI_SUCCESS  Log file contents match the log.
+**/
+STATIC
+EFI_STATUS
+AppendLogFile (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN UINTN                LogSize
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINTN              WrittenSize;
+  UINT32             FileSize;
+
+  Status = SafeFileOpen (
+    Private->OcLog.FileSystem,
+    &File,
+    Private->OcLog.FilePath,
+    EFI_FILE_MODE_CREATE | EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE,
+    0
+    );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = File->SetPosition (File, Private->FileFlushedSize);
+  if (!EFI_ERROR (Status)) {
+    WrittenSize = LogSize - Private->FileFlushedSize;
+    Status = File->Write (
+      File,
+      &WrittenSize,
+      &Private->AsciiBuffer[Private->FileFlushedSize]
+      );
+    Private->FileBytesWritten += WrittenSize;
+
+    if (!EFI_ERROR (Status) && Private->FileFlushedSize + WrittenSize != LogSize) {
+      Status = EFI_BAD_BUFFER_SIZE;
+    }
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = GetFileSize (File, &FileSize);
+    if (!EFI_ERROR (Status) && FileSize != LogSize) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+  }
+
+  File->Close (File);
+
+  return Status;
+}
+
+/**
+  Write pending log contents to the log file, see FlushLogFile.
+
+  @param[in] Private  Log private data.
+  @param[in] Force    Flush regardless of pending size and flush interval.
+**/
+STATIC
+VOID
+WriteLogFile (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN BOOLEAN              Force
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       LogSize;
+  UINT64      CurrentTsc;
+
+  LogSize = Private->AsciiBufferLength;
+  if (LogSize == Private->FileFlushedSize) {
+    return;
+  }
+
+  CurrentTsc = AsmReadTsc ();
+
+  //
+  // Without TSC frequency every entry is flushed.
+  //
+  if (!Force
+    && LogSize - Private->FileFlushedSize < OC_LOG_FILE_FLUSH_SIZE
+    && !LogIntervalElapsed (Private, CurrentTsc, Private->FileFlushTsc, OC_LOG_FILE_FLUSH_INTERVAL)) {
+    return;
+  }
+
+  Private->FileFlushTsc = CurrentTsc;
+  ++Private->FileFlushCount;
+
+  if (!Private->FileRewrite && (Private->OcLog.Options & OC_LOG_FILE_REWRITE) == 0) {
+    Status = AppendLogFile (Private, LogSize);
+    if (!EFI_ERROR (Status)) {
+      Private->FileFlushedSize = LogSize;
+      return;
+    }
 
-  if ((OcLog->Options & OC_LOG_ENABLE) == 0) {
     //
-    // Silently ignore when disabled.
+    // Some FAT32 drivers are broken and corrupt files written in pieces.
+    // Fall back to overwriting the whole file with fixed size buffer.
     //
-    return EFI_SUCCESS;
+    Private->FileRewrite = TRUE;
   }
 
-  AsciiVSPrint (
-    Private->LineBuffer,
-    sizeof (Private->LineBuffer),
-    FormatString,
-    Marker
-    );
-
   //
-  // Add Entry.
+  // Always overwriting file completely is most reliable.
+  // I know it is slow, but fixed size write is more reliable with broken FAT32 driver.
   //
+  SetFileData (
+    Private->OcLog.FileSystem,
+    Private->OcLog.FilePath,
+    Private->AsciiBuffer,
+    (UINT32) Private->AsciiBufferSize
+    );
+
+  Private->FileBytesWritten += Private->AsciiBufferSize;
+  Private->FileFlushedSize   = LogSize;
+}
+
+/**
+  Write pending log contents to the log file.
+  File writes are only performed at TPL_CALLBACK or lower, pending contents
+  are written by the first flush at a lower TPL. Flushing is skipped when
+  interrupting another flush.
+
+  @param[in] Private  Log private data.
+  @param[in] Force    Flush regardless of pending size and flush interval.
+**/
+STATIC
+VOID
+FlushLogFile (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN BOOLEAN              Force
+  )
+{
+  if ((Private->OcLog.Options & OC_LOG_FILE) == 0 || Private->OcLog.FileSystem == NULL) {
+    return;
+  }
+
+  if (EfiGetCurrentTpl () > TPL_CALLBACK) {
+    return;
+  }
+
+  if (InterlockedCompareExchange32 ((UINT32 *) &Private->FileFlushing, 0, 1) != 0) {
+    return;
+  }
+
+  WriteLogFile (Private, Force);
+
+  Private->FileFlushing = 0;
+}
+
+/**
+  Write pending log contents to the log variable, see FlushLogVariable.
+
+  @param[in] Private  Log private data.
+  @param[in] Force    Write regardless of write interval.
+**/
+STATIC
+VOID
+WriteLogVariable (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN BOOLEAN              Force
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Attributes;
+  UINT64      CurrentTsc;
+
+  CurrentTsc = AsmReadTsc ();
+
+  if (!Force
+    && !LogIntervalElapsed (Private, CurrentTsc, Private->NvramFlushTsc, OC_LOG_NVRAM_FLUSH_INTERVAL)) {
+    return;
+  }
+
+  Private->NvramFlushTsc     = CurrentTsc;
+  Private->NvramFlushPending = FALSE;
+
+  Attributes = EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+  if ((Private->OcLog.Options & OC_LOG_NONVOLATILE) != 0) {
+    Attributes |= EFI_VARIABLE_NON_VOLATILE;
+  }
+
+  Status = gRT->SetVariable (
+    OC_LOG_VARIABLE_NAME,
+    &gOcVendorVariableGuid,
+    Attributes,
+    Private->NvramBufferLength,
+    Private->NvramBuffer
+    );
+
+  if (EFI_ERROR (Status)) {
+    //
+    // On APTIO V this may not even get printed. Regardless of volatile or not
+    // it will firstly start discarding NVRAM data silently, and then will borks
+    // NVRAM support completely till reboot. Let's stop on first error at least.
+    //
+    gST->ConOut->OutputString (gST->ConOut, L"NVRAM is full, cannot log!\r\n");
+    gBS->Stall (SECONDS_TO_MICROSECONDS (1));
+    Private->OcLog.Options &= ~(OC_LOG_VARIABLE | OC_LOG_NONVOLATILE);
+    return;
+  }
+
+  Private->NvramFlushedLength = Private->NvramBufferLength;
+}
+
+/**
+  Write pending log contents to the log variable.
+  Without TSC frequency every entry is written. Entries skipped due to
+  write interval are written by the next log entry once the flush timer
+  marks them pending. Flushing is skipped when interrupting another flush.
+
+  @param[in] Private  Log private data.
+  @param[in] Force    Write regardless of write interval.
+**/
+STATIC
+VOID
+FlushLogVariable (
+  IN OC_LOG_PRIVATE_DATA  *Private,
+  IN BOOLEAN              Force
+  )
+{
+  if ((Private->OcLog.Options & (OC_LOG_VARIABLE | OC_LOG_NONVOLATILE)) == 0
+    || Private->NvramBufferLength == Private->NvramFlushedLength) {
+    return;
+  }
+
+  if (InterlockedCompareExchange32 ((UINT32 *) &Private->NvramFlushing, 0, 1) != 0) {
+    return;
+  }
+
+  WriteLogVariable (Private, Force);
+
+  Private->NvramFlushing = 0;
+}
+
+/**
+  Write formatted log line to all enabled targets.
+
+  @param[in,out] Private     Log private data.
+  @param[in]     ErrorLevel  Debug level.
+  @param[in]     Tsc         Line timestamp.
+
+  @retval EFI_SUCCESS  The line was successfully written.
+**/
+STATIC
+EFI_STATUS
+WriteLogLine (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private,
+  IN     UINTN                ErrorLevel,
+  IN     UINT64               Tsc
+  )
+{
+  EFI_STATUS                  Status;
+
+  OC_LOG_PROTOCOL             *OcLog;
+  UINT32                      TimingLength;
+  UINT32                      LineLength;
+  APPLE_PLATFORM_DATA_RECORD  *Entry;
+  UINT32                      KeySize;
+  UINT32                      DataSize;
+  UINT32                      TotalSize;
+
+  OcLog = &Private->OcLog;
 
   Status = EFI_SUCCESS;
 
   if (*Private->LineBuffer != '\0') {
-    GetTiming (OcLog);
+    GetTiming (OcLog, Tsc);
 
     //
     // Send the string to the console output device.
@@ -280,26 +577,27 @@ OcLogAddEntry  (
     // Write to internal buffer.
     //
 
-    Status = AsciiStrCatS (Private->AsciiBuffer, Private->AsciiBufferSize, Private->TimingTxt);
+    Status = AppendLogBuffer (
+      Private->AsciiBuffer,
+      Private->AsciiBufferSize,
+      &Private->AsciiBufferLength,
+      Private->TimingTxt,
+      TimingLength
+      );
     if (!EFI_ERROR (Status)) {
-      Status = AsciiStrCatS (Private->AsciiBuffer, Private->AsciiBufferSize, Private->LineBuffer);
+      Status = AppendLogBuffer (
+        Private->AsciiBuffer,
+        Private->AsciiBufferSize,
+        &Private->AsciiBufferLength,
+        Private->LineBuffer,
+        LineLength
+        );
     }
 
     //
     // Write to a file.
-    // Always overwriting file completely is most reliable.
-    // I know it is slow, but fixed size write is more reliable with broken FAT32 driver.
     //
-    if ((OcLog->Options & OC_LOG_FILE) != 0 && OcLog->FileSystem != NULL) {
-      if (EfiGetCurrentTpl () <= TPL_CALLBACK) {
-        SetFileData (
-          OcLog->FileSystem,
-          OcLog->FilePath,
-          Private->AsciiBuffer,
-          (UINT32) Private->AsciiBufferSize
-          );
-      }
-    }
+    FlushLogFile (Private, (ErrorLevel & DEBUG_ERROR) != 0);
 
     //
     // Write to a variable.
@@ -309,36 +607,17 @@ OcLogAddEntry  (
       // Do not log timing information to NVRAM, it is already large.
       // This check is here, because Microsoft is retarded and asserts.
       //
-      if (Private->NvramBufferSize - AsciiStrSize (Private->NvramBuffer) >= AsciiStrLen (Private->LineBuffer)) {
-        Status = AsciiStrCatS (Private->NvramBuffer, Private->NvramBufferSize, Private->LineBuffer);
-      } else {
-        Status = EFI_BUFFER_TOO_SMALL;
-      }
+      Status = AppendLogBuffer (
+        Private->NvramBuffer,
+        Private->NvramBufferSize,
+        &Private->NvramBufferLength,
+        Private->LineBuffer,
+        LineLength
+        );
       if (!EFI_ERROR (Status)) {
-        Attributes = EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
-        if ((OcLog->Options & OC_LOG_NONVOLATILE) != 0) {
-          Attributes |= EFI_VARIABLE_NON_VOLATILE;
-        }
-
-        Status = gRT->SetVariable (
-          OC_LOG_VARIABLE_NAME,
-          &gOcVendorVariableGuid,
-          Attributes,
-          AsciiStrLen (Private->NvramBuffer),
-          Private->NvramBuffer
-          );
-
-        if (EFI_ERROR (Status)) {
-          //
-          // On APTIO V this may not even get printed. Regardless of volatile or not
-          // it will firstly start discarding NVRAM data silently, and then will borks
-          // NVRAM support completely till reboot. Let's stop on first error at least.
-          //
-          gST->ConOut->OutputString (gST->ConOut, L"NVRAM is full, cannot log!\r\n");
-          gBS->Stall (SECONDS_TO_MICROSECONDS (1));
-          OcLog->Options &= ~(OC_LOG_VARIABLE | OC_LOG_NONVOLATILE);
-        }
+        FlushLogVariable (Private, FALSE);
       } else {
+        FlushLogVariable (Private, TRUE);
         gST->ConOut->OutputString (gST->ConOut, L"NVRAM log size exceeded, cannot log!\r\n");
         gBS->Stall (SECONDS_TO_MICROSECONDS (1));
         OcLog->Options &= ~(OC_LOG_VARIABLE | OC_LOG_NONVOLATILE);
@@ -346,9 +625,359 @@ OcLogAddEntry  (
     }
   }
 
+  return Status;
+}
+
+/**
+  Format and write entries recorded into the deferred log ring.
+  Draining is skipped when interrupting another drain.
+
+  @param[in,out] Private  Log private data.
+**/
+STATIC
+VOID
+DrainLogRing (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private
+  )
+{
+  OC_LOG_RING_ENTRY  *Entry;
+
+  if (Private->RingTail == Private->RingHead) {
+    return;
+  }
+
+  if (InterlockedCompareExchange32 ((UINT32 *) &Private->RingDraining, 0, 1) != 0) {
+    return;
+  }
+
+  Private->RingDrainTsc = AsmReadTsc ();
+
+  while ((Entry = InternalLogRingFront (Private)) != NULL) {
+    AsciiBSPrint (
+      Private->LineBuffer,
+      sizeof (Private->LineBuffer),
+      (CONST CHAR8 *) Entry->Data,
+      (BASE_LIST) Entry->Args
+      );
+    WriteLogLine (Private, Entry->ErrorLevel, Entry->Tsc);
+    InternalLogRingPop (Private);
+  }
+
+  Private->RingDraining = 0;
+}
+
+/**
+  Write summary of timing spans added since the previous report to the log,
+  and span trace with all spans next to the log file. The summary is only
+  written to the log buffers, serial port, and log file.
+
+  @param[in,out] Private  Log private data.
+**/
+STATIC
+VOID
+ReportLogSpans (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private
+  )
+{
+  STATIC CONST CHAR8  mIndent[] = "                ";
+
+  OC_LOG_OPTIONS      Options;
+  OC_LOG_SPAN_RECORD  Span;
+  OC_LOG_SPAN_RECORD  *Current;
+  UINT64              Frequency;
+  UINT64              BaseTsc;
+  UINT64              Start;
+  UINT64              Duration;
+  UINT64              ParentEnd[8];
+  UINT32              StartMs;
+  UINT32              DurationMs;
+  UINT32              Depth;
+  UINT32              Index;
+  UINT32              Index2;
+  UINTN               TraceLength;
+  UINTN               PathLength;
+
+  if (Private->SpanCount == Private->SpansReported) {
+    return;
+  }
+
+  Frequency = Private->TscFrequency;
+  if (Frequency == 0) {
+    Frequency = OcGetTSCFrequency ();
+    if (Frequency == 0) {
+      return;
+    }
+  }
+
+  //
+  // Sort new spans by start putting parents before their children. Nested
+  // spans are submitted before their parents, but there are few of them.
+  //
+  for (Index = Private->SpansReported + 1; Index < Private->SpanCount; ++Index) {
+    CopyMem (&Span, &Private->Spans[Index], sizeof (Span));
+    for (Index2 = Index; Index2 > Private->SpansReported; --Index2) {
+      Current = &Private->Spans[Index2 - 1];
+      if (Current->StartTsc < Span.StartTsc
+        || (Current->StartTsc == Span.StartTsc && Current->EndTsc >= Span.EndTsc)) {
+        break;
+      }
+      CopyMem (&Private->Spans[Index2], Current, sizeof (Span));
+    }
+    CopyMem (&Private->Spans[Index2], &Span, sizeof (Span));
+  }
+
+  Options                 = Private->OcLog.Options;
+  Private->OcLog.Options &= ~(OC_LOG_CONSOLE | OC_LOG_DATA_HUB | OC_LOG_VARIABLE | OC_LOG_NONVOLATILE);
+
+  AsciiSPrint (
+    Private->LineBuffer,
+    sizeof (Private->LineBuffer),
+    "OCL: Boot spans (start ms, duration ms), %u dropped\n",
+    Private->SpansDropped
+    );
+  WriteLogLine (Private, DEBUG_INFO, AsmReadTsc ());
+
+  TraceLength = AsciiSPrint (
+    Private->SpanTrace,
+    sizeof (Private->SpanTrace),
+    "{\"traceEvents\":["
+    );
+
+  BaseTsc = Private->Spans[0].StartTsc;
+  for (Index = 1; Index < Private->SpanCount; ++Index) {
+    BaseTsc = MIN (BaseTsc, Private->Spans[Index].StartTsc);
+  }
+
+  Depth = 0;
+
+  for (Index = 0; Index < Private->SpanCount; ++Index) {
+    Current  = &Private->Spans[Index];
+    Start    = DivU64x64Remainder (MultU64x32 (Current->StartTsc - BaseTsc, 1000000), Frequency, NULL);
+    Duration = DivU64x64Remainder (MultU64x32 (Current->EndTsc - Current->StartTsc, 1000000), Frequency, NULL);
+
+    TraceLength += AsciiSPrint (
+      &Private->SpanTrace[TraceLength],
+      sizeof (Private->SpanTrace) - TraceLength,
+      "%a\n{\"name\":\"%a\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%Lu,\"dur\":%Lu}",
+      Index > 0 ? "," : "",
+      Current->Name,
+      Start,
+      Duration
+      );
+
+    if (Index < Private->SpansReported) {
+      continue;
+    }
+
+    //
+    // Drop finished parents to find nesting depth.
+    //
+    while (Depth > 0 && Current->EndTsc > ParentEnd[Depth - 1]) {
+      --Depth;
+    }
+
+    AsciiSPrint (
+      Private->LineBuffer,
+      sizeof (Private->LineBuffer),
+      "OCL: %6Lu.%03u %6Lu.%03u %a%a\n",
+      DivU64x32Remainder (Start, 1000, &StartMs),
+      StartMs,
+      DivU64x32Remainder (Duration, 1000, &DurationMs),
+      DurationMs,
+      &mIndent[sizeof (mIndent) - 1 - MIN (Depth * 2, sizeof (mIndent) - 1)],
+      Current->Name
+      );
+    WriteLogLine (Private, DEBUG_INFO, AsmReadTsc ());
+
+    if (Depth < ARRAY_SIZE (ParentEnd)) {
+      ParentEnd[Depth++] = Current->EndTsc;
+    }
+  }
+
+  Private->SpansReported = Private->SpanCount;
+
+  TraceLength += AsciiSPrint (
+    &Private->SpanTrace[TraceLength],
+    sizeof (Private->SpanTrace) - TraceLength,
+    "\n]}\n"
+    );
+
+  Private->OcLog.Options |= Options & (OC_LOG_CONSOLE | OC_LOG_DATA_HUB | OC_LOG_VARIABLE | OC_LOG_NONVOLATILE);
+
+  if ((Private->OcLog.Options & OC_LOG_FILE) == 0
+    || Private->OcLog.FileSystem == NULL
+    || Private->OcLog.FilePath == NULL) {
+    return;
+  }
+
+  //
+  // Write the trace next to the log file replacing .txt with .json.
+  //
+  PathLength = StrLen (Private->OcLog.FilePath);
+  if (PathLength <= L_STR_LEN (L".txt")
+    || PathLength - L_STR_LEN (L".txt") + L_STR_SIZE (L".json") / sizeof (CHAR16) > ARRAY_SIZE (Private->SpanTracePath)) {
+    return;
+  }
+
+  PathLength -= L_STR_LEN (L".txt");
+  CopyMem (Private->SpanTracePath, Private->OcLog.FilePath, PathLength * sizeof (CHAR16));
+  CopyMem (&Private->SpanTracePath[PathLength], L".json", L_STR_SIZE (L".json"));
+
+  SetFileData (
+    Private->OcLog.FileSystem,
+    Private->SpanTracePath,
+    Private->SpanTrace,
+    (UINT32) TraceLength
+    );
+}
+
+/**
+  Write pending log contents to the log file when nothing is logged.
+  Pending log variable contents are only marked for the next log entry,
+  as the timer may interrupt variable services, which are not reentrant.
+
+  @param[in] Event    Flush timer event.
+  @param[in] Context  Log private data.
+**/
+STATIC
+VOID
+EFIAPI
+OcLogFlushTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  OC_LOG_PRIVATE_DATA  *Private;
+
+  Private = Context;
+
+  FlushLogFile (Private, FALSE);
+
+  if (Private->NvramBufferLength != Private->NvramFlushedLength) {
+    Private->NvramFlushPending = TRUE;
+  }
+}
+
+/**
+  Stop log file writes when exiting boot services. File system cannot be
+  used from exit boot services notifications, as it allocates memory.
+  Formatting deferred entries may write to console and Data Hub, which
+  cannot be used either. All targets are written by OcLogSaveLog before
+  starting the OS.
+
+  @param[in] Event    Exit boot services event.
+  @param[in] Context  Log private data.
+**/
+STATIC
+VOID
+EFIAPI
+OcLogExitBootServices (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  OC_LOG_PRIVATE_DATA  *Private;
+
+  Private = Context;
+
+  Private->OcLog.Options &= ~OC_LOG_FILE;
+}
+
+/**
+  Add an entry to the log.
+
+  With OC_LOG_DEFERRED entries not visible onscreen are recorded into
+  the ring in O(format length), copying at most OC_LOG_RING_DATA_SIZE bytes
+  of string arguments, and the call returns. Once the ring is half full,
+  or OC_LOG_FILE_FLUSH_INTERVAL elapsed, the entry formats and writes up to
+  OC_LOG_RING_SIZE recorded entries as below.
+
+  Formatted entries are appended to buffers in O(line length). In the worst
+  case a single entry additionally performs one log file write of at most
+  OC_LOG_BUFFER_SIZE bytes (contents pending since the previous flush, or
+  the whole buffer in rewrite mode), and one log variable write of at most
+  OC_LOG_NVRAM_BUFFER_SIZE bytes. Both writes are rate-limited, see
+  OC_LOG_FILE_FLUSH_INTERVAL and OC_LOG_NVRAM_FLUSH_INTERVAL.
+
+  @param[in] OcLog         This protocol.
+  @param[in] ErrorLevel    Debug level.
+  @param[in] FormatString  String containing the output format.
+  @param[in] Marker        Address of the VA_ARGS marker.
+
+  @retval EFI_SUCCESS  The entry was successfully added.
+**/
+EFI_STATUS
+EFIAPI
+OcLogAddEntry  (
+  IN OC_LOG_PROTOCOL    *OcLog,
+  IN UINTN              ErrorLevel,
+  IN CONST CHAR8        *FormatString,
+  IN VA_LIST            Marker
+  )
+{
+  EFI_STATUS                  Status;
+
+  OC_LOG_PRIVATE_DATA         *Private;
+  UINT64                      Tsc;
+
+  Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog);
+
+  if ((OcLog->Options & OC_LOG_ENABLE) == 0) {
+    //
+    // Silently ignore when disabled.
+    //
+    return EFI_SUCCESS;
+  }
+
+  Tsc = AsmReadTsc ();
+
+  //
+  // Write log variable contents left pending since the flush timer fired.
+  //
+  if (Private->NvramFlushPending) {
+    FlushLogVariable (Private, TRUE);
+  }
+
+  //
+  // Defer formatting unless the entry is visible onscreen, is an error, or
+  // causes halting. Timestamps need calibrated TSC.
+  //
+  if ((OcLog->Options & OC_LOG_DEFERRED) != 0
+    && Private->TscFrequency != 0
+    && ((OcLog->Options & OC_LOG_CONSOLE) == 0 || (OcLog->DisplayLevel & ErrorLevel) == 0)
+    && (ErrorLevel & (DEBUG_ERROR | OcLog->HaltLevel)) == 0) {
+    if (InternalLogRingRecord (Private, ErrorLevel, Tsc, FormatString, Marker)) {
+      if (Private->RingHead - Private->RingTail >= OC_LOG_RING_DRAIN_COUNT
+        || LogIntervalElapsed (Private, Tsc, Private->RingDrainTsc, OC_LOG_FILE_FLUSH_INTERVAL)) {
+        DrainLogRing (Private);
+      }
+
+      return EFI_SUCCESS;
+    }
+  }
+
+  //
+  // Keep entries ordered.
+  //
+  DrainLogRing (Private);
+
+  AsciiVSPrint (
+    Private->LineBuffer,
+    sizeof (Private->LineBuffer),
+    FormatString,
+    Marker
+    );
+
+  //
+  // Add Entry.
+  //
+  Status = WriteLogLine (Private, ErrorLevel, Tsc);
+
   if ((ErrorLevel & OcLog->HaltLevel) != 0
     && AsciiStrnCmp (FormatString, "\nASSERT_RETURN_ERROR", L_STR_LEN ("\nASSERT_RETURN_ERROR")) != 0
     && AsciiStrnCmp (FormatString, "\nASSERT_EFI_ERROR", L_STR_LEN ("\nASSERT_EFI_ERROR")) != 0) {
+    FlushLogFile (Private, TRUE);
+    FlushLogVariable (Private, TRUE);
     gST->ConOut->OutputString (gST->ConOut, L"Halting on critical error\r\n");
     gBS->Stall (SECONDS_TO_MICROSECONDS (1));
     CpuDeadLoop ();
@@ -372,6 +1001,7 @@ OcLogGetLog  (
 
   if (OcLogBuffer != NULL) {
     Private        = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (This);
+    DrainLogRing (Private);
     *OcLogBuffer   = Private->AsciiBuffer;
 
     Status = EFI_SUCCESS;
@@ -388,7 +1018,41 @@ OcLogSaveLog (
   IN EFI_DEVICE_PATH_PROTOCOL  *FilePath OPTIONAL
   )
 {
-  return EFI_NOT_FOUND;
+  OC_LOG_PRIVATE_DATA  *Private;
+
+  //
+  // Saving to custom locations is not supported, write deferred entries
+  // and pending contents to configured targets.
+  //
+  Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (This);
+  DrainLogRing (Private);
+  ReportLogSpans (Private);
+
+  if ((Private->OcLog.Options & OC_LOG_FILE) != 0 && Private->OcLog.FileSystem != NULL) {
+    //
+    // Bytes written by this flush itself are not accounted.
+    //
+    AsciiSPrint (
+      Private->LineBuffer,
+      sizeof (Private->LineBuffer),
+      "OCL: Log file %Lu bytes written in %u flushes, rewrite %d\n",
+      Private->FileBytesWritten,
+      Private->FileFlushCount,
+      Private->FileRewrite || (Private->OcLog.Options & OC_LOG_FILE_REWRITE) != 0
+      );
+    AppendLogBuffer (
+      Private->AsciiBuffer,
+      Private->AsciiBufferSize,
+      &Private->AsciiBufferLength,
+      Private->LineBuffer,
+      AsciiStrLen (Private->LineBuffer)
+      );
+  }
+
+  FlushLogFile (Private, TRUE);
+  FlushLogVariable (Private, TRUE);
+
+  return EFI_SUCCESS;
 }
 
 EFI_STATUS
@@ -400,6 +1064,52 @@ OcLogResetTimers (
   return EFI_SUCCESS;
 }
 
+EFI_STATUS
+EFIAPI
+OcLogAddSpan (
+  IN OC_LOG_PROTOCOL  *This,
+  IN CONST CHAR8      *Name,
+  IN UINT64           StartTsc,
+  IN UINT64           EndTsc
+  )
+{
+  OC_LOG_PRIVATE_DATA  *Private;
+  OC_LOG_SPAN_RECORD   *Span;
+  UINTN                Index;
+
+  Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (This);
+
+  if ((This->Options & OC_LOG_ENABLE) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (Private->SpanCount == OC_LOG_MAX_SPANS) {
+    ++Private->SpansDropped;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Span = &Private->Spans[Private->SpanCount];
+
+  //
+  // Names are written into span trace as is, replace characters needing escaping.
+  //
+  for (Index = 0; Index < sizeof (Span->Name) - 1 && Name[Index] != '\0'; ++Index) {
+    if (Name[Index] < ' ' || Name[Index] == '"' || Name[Index] == '\\') {
+      Span->Name[Index] = '_';
+    } else {
+      Span->Name[Index] = Name[Index];
+    }
+  }
+  Span->Name[Index] = '\0';
+
+  Span->StartTsc = StartTsc;
+  Span->EndTsc   = MAX (StartTsc, EndTsc);
+
+  ++Private->SpanCount;
+
+  return EFI_SUCCESS;
+}
+
 OC_LOG_PROTOCOL *
 InternalGetOcLog (
   VOID
@@ -441,6 +1151,8 @@ OcConfigureLogProtocol (
   EFI_HANDLE            Handle;
   EFI_FILE_PROTOCOL     *LogRoot;
   CHAR16                *LogPath;
+  EFI_STATUS            EventStatus;
+  EFI_STATUS            TimerStatus;
 
   if ((Options & (OC_LOG_FILE | OC_LOG_ENABLE)) == (OC_LOG_FILE | OC_LOG_ENABLE)) {
     LogRoot = NULL;
@@ -483,6 +1195,11 @@ OcConfigureLogProtocol (
     // Set desired options in existing protocol.
     //
 
+    Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog);
+    DrainLogRing (Private);
+    FlushLogFile (Private, TRUE);
+    FlushLogVariable (Private, TRUE);
+
     if (OcLog->FileSystem != NULL) {
       OcLog->FileSystem->Close (OcLog->FileSystem);
     }
@@ -497,6 +1214,15 @@ OcConfigureLogProtocol (
     OcLog->FileSystem   = LogRoot;
     OcLog->FilePath     = LogPath;
 
+    //
+    // New log file is written from scratch.
+    //
+    Private->FileFlushedSize  = 0;
+    Private->FileFlushTsc     = 0;
+    Private->FileBytesWritten = 0;
+    Private->FileFlushCount   = 0;
+    Private->FileRewrite      = FALSE;
+
     Status = EFI_SUCCESS;
   } else {
     Private = AllocateZeroPool (sizeof (*Private));
@@ -511,6 +1237,7 @@ OcConfigureLogProtocol (
       Private->OcLog.GetLog       = OcLogGetLog;
       Private->OcLog.SaveLog      = OcLogSaveLog;
       Private->OcLog.ResetTimers  = OcLogResetTimers;
+      Private->OcLog.AddSpan      = OcLogAddSpan;
       Private->OcLog.Options      = Options;
       Private->OcLog.DisplayDelay = DisplayDelay;
       Private->OcLog.DisplayLevel = DisplayLevel;
@@ -518,6 +1245,38 @@ OcConfigureLogProtocol (
       Private->OcLog.FileSystem   = LogRoot;
       Private->OcLog.FilePath     = LogPath;
 
+      EventStatus = gBS->CreateEvent (
+        EVT_SIGNAL_EXIT_BOOT_SERVICES,
+        TPL_CALLBACK,
+        OcLogExitBootServices,
+        Private,
+        &Private->ExitBootServicesEvent
+        );
+      if (EFI_ERROR (EventStatus)) {
+        Private->ExitBootServicesEvent = NULL;
+      }
+
+      TimerStatus = gBS->CreateEvent (
+        EVT_TIMER | EVT_NOTIFY_SIGNAL,
+        TPL_CALLBACK,
+        OcLogFlushTimer,
+        Private,
+        &Private->FlushTimerEvent
+        );
+      if (!EFI_ERROR (TimerStatus)) {
+        TimerStatus = gBS->SetTimer (
+          Private->FlushTimerEvent,
+          TimerPeriodic,
+          EFI_TIMER_PERIOD_MILLISECONDS (OC_LOG_FLUSH_TIMER_INTERVAL)
+          );
+        if (EFI_ERROR (TimerStatus)) {
+          gBS->CloseEvent (Private->FlushTimerEvent);
+        }
+      }
+      if (EFI_ERROR (TimerStatus)) {
+        Private->FlushTimerEvent = NULL;
+      }
+
       Handle = NULL;
       Status = gBS->InstallProtocolInterface (
         &Handle,
@@ -528,7 +1287,23 @@ OcConfigureLogProtocol (
 
       if (!EFI_ERROR (Status)) {
         OcLog = &Private->OcLog;
+
+        //
+        // Report after installing, so that the messages get logged.
+        //
+        if (EFI_ERROR (EventStatus)) {
+          DEBUG ((DEBUG_WARN, "OCL: Failed to create exit boot services event - %r\n", EventStatus));
+        }
+        if (EFI_ERROR (TimerStatus)) {
+          DEBUG ((DEBUG_WARN, "OCL: Failed to create log flush timer - %r\n", TimerStatus));
+        }
       } else {
+        if (Private->ExitBootServicesEvent != NULL) {
+          gBS->CloseEvent (Private->ExitBootServicesEvent);
+        }
+        if (Private->FlushTimerEvent != NULL) {
+          gBS->CloseEvent (Private->FlushTimerEvent);
+        }
         FreePool (Private);
       }
     }
@@ -536,12 +1311,11 @@ OcConfigureLogProtocol (
 
   if (LogRoot != NULL) {
     if (!EFI_ERROR (Status)) {
-      SetFileData (
-        LogRoot,
-        LogPath,
-        OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog)->AsciiBuffer,
-        (UINT32) OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog)->AsciiBufferSize
-        );
+      //
+      // Write the log collected so far into the new file.
+      //
+      Private = OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS (OcLog);
+      FlushLogFile (Private, TRUE);
     } else {
       LogRoot->Close (LogRoot);
       FreePool (LogPath);
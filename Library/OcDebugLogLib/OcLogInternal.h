@@ -24,6 +24,64 @@
 #define OC_LOG_FILE_PATH_BUFFER_SIZE  256
 #define OC_LOG_TIMING_BUFFER_SIZE     64
 
+//
+// Log file is flushed once this many bytes are pending, or once
+// OC_LOG_FILE_FLUSH_INTERVAL milliseconds passed since the last flush.
+// Error messages and halting flush immediately.
+//
+#define OC_LOG_FILE_FLUSH_SIZE        BASE_4KB
+#define OC_LOG_FILE_FLUSH_INTERVAL    500
+
+//
+// Pending contents are also flushed from a periodic timer every
+// OC_LOG_FLUSH_TIMER_INTERVAL milliseconds, so that the last entries
+// reach the log file and variable when nothing is logged afterwards,
+// e.g. on hang.
+//
+#define OC_LOG_FLUSH_TIMER_INTERVAL   250
+
+//
+// Log variable is updated at most once per OC_LOG_NVRAM_FLUSH_INTERVAL
+// milliseconds to bound NVRAM write rate. Halting, exhausting the variable
+// buffer, and exiting boot services flush immediately.
+//
+#define OC_LOG_NVRAM_FLUSH_INTERVAL   250
+
+//
+// Deferred log entry ring, see OC_LOG_DEFERRED. Entry data holds the format
+// string and copies of string arguments, entry arguments are a BASE_LIST.
+// The ring is drained once half full, or once OC_LOG_FILE_FLUSH_INTERVAL
+// milliseconds passed since the last drain.
+//
+#define OC_LOG_RING_SIZE              128
+#define OC_LOG_RING_DRAIN_COUNT       (OC_LOG_RING_SIZE / 2)
+#define OC_LOG_RING_MAX_ARGS          16
+#define OC_LOG_RING_DATA_SIZE         256
+
+typedef struct {
+  volatile UINT32  Committed;
+  UINTN            ErrorLevel;
+  UINT64           Tsc;
+  UINT64           Args[OC_LOG_RING_MAX_ARGS];
+  UINT64           Data[OC_LOG_RING_DATA_SIZE / sizeof (UINT64)];
+} OC_LOG_RING_ENTRY;
+
+//
+// Boot phase timing spans, see OC_LOG_ADD_SPAN. Spans past OC_LOG_MAX_SPANS
+// are dropped. Span trace is written in Chrome trace event format, where
+// a single event takes at most OC_LOG_SPAN_TRACE_EVENT_SIZE bytes.
+//
+#define OC_LOG_MAX_SPANS              64
+#define OC_LOG_SPAN_NAME_SIZE         32
+#define OC_LOG_SPAN_TRACE_EVENT_SIZE  128
+#define OC_LOG_SPAN_TRACE_SIZE        (OC_LOG_MAX_SPANS * OC_LOG_SPAN_TRACE_EVENT_SIZE + 64)
+
+typedef struct {
+  CHAR8   Name[OC_LOG_SPAN_NAME_SIZE];
+  UINT64  StartTsc;
+  UINT64  EndTsc;
+} OC_LOG_SPAN_RECORD;
+
 #define OC_LOG_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('O', 'C', 'L', 'G')
 
 #define OC_LOG_PRIVATE_DATA_FROM_OC_LOG_THIS(a) \
@@ -34,15 +92,40 @@ typedef struct {
   UINT64                 TscFrequency;
   UINT64                 TscStart;
   UINT64                 TscLast;
+  volatile UINT32        RingHead;
+  volatile UINT32        RingTail;
+  volatile UINT32        RingDraining;
+  UINT64                 RingDrainTsc;
+  OC_LOG_RING_ENTRY      Ring[OC_LOG_RING_SIZE];
   CHAR8                  TimingTxt[OC_LOG_TIMING_BUFFER_SIZE];
   CHAR8                  LineBuffer[OC_LOG_LINE_BUFFER_SIZE];
   CHAR16                 UnicodeLineBuffer[OC_LOG_LINE_BUFFER_SIZE];
   CHAR8                  AsciiBuffer[OC_LOG_BUFFER_SIZE];
   UINTN                  AsciiBufferSize;
+  UINTN                  AsciiBufferLength;
   CHAR8                  NvramBuffer[OC_LOG_NVRAM_BUFFER_SIZE];
   UINTN                  NvramBufferSize;
+  UINTN                  NvramBufferLength;
+  UINTN                  NvramFlushedLength;
+  UINT64                 NvramFlushTsc;
+  volatile UINT32        NvramFlushing;
+  volatile BOOLEAN       NvramFlushPending;
   UINT32                 LogCounter;
   CHAR16                 *LogFilePathName;
+  UINTN                  FileFlushedSize;
+  UINT64                 FileFlushTsc;
+  UINT64                 FileBytesWritten;
+  UINT32                 FileFlushCount;
+  BOOLEAN                FileRewrite;
+  volatile UINT32        FileFlushing;
+  EFI_EVENT              ExitBootServicesEvent;
+  EFI_EVENT              FlushTimerEvent;
+  UINT32                 SpanCount;
+  UINT32                 SpansReported;
+  UINT32                 SpansDropped;
+  OC_LOG_SPAN_RECORD     Spans[OC_LOG_MAX_SPANS];
+  CHAR8                  SpanTrace[OC_LOG_SPAN_TRACE_SIZE];
+  CHAR16                 SpanTracePath[OC_LOG_FILE_PATH_BUFFER_SIZE];
   EFI_DATA_HUB_PROTOCOL  *DataHub;
   OC_LOG_PROTOCOL        OcLog;
 } OC_LOG_PRIVATE_DATA;
@@ -52,4 +135,49 @@ InternalGetOcLog (
   VOID
   );
 
+/**
+  Record log entry into the deferred log ring without formatting it.
+  String, GUID, and time arguments are copied into the entry.
+
+  @param[in,out] Private       Log private data.
+  @param[in]     ErrorLevel    Debug level.
+  @param[in]     Tsc           Entry timestamp.
+  @param[in]     FormatString  String containing the output format.
+  @param[in]     Marker        Arguments, not consumed.
+
+  @retval TRUE   The entry was recorded.
+  @retval FALSE  The ring is full, or the entry does not fit into ring entry.
+**/
+BOOLEAN
+InternalLogRingRecord (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private,
+  IN     UINTN                ErrorLevel,
+  IN     UINT64               Tsc,
+  IN     CONST CHAR8          *FormatString,
+  IN     VA_LIST              Marker
+  );
+
+/**
+  Get the oldest recorded entry in the deferred log ring.
+
+  @param[in] Private  Log private data.
+
+  @retval Oldest entry or NULL when the ring is empty or the oldest entry
+          is still being recorded.
+**/
+OC_LOG_RING_ENTRY *
+InternalLogRingFront (
+  IN OC_LOG_PRIVATE_DATA  *Private
+  );
+
+/**
+  Remove the oldest entry returned by InternalLogRingFront from the ring.
+
+  @param[in,out] Private  Log private data.
+**/
+VOID
+InternalLogRingPop (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private
+  );
+
 #endif // OC_LOG_INTERNAL_H
@@ -0,0 +1,317 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Uefi.h>
+
+#include <Protocol/OcLog.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "OcLogInternal.h"
+
+//
+// Store argument in BASE_LIST layout as read by PrintLib with BASE_ARG.
+//
+#define LOG_RING_ARG(Cursor, Type, Value)                 \
+  do {                                                    \
+    *(Type *) (Cursor) = (Type) (Value);                  \
+    (Cursor) += _BASE_INT_SIZE_OF (Type);                 \
+  } while (0)
+
+/**
+  Copy argument data into ring entry data.
+
+  @param[in,out] Entry     Ring entry.
+  @param[in,out] DataSize  Used entry data size.
+  @param[in]     Source    Data to copy, optional.
+  @param[in]     Size      Data size.
+
+  @retval Pointer to copied data, NULL when Source is NULL.
+  @retval (VOID *) MAX_ADDRESS when data does not fit.
+**/
+STATIC
+VOID *
+LogRingCopyData (
+  IN OUT OC_LOG_RING_ENTRY  *Entry,
+  IN OUT UINTN              *DataSize,
+  IN     CONST VOID         *Source  OPTIONAL,
+  IN     UINTN              Size
+  )
+{
+  UINT8  *Target;
+
+  if (Source == NULL) {
+    return NULL;
+  }
+
+  //
+  // Keep copies aligned for CHAR16, GUID, and EFI_TIME arguments.
+  //
+  *DataSize = ALIGN_VALUE (*DataSize, sizeof (UINT64));
+  if (*DataSize > sizeof (Entry->Data) || sizeof (Entry->Data) - *DataSize < Size) {
+    return (VOID *) MAX_ADDRESS;
+  }
+
+  Target = (UINT8 *) Entry->Data + *DataSize;
+  CopyMem (Target, Source, Size);
+  *DataSize += Size;
+
+  return Target;
+}
+
+/**
+  Convert arguments into BASE_LIST layout copying referenced data,
+  following PrintLib format string syntax.
+
+  @param[in,out] Entry         Ring entry with format string copied.
+  @param[in,out] DataSize      Used entry data size.
+  @param[in]     FormatString  Format string.
+  @param[in]     Marker        Arguments, consumed.
+
+  @retval TRUE when all arguments were converted.
+**/
+STATIC
+BOOLEAN
+LogRingConvertArgs (
+  IN OUT OC_LOG_RING_ENTRY  *Entry,
+  IN OUT UINTN              *DataSize,
+  IN     CONST CHAR8        *FormatString,
+  IN     VA_LIST            Marker
+  )
+{
+  UINT8        *Cursor;
+  UINT8        *End;
+  BOOLEAN      Long;
+  BOOLEAN      Precision;
+  VOID         *Pointer;
+  CONST CHAR8  *AsciiString;
+  CONST CHAR16 *UnicodeString;
+
+  Cursor = (UINT8 *) Entry->Args;
+  End    = Cursor + sizeof (Entry->Args);
+
+  for (; *FormatString != '\0'; ++FormatString) {
+    if (*FormatString != '%') {
+      continue;
+    }
+
+    //
+    // Every argument takes at most 8 bytes.
+    //
+    if (End - Cursor < (INTN) sizeof (UINT64)) {
+      return FALSE;
+    }
+
+    Long      = FALSE;
+    Precision = FALSE;
+    for (++FormatString; *FormatString != '\0'; ++FormatString) {
+      if (*FormatString == 'l' || *FormatString == 'L') {
+        Long = TRUE;
+      } else if (*FormatString == '.') {
+        Precision = TRUE;
+      } else if (*FormatString == '*') {
+        LOG_RING_ARG (Cursor, UINTN, VA_ARG (Marker, UINTN));
+        if (End - Cursor < (INTN) sizeof (UINT64)) {
+          return FALSE;
+        }
+      } else if (!((*FormatString >= '0' && *FormatString <= '9')
+        || *FormatString == '-' || *FormatString == '+' || *FormatString == ' '
+        || *FormatString == ',')) {
+        break;
+      }
+    }
+
+    //
+    // Strings with precision may not be terminated, and their size
+    // is not known before formatting, so print them right away.
+    //
+    if (Precision
+      && (*FormatString == 'a' || *FormatString == 's' || *FormatString == 'S')) {
+      return FALSE;
+    }
+
+    switch (*FormatString) {
+      case '%':
+        break;
+
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+      case 'X':
+        if (Long) {
+          LOG_RING_ARG (Cursor, INT64, VA_ARG (Marker, INT64));
+        } else {
+          LOG_RING_ARG (Cursor, int, VA_ARG (Marker, int));
+        }
+        break;
+
+      case 'c':
+        LOG_RING_ARG (Cursor, UINTN, VA_ARG (Marker, UINTN));
+        break;
+
+      case 'p':
+        LOG_RING_ARG (Cursor, VOID *, VA_ARG (Marker, VOID *));
+        break;
+
+      case 'r':
+        LOG_RING_ARG (Cursor, RETURN_STATUS, VA_ARG (Marker, RETURN_STATUS));
+        break;
+
+      case 'a':
+        AsciiString = VA_ARG (Marker, CONST CHAR8 *);
+        Pointer     = LogRingCopyData (
+          Entry,
+          DataSize,
+          AsciiString,
+          AsciiString != NULL ? AsciiStrSize (AsciiString) : 0
+          );
+        if (Pointer == (VOID *) MAX_ADDRESS) {
+          return FALSE;
+        }
+        LOG_RING_ARG (Cursor, VOID *, Pointer);
+        break;
+
+      case 's':
+      case 'S':
+        UnicodeString = VA_ARG (Marker, CONST CHAR16 *);
+        Pointer       = LogRingCopyData (
+          Entry,
+          DataSize,
+          UnicodeString,
+          UnicodeString != NULL ? StrSize (UnicodeString) : 0
+          );
+        if (Pointer == (VOID *) MAX_ADDRESS) {
+          return FALSE;
+        }
+        LOG_RING_ARG (Cursor, VOID *, Pointer);
+        break;
+
+      case 'g':
+        Pointer = LogRingCopyData (Entry, DataSize, VA_ARG (Marker, GUID *), sizeof (GUID));
+        if (Pointer == (VOID *) MAX_ADDRESS) {
+          return FALSE;
+        }
+        LOG_RING_ARG (Cursor, VOID *, Pointer);
+        break;
+
+      case 't':
+        Pointer = LogRingCopyData (Entry, DataSize, VA_ARG (Marker, EFI_TIME *), sizeof (EFI_TIME));
+        if (Pointer == (VOID *) MAX_ADDRESS) {
+          return FALSE;
+        }
+        LOG_RING_ARG (Cursor, VOID *, Pointer);
+        break;
+
+      default:
+        //
+        // Unknown or truncated specifier, let PrintLib handle it right away.
+        //
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+BOOLEAN
+InternalLogRingRecord (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private,
+  IN     UINTN                ErrorLevel,
+  IN     UINT64               Tsc,
+  IN     CONST CHAR8          *FormatString,
+  IN     VA_LIST              Marker
+  )
+{
+  UINT32             Head;
+  OC_LOG_RING_ENTRY  *Entry;
+  UINTN              DataSize;
+  BOOLEAN            Result;
+  VA_LIST            Marker2;
+
+  //
+  // Reserve an entry. Entries may be recorded from a higher TPL while
+  // another one is being recorded, so the head is only advanced atomically.
+  //
+  do {
+    Head = Private->RingHead;
+    if (Head - Private->RingTail >= OC_LOG_RING_SIZE) {
+      return FALSE;
+    }
+  } while (InterlockedCompareExchange32 ((UINT32 *) &Private->RingHead, Head, Head + 1) != Head);
+
+  Entry             = &Private->Ring[Head % OC_LOG_RING_SIZE];
+  Entry->ErrorLevel = ErrorLevel;
+  Entry->Tsc        = Tsc;
+
+  //
+  // Format strings are copied too, as the image owning them may be
+  // unloaded before the ring is drained.
+  //
+  DataSize = 0;
+  Result   = LogRingCopyData (Entry, &DataSize, FormatString, AsciiStrSize (FormatString))
+    != (VOID *) MAX_ADDRESS;
+
+  if (Result) {
+    VA_COPY (Marker2, Marker);
+    Result = LogRingConvertArgs (Entry, &DataSize, FormatString, Marker2);
+    VA_END (Marker2);
+  }
+
+  if (!Result) {
+    //
+    // The entry is already reserved, make it print an empty line,
+    // which is skipped when draining.
+    //
+    *(CHAR8 *) Entry->Data = '\0';
+  }
+
+  MemoryFence ();
+  Entry->Committed = 1;
+
+  return Result;
+}
+
+OC_LOG_RING_ENTRY *
+InternalLogRingFront (
+  IN OC_LOG_PRIVATE_DATA  *Private
+  )
+{
+  OC_LOG_RING_ENTRY  *Entry;
+
+  if (Private->RingTail == Private->RingHead) {
+    return NULL;
+  }
+
+  Entry = &Private->Ring[Private->RingTail % OC_LOG_RING_SIZE];
+  if (Entry->Committed == 0) {
+    return NULL;
+  }
+
+  MemoryFence ();
+  return Entry;
+}
+
+VOID
+InternalLogRingPop (
+  IN OUT OC_LOG_PRIVATE_DATA  *Private
+  )
+{
+  Private->Ring[Private->RingTail % OC_LOG_RING_SIZE].Committed = 0;
+  MemoryFence ();
+  ++Private->RingTail;
+}
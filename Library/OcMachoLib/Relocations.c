@@ -17,6 +17,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <IndustryStandard/AppleMachoImage.h>
 
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcGuardLib.h>
 #include <Library/OcMachoLib.h>
 
 #include "OcMachoLibInternal.h"
@@ -113,6 +115,218 @@ InternalLookupRelocationByOffset (
   return NULL;
 }
 
+STATIC
+BOOLEAN
+InternalRelocationAddressLess (
+  IN CONST MACH_RELOCATION_INFO  *Relocs,
+  IN UINT32                      First,
+  IN UINT32                      Second
+  )
+{
+  if (Relocs[First].Address != Relocs[Second].Address) {
+    return (UINT64)Relocs[First].Address < (UINT64)Relocs[Second].Address;
+  }
+
+  return First < Second;
+}
+
+STATIC
+VOID
+InternalSiftDownRelocationIndices (
+  IN     CONST MACH_RELOCATION_INFO  *Relocs,
+  IN OUT UINT32                      *Indices,
+  IN     UINT32                      Root,
+  IN     UINT32                      Count
+  )
+{
+  UINT32  Child;
+  UINT32  Temp;
+
+  while (Root < Count / 2) {
+    Child = 2 * Root + 1;
+    if (Child + 1 < Count
+      && InternalRelocationAddressLess (Relocs, Indices[Child], Indices[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalRelocationAddressLess (Relocs, Indices[Root], Indices[Child])) {
+      return;
+    }
+
+    Temp           = Indices[Root];
+    Indices[Root]  = Indices[Child];
+    Indices[Child] = Temp;
+    Root           = Child;
+  }
+}
+
+/**
+  Fills Indices with the numbers of Relocations InternalLookupRelocationByOffset
+  may return, sorted by address.  Ties keep table order, so that the first
+  match is found as with the linear scan.
+  Heap sort is used as it needs no extra memory and has no bad cases.
+
+  @param[in]  NumRelocs  Number of Relocations in Relocs.
+  @param[in]  Relocs     Relocations to index.
+  @param[out] Indices    Buffer of at least NumRelocs entries.
+
+  @returns  Number of entries written to Indices.
+
+**/
+STATIC
+UINT32
+InternalBuildRelocationIndex (
+  IN  UINT32                      NumRelocs,
+  IN  CONST MACH_RELOCATION_INFO  *Relocs,
+  OUT UINT32                      *Indices
+  )
+{
+  UINT32  Index;
+  UINT32  Count;
+  UINT32  Temp;
+
+  Count = 0;
+
+  for (Index = 0; Index < NumRelocs; ++Index) {
+    if ((Relocs[Index].Extern == 0)
+     && (Relocs[Index].SymbolNumber == MACH_RELOC_ABSOLUTE)) {
+      continue;
+    }
+
+    Indices[Count++] = Index;
+
+    if (MachoRelocationIsPairIntel64 ((UINT8)Relocs[Index].Type)) {
+      ++Index;
+    }
+  }
+
+  for (Index = Count / 2; Index > 0; --Index) {
+    InternalSiftDownRelocationIndices (Relocs, Indices, Index - 1, Count);
+  }
+
+  for (Index = Count; Index > 1; --Index) {
+    Temp               = Indices[0];
+    Indices[0]         = Indices[Index - 1];
+    Indices[Index - 1] = Temp;
+    InternalSiftDownRelocationIndices (Relocs, Indices, 0, Index - 1);
+  }
+
+  return Count;
+}
+
+/**
+  Builds the relocation index of Context if there is none yet.
+  The index is optional and is not built when memory is not available.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+  @returns  Whether the index is available.
+
+**/
+STATIC
+BOOLEAN
+InternalInitRelocationIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  )
+{
+  UINT32  NumExtern;
+  UINT32  NumLocal;
+  UINT32  IndexSize;
+
+  if (Context->RelocationIndex != NULL) {
+    return TRUE;
+  }
+
+  if (Context->DisableRelocationIndex) {
+    return FALSE;
+  }
+
+  NumExtern = Context->DySymtab->NumExternalRelocations;
+  NumLocal  = Context->DySymtab->NumOfLocalRelocations;
+
+  if (OcOverflowAddU32 (NumExtern, NumLocal, &IndexSize)
+    || IndexSize == 0
+    || OcOverflowMulU32 (IndexSize, sizeof (*Context->RelocationIndex), &IndexSize)) {
+    return FALSE;
+  }
+
+  Context->RelocationIndex = AllocatePool (IndexSize);
+  if (Context->RelocationIndex == NULL) {
+    return FALSE;
+  }
+
+  Context->NumIndexedExternRelocations = InternalBuildRelocationIndex (
+                                           NumExtern,
+                                           Context->ExternRelocations,
+                                           Context->RelocationIndex
+                                           );
+  Context->NumIndexedLocalRelocations  = InternalBuildRelocationIndex (
+                                           NumLocal,
+                                           Context->LocalRelocations,
+                                           &Context->RelocationIndex[Context->NumIndexedExternRelocations]
+                                           );
+
+  return TRUE;
+}
+
+/**
+  Retrieves a Relocation by the address it targets with binary search.
+
+  @param[in] Address    The address to search for.
+  @param[in] Relocs     Indexed Relocations.
+  @param[in] Indices    Relocation numbers sorted by address.
+  @param[in] NumIndices Number of entries in Indices.
+
+  @retval NULL  NULL is returned on failure.
+
+**/
+STATIC
+MACH_RELOCATION_INFO *
+InternalLookupIndexedRelocation (
+  IN UINT64                Address,
+  IN MACH_RELOCATION_INFO  *Relocs,
+  IN CONST UINT32          *Indices,
+  IN UINT32                NumIndices
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Low  = 0;
+  High = NumIndices;
+
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if ((UINT64)Relocs[Indices[Middle]].Address < Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if (Low < NumIndices && (UINT64)Relocs[Indices[Low]].Address == Address) {
+    return &Relocs[Indices[Low]];
+  }
+
+  return NULL;
+}
+
+VOID
+MachoFreeRelocationIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  if (Context->RelocationIndex != NULL) {
+    FreePool (Context->RelocationIndex);
+    Context->RelocationIndex             = NULL;
+    Context->NumIndexedExternRelocations = 0;
+    Context->NumIndexedLocalRelocations  = 0;
+  }
+}
+
 /**
   Retrieves an extern Relocation by the address it targets.
 
@@ -128,6 +342,15 @@ InternalGetExternRelocationByOffset (
   IN     UINT64            Address
   )
 {
+  if (InternalInitRelocationIndex (Context)) {
+    return InternalLookupIndexedRelocation (
+             Address,
+             Context->ExternRelocations,
+             Context->RelocationIndex,
+             Context->NumIndexedExternRelocations
+             );
+  }
+
   return InternalLookupRelocationByOffset (
            Address,
            Context->DySymtab->NumExternalRelocations,
@@ -150,6 +373,15 @@ InternalGetLocalRelocationByOffset (
   IN     UINT64            Address
   )
 {
+  if (InternalInitRelocationIndex (Context)) {
+    return InternalLookupIndexedRelocation (
+             Address,
+             Context->LocalRelocations,
+             &Context->RelocationIndex[Context->NumIndexedExternRelocations],
+             Context->NumIndexedLocalRelocations
+             );
+  }
+
   return InternalLookupRelocationByOffset (
            Address,
            Context->DySymtab->NumOfLocalRelocations,
@@ -23,6 +23,12 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
 
+//
+// Get memory descriptor by index.
+//
+#define MEMORY_DESCRIPTOR_AT(MemoryMap, Index, DescriptorSize) \
+  ((EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) (MemoryMap) + (Index) * (DescriptorSize)))
+
 EFI_MEMORY_DESCRIPTOR *
 OcGetCurrentMemoryMap (
   OUT UINTN   *MemoryMapSize,
@@ -208,6 +214,119 @@ OcGetCurrentMemoryMapAlloc (
   return Status;
 }
 
+/**
+  Swap two memory descriptors including any data past EFI_MEMORY_DESCRIPTOR.
+
+  @param[in,out]  First           First descriptor.
+  @param[in,out]  Second          Second descriptor.
+  @param[in]      DescriptorSize  Memory map descriptor size in bytes.
+**/
+STATIC
+VOID
+SwapMemoryDescriptors (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *First,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *Second,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  UINT64  *FirstWords;
+  UINT64  *SecondWords;
+  UINT64  Word;
+  UINT8   *FirstBytes;
+  UINT8   *SecondBytes;
+  UINT8   Byte;
+  UINTN   Index;
+
+  //
+  // Descriptor size is a multiple of 8 in practice, but is not required to be.
+  //
+  if (DescriptorSize % sizeof (UINT64) == 0) {
+    FirstWords  = (UINT64 *) First;
+    SecondWords = (UINT64 *) Second;
+    for (Index = 0; Index < DescriptorSize / sizeof (UINT64); ++Index) {
+      Word               = FirstWords[Index];
+      FirstWords[Index]  = SecondWords[Index];
+      SecondWords[Index] = Word;
+    }
+  } else {
+    FirstBytes  = (UINT8 *) First;
+    SecondBytes = (UINT8 *) Second;
+    for (Index = 0; Index < DescriptorSize; ++Index) {
+      Byte               = FirstBytes[Index];
+      FirstBytes[Index]  = SecondBytes[Index];
+      SecondBytes[Index] = Byte;
+    }
+  }
+}
+
+/**
+  Check whether memory descriptor goes after another one in a sorted map.
+  Descriptors with equal PhysicalStart are ordered by NumberOfPages and Type,
+  so that the sorted map does not depend on the original entry order.
+
+  @param[in]  First   First descriptor.
+  @param[in]  Second  Second descriptor.
+
+  @retval TRUE if First goes after Second.
+**/
+STATIC
+BOOLEAN
+IsMemoryDescriptorAfter (
+  IN CONST EFI_MEMORY_DESCRIPTOR  *First,
+  IN CONST EFI_MEMORY_DESCRIPTOR  *Second
+  )
+{
+  if (First->PhysicalStart != Second->PhysicalStart) {
+    return First->PhysicalStart > Second->PhysicalStart;
+  }
+
+  if (First->NumberOfPages != Second->NumberOfPages) {
+    return First->NumberOfPages > Second->NumberOfPages;
+  }
+
+  return First->Type > Second->Type;
+}
+
+/**
+  Restore max-heap property for the subtree at Root.
+
+  @param[in,out]  MemoryMap       Memory map heap.
+  @param[in]      Root            Subtree root index.
+  @param[in]      EntryCount      Heap size in entries.
+  @param[in]      DescriptorSize  Memory map descriptor size in bytes.
+**/
+STATIC
+VOID
+SiftDownMemoryDescriptor (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  Root,
+  IN     UINTN                  EntryCount,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *RootDesc;
+  EFI_MEMORY_DESCRIPTOR  *ChildDesc;
+  UINTN                  Child;
+
+  while (Root < EntryCount / 2) {
+    Child     = 2 * Root + 1;
+    ChildDesc = MEMORY_DESCRIPTOR_AT (MemoryMap, Child, DescriptorSize);
+    if (Child + 1 < EntryCount
+      && IsMemoryDescriptorAfter (NEXT_MEMORY_DESCRIPTOR (ChildDesc, DescriptorSize), ChildDesc)) {
+      ++Child;
+      ChildDesc = NEXT_MEMORY_DESCRIPTOR (ChildDesc, DescriptorSize);
+    }
+
+    RootDesc = MEMORY_DESCRIPTOR_AT (MemoryMap, Root, DescriptorSize);
+    if (!IsMemoryDescriptorAfter (ChildDesc, RootDesc)) {
+      return;
+    }
+
+    SwapMemoryDescriptors (RootDesc, ChildDesc, DescriptorSize);
+    Root = Child;
+  }
+}
+
 VOID
 OcSortMemoryMap (
   IN UINTN                      MemoryMapSize,
@@ -215,27 +334,42 @@ OcSortMemoryMap (
   IN UINTN                      DescriptorSize
   )
 {
-  EFI_MEMORY_DESCRIPTOR       *MemoryMapEntry;
-  EFI_MEMORY_DESCRIPTOR       *NextMemoryMapEntry;
-  EFI_MEMORY_DESCRIPTOR       *MemoryMapEnd;
-  EFI_MEMORY_DESCRIPTOR       TempMemoryMap;
-
-  MemoryMapEntry = MemoryMap;
-  NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
-  MemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + MemoryMapSize);
-  while (MemoryMapEntry < MemoryMapEnd) {
-    while (NextMemoryMapEntry < MemoryMapEnd) {
-      if (MemoryMapEntry->PhysicalStart > NextMemoryMapEntry->PhysicalStart) {
-        CopyMem (&TempMemoryMap, MemoryMapEntry, sizeof(EFI_MEMORY_DESCRIPTOR));
-        CopyMem (MemoryMapEntry, NextMemoryMapEntry, sizeof(EFI_MEMORY_DESCRIPTOR));
-        CopyMem (NextMemoryMapEntry, &TempMemoryMap, sizeof(EFI_MEMORY_DESCRIPTOR));
-      }
+  UINTN                  EntryCount;
+  UINTN                  Index;
+  EFI_MEMORY_DESCRIPTOR  *Desc;
 
-      NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
+  EntryCount = MemoryMapSize / DescriptorSize;
+
+  //
+  // Most firmwares return sorted memory map, do not touch it then.
+  //
+  Desc = MemoryMap;
+  for (Index = 1; Index < EntryCount; ++Index) {
+    if (IsMemoryDescriptorAfter (Desc, NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize))) {
+      break;
     }
+    Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize);
+  }
+
+  if (Index >= EntryCount) {
+    return;
+  }
 
-    MemoryMapEntry      = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
-    NextMemoryMapEntry  = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+  //
+  // Heap sort in place, as descriptor count is not bounded and
+  // memory cannot be allocated from GetMemoryMap.
+  //
+  for (Index = EntryCount / 2; Index > 0; --Index) {
+    SiftDownMemoryDescriptor (MemoryMap, Index - 1, EntryCount, DescriptorSize);
+  }
+
+  for (Index = EntryCount - 1; Index > 0; --Index) {
+    SwapMemoryDescriptors (
+      MemoryMap,
+      MEMORY_DESCRIPTOR_AT (MemoryMap, Index, DescriptorSize),
+      DescriptorSize
+      );
+    SiftDownMemoryDescriptor (MemoryMap, 0, Index, DescriptorSize);
   }
 }
 
@@ -247,13 +381,12 @@ OcShrinkMemoryMap (
   )
 {
   EFI_STATUS              Status;
-  UINTN                   SizeFromDescToEnd;
+  UINTN                   EntriesToGo;
   UINT64                  Bytes;
   EFI_MEMORY_DESCRIPTOR   *PrevDesc;
   EFI_MEMORY_DESCRIPTOR   *Desc;
   BOOLEAN                 CanBeJoinedFree;
   BOOLEAN                 CanBeJoinedRt;
-  BOOLEAN                 HasEntriesToRemove;
 
   Status = EFI_NOT_FOUND;
 
@@ -261,13 +394,16 @@ OcShrinkMemoryMap (
     return Status;
   }
 
-  PrevDesc           = MemoryMap;
-  Desc               = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
-  SizeFromDescToEnd  = *MemoryMapSize - DescriptorSize;
-  *MemoryMapSize     = DescriptorSize;
-  HasEntriesToRemove = FALSE;
+  //
+  // PrevDesc is the last written entry, Desc is the next entry to read.
+  // Entries are moved once as they are read.
+  //
+  PrevDesc       = MemoryMap;
+  Desc           = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+  EntriesToGo    = *MemoryMapSize / DescriptorSize - 1;
+  *MemoryMapSize = DescriptorSize;
 
-  while (SizeFromDescToEnd > 0) {
+  while (EntriesToGo > 0) {
     Bytes = EFI_PAGES_TO_SIZE (PrevDesc->NumberOfPages);
     CanBeJoinedFree = FALSE;
     CanBeJoinedRt   = FALSE;
@@ -306,11 +442,9 @@ OcShrinkMemoryMap (
       //
       PrevDesc->Type           = EfiConventionalMemory;
       PrevDesc->NumberOfPages += Desc->NumberOfPages;
-      HasEntriesToRemove       = TRUE;
       Status                   = EFI_SUCCESS;
     } else if (CanBeJoinedRt) {
       PrevDesc->NumberOfPages += Desc->NumberOfPages;
-      HasEntriesToRemove       = TRUE;
       Status                   = EFI_SUCCESS;
     } else {
       //
@@ -318,29 +452,16 @@ OcShrinkMemoryMap (
       //
       *MemoryMapSize += DescriptorSize;
       PrevDesc        = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
-      if (HasEntriesToRemove) {
-        //
-        // Have entries between PrevDesc and Desc which are joined to PrevDesc,
-        // we need to copy [Desc, end of list] to PrevDesc + 1
-        //
-        CopyMem (PrevDesc, Desc, SizeFromDescToEnd);
-        Desc = PrevDesc;
-        HasEntriesToRemove = FALSE;
+      if (PrevDesc != Desc) {
+        CopyMem (PrevDesc, Desc, DescriptorSize);
       }
     }
 
     Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize);
-    SizeFromDescToEnd -= DescriptorSize;
-  }
-
-  //
-  // Handle last entries if they were merged.
-  //
-  if (HasEntriesToRemove) {
-    *MemoryMapSize += DescriptorSize;
+    --EntriesToGo;
   }
 
-  return EFI_SUCCESS;
+  return Status;
 }
 
 EFI_STATUS
@@ -354,8 +475,6 @@ OcDeduplicateDescriptors (
   UINTN                   EntriesToGo;
   EFI_MEMORY_DESCRIPTOR   *PrevDesc;
   EFI_MEMORY_DESCRIPTOR   *Desc;
-  BOOLEAN                 IsDuplicate;
-  BOOLEAN                 HasEntriesToRemove;
 
   Status = EFI_NOT_FOUND;
 
@@ -363,36 +482,30 @@ OcDeduplicateDescriptors (
     return Status;
   }
 
-  PrevDesc           = MemoryMap;
-  Desc               = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
-  EntriesToGo        = *EntryCount - 1;
-  *EntryCount        = 1;
-  HasEntriesToRemove = FALSE;
+  //
+  // PrevDesc is the last written entry, Desc is the next entry to read.
+  // Entries are moved once as they are read.
+  //
+  PrevDesc    = MemoryMap;
+  Desc        = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+  EntriesToGo = *EntryCount - 1;
+  *EntryCount = 1;
 
   while (EntriesToGo > 0) {
-    IsDuplicate = Desc->PhysicalStart == PrevDesc->PhysicalStart
-      && Desc->NumberOfPages == PrevDesc->NumberOfPages;
-
-    if (IsDuplicate) {
+    if (Desc->PhysicalStart == PrevDesc->PhysicalStart
+      && Desc->NumberOfPages == PrevDesc->NumberOfPages) {
       //
       // Two entries are duplicate, remove them.
       //
-      Status               = EFI_SUCCESS;
-      HasEntriesToRemove   = TRUE;
+      Status = EFI_SUCCESS;
     } else {
       //
       // Not duplicates - we need to move to next
       //
       ++(*EntryCount);
       PrevDesc = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
-      if (HasEntriesToRemove) {
-        //
-        // Have same entries between PrevDesc and Desc which are replaced by PrevDesc,
-        // we need to copy [Desc, end of list] to PrevDesc + 1.
-        //
-        CopyMem (PrevDesc, Desc, EntriesToGo * DescriptorSize);
-        Desc = PrevDesc;
-        HasEntriesToRemove = FALSE;
+      if (PrevDesc != Desc) {
+        CopyMem (PrevDesc, Desc, DescriptorSize);
       }
     }
 
@@ -400,13 +513,6 @@ OcDeduplicateDescriptors (
     --EntriesToGo;
   }
 
-  //
-  // Handle last entries if they were deduplicated.
-  //
-  if (HasEntriesToRemove) {
-    ++(*EntryCount);
-  }
-
   return Status;
 }
 
@@ -17,6 +17,169 @@
 #include <Library/DebugLib.h>
 #include <Library/OcMiscLib.h>
 
+#include "DataPatcherInternal.h"
+
+//
+// Searches shorter than this are done without skip table preparation.
+//
+#define PATTERN_SEARCH_MIN_DATA  64U
+
+VOID
+InternalPreparePatternSearch (
+  OUT PATTERN_SEARCH  *Search,
+  IN  CONST UINT8     *Pattern,
+  IN  CONST UINT8     *PatternMask OPTIONAL,
+  IN  UINT32          PatternSize
+  )
+{
+  UINT32  Index;
+  UINT32  RunStart;
+  UINT32  RunSize;
+  UINT32  Shift;
+
+  Search->Pattern     = Pattern;
+  Search->PatternMask = PatternMask;
+  Search->PatternSize = PatternSize;
+
+  //
+  // Masked patterns are anchored on the longest fully unmasked run.
+  //
+  if (PatternMask == NULL) {
+    Search->AnchorOffset = 0;
+    Search->AnchorSize   = PatternSize;
+  } else {
+    Search->AnchorOffset = 0;
+    Search->AnchorSize   = 0;
+    RunStart             = 0;
+    RunSize              = 0;
+    for (Index = 0; Index < PatternSize; ++Index) {
+      if (PatternMask[Index] != 0xFF) {
+        RunSize = 0;
+        continue;
+      }
+
+      if (RunSize == 0) {
+        RunStart = Index;
+      }
+
+      ++RunSize;
+      if (RunSize > Search->AnchorSize) {
+        Search->AnchorOffset = RunStart;
+        Search->AnchorSize   = RunSize;
+      }
+    }
+  }
+
+  if (Search->AnchorSize == 0) {
+    return;
+  }
+
+  for (Index = 0; Index < ARRAY_SIZE (Search->Shift); ++Index) {
+    Search->Shift[Index] = Search->AnchorSize;
+  }
+
+  for (Index = 0; Index < Search->AnchorSize - 1; ++Index) {
+    Shift = Search->AnchorSize - 1 - Index;
+    Search->Shift[Pattern[Search->AnchorOffset + Index]] = Shift;
+  }
+}
+
+BOOLEAN
+InternalPatternMatches (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN UINT32        PatternSize,
+  IN CONST UINT8   *Data
+  )
+{
+  UINT32  Index;
+
+  if (PatternMask == NULL) {
+    return CompareMem (Data, Pattern, PatternSize) == 0;
+  }
+
+  for (Index = 0; Index < PatternSize; ++Index) {
+    if ((Data[Index] & PatternMask[Index]) != Pattern[Index]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Find pattern with brute force, used for short data and patterns
+  with no unmasked bytes.
+**/
+STATIC
+INT32
+InternalFindPatternSimple (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN UINT32        PatternSize,
+  IN CONST UINT8   *Data,
+  IN UINT32        DataSize,
+  IN UINT32        DataOff
+  )
+{
+  while (DataOff + PatternSize < DataSize) {
+    if (InternalPatternMatches (Pattern, PatternMask, PatternSize, &Data[DataOff])) {
+      return (INT32) DataOff;
+    }
+    ++DataOff;
+  }
+
+  return -1;
+}
+
+INT32
+InternalFindPreparedPattern (
+  IN CONST PATTERN_SEARCH  *Search,
+  IN CONST UINT8           *Data,
+  IN UINT32                DataSize,
+  IN UINT32                DataOff
+  )
+{
+  CONST UINT8  *Anchor;
+  UINT32       AnchorLast;
+  UINT32       PatternSize;
+  UINT32       AnchorOffset;
+  UINT32       AnchorSize;
+  UINT8        Last;
+
+  PatternSize = Search->PatternSize;
+
+  if (Search->AnchorSize == 0) {
+    return InternalFindPatternSimple (
+      Search->Pattern,
+      Search->PatternMask,
+      PatternSize,
+      Data,
+      DataSize,
+      DataOff
+      );
+  }
+
+  AnchorOffset = Search->AnchorOffset;
+  AnchorSize   = Search->AnchorSize;
+  Anchor       = &Search->Pattern[AnchorOffset];
+  AnchorLast   = AnchorOffset + AnchorSize - 1;
+  Last         = Anchor[AnchorSize - 1];
+
+  while (DataOff + PatternSize < DataSize) {
+    if (Data[DataOff + AnchorLast] == Last
+      && CompareMem (&Data[DataOff + AnchorOffset], Anchor, AnchorSize - 1) == 0
+      && (AnchorSize == PatternSize
+        || InternalPatternMatches (Search->Pattern, Search->PatternMask, PatternSize, &Data[DataOff]))) {
+      return (INT32) DataOff;
+    }
+
+    DataOff += Search->Shift[Data[DataOff + AnchorLast]];
+  }
+
+  return -1;
+}
+
 INT32
 FindPattern (
   IN CONST UINT8   *Pattern,
@@ -27,8 +190,7 @@ FindPattern (
   IN INT32         DataOff
   )
 {
-  BOOLEAN  Matches;
-  UINT32   Index;
+  PATTERN_SEARCH  Search;
 
   ASSERT (DataOff >= 0);
 
@@ -36,23 +198,12 @@ FindPattern (
     return -1;
   }
 
-  while (DataOff + PatternSize < DataSize) {
-    Matches = TRUE;
-    for (Index = 0; Index < PatternSize; ++Index) {
-      if ((PatternMask == NULL && Data[DataOff + Index] != Pattern[Index])
-      || (PatternMask != NULL && (Data[DataOff + Index] & PatternMask[Index]) != Pattern[Index])) {
-        Matches = FALSE;
-        break;
-      }
-    }
-
-    if (Matches) {
-      return DataOff;
-    }
-    ++DataOff;
+  if (DataSize - DataOff < PATTERN_SEARCH_MIN_DATA) {
+    return InternalFindPatternSimple (Pattern, PatternMask, PatternSize, Data, DataSize, (UINT32) DataOff);
   }
 
-  return -1;
+  InternalPreparePatternSearch (&Search, Pattern, PatternMask, PatternSize);
+  return InternalFindPreparedPattern (&Search, Data, DataSize, (UINT32) DataOff);
 }
 
 UINT32
@@ -68,14 +219,25 @@ ApplyPatch (
   IN UINT32        Skip
   )
 {
-  UINT32  ReplaceCount;
-  INT32   DataOff;
+  UINT32          ReplaceCount;
+  INT32           DataOff;
+  PATTERN_SEARCH  Search;
+
+  if (PatternSize == 0 || DataSize == 0 || DataSize < PatternSize) {
+    return 0;
+  }
+
+  InternalPreparePatternSearch (&Search, Pattern, PatternMask, PatternSize);
 
   ReplaceCount = 0;
   DataOff = 0;
 
   do {
-    DataOff = FindPattern (Pattern, PatternMask, PatternSize, Data, DataSize, DataOff);
+    if ((UINT32) DataOff >= DataSize || DataSize - DataOff < PatternSize) {
+      break;
+    }
+
+    DataOff = InternalFindPreparedPattern (&Search, Data, DataSize, (UINT32) DataOff);
 
     if (DataOff >= 0) {
       //
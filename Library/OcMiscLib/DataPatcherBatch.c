@@ -0,0 +1,704 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcMiscLib.h>
+
+#include "DataPatcherInternal.h"
+
+//
+// All patterns are matched with an Aho-Corasick automaton built over pattern
+// anchors. Unmasked patterns use the whole pattern as an anchor, masked ones
+// use their longest fully unmasked run and are verified on anchor match.
+// Matches are collected on the original data and then patches are applied in
+// order. Each match is verified again before replacement, as earlier patches
+// could have changed the data, and when earlier patches could have created
+// a new match for a patch, it is applied with sequential search instead.
+// Anchors and skip tables are shared with FindPattern.
+//
+
+#define PATCH_BATCH_NONE     MAX_UINT32
+#define PATCH_BATCH_ALPHABET 256U
+
+//
+// Limit automaton size to a sane value (32 MB transition table).
+//
+#define PATCH_BATCH_MAX_STATES  (32U * 1024U)
+
+typedef struct {
+  //
+  // Prepared pattern with anchor, also used for searching replaced regions.
+  //
+  PATTERN_SEARCH  Search;
+  //
+  // Next patch with the same anchor or PATCH_BATCH_NONE.
+  //
+  UINT32   NextSameAnchor;
+  //
+  // Pattern is masked and needs to be verified on anchor match.
+  //
+  BOOLEAN  Verify;
+  //
+  // Use sequential search for this patch.
+  //
+  BOOLEAN  Sequential;
+  //
+  // Collected match offsets in ascending order.
+  //
+  UINT32   *Matches;
+  UINT32   MatchCount;
+  UINT32   MatchAllocCount;
+} PATCH_BATCH_STATE;
+
+typedef struct {
+  UINT32  Offset;
+  UINT32  Size;
+} PATCH_BATCH_REGION;
+
+typedef struct {
+  //
+  // Transition table, State * PATCH_BATCH_ALPHABET + Byte.
+  //
+  UINT32  *Transitions;
+  //
+  // Failure link per state.
+  //
+  UINT32  *Failures;
+  //
+  // First patch with anchor ending at this state or PATCH_BATCH_NONE.
+  //
+  UINT32  *Outputs;
+  //
+  // Closest failure state with outputs or 0.
+  //
+  UINT32  *OutputLinks;
+  UINT32  StateCount;
+} PATCH_BATCH_AUTOMATON;
+
+/**
+  Check whether Offset is a valid match start for ApplyPatch window.
+  FindPattern never reports matches ending at the window end.
+**/
+STATIC
+BOOLEAN
+InternalPatchInWindow (
+  IN CONST PATCH_BATCH_ENTRY  *Patch,
+  IN UINT32                   Offset
+  )
+{
+  return Offset >= Patch->DataOffset
+    && Patch->PatternSize < Patch->DataSize
+    && Offset - Patch->DataOffset < Patch->DataSize - Patch->PatternSize;
+}
+
+STATIC
+VOID
+InternalPatchReplaceAt (
+  IN     CONST PATCH_BATCH_ENTRY  *Patch,
+  IN OUT UINT8                    *Data,
+  IN     UINT32                   Offset
+  )
+{
+  UINT32  Index;
+
+  if (Patch->ReplaceMask == NULL) {
+    CopyMem (&Data[Offset], Patch->Replace, Patch->PatternSize);
+  } else {
+    for (Index = 0; Index < Patch->PatternSize; ++Index) {
+      Data[Offset + Index] = (Data[Offset + Index] & ~Patch->ReplaceMask[Index])
+        | (Patch->Replace[Index] & Patch->ReplaceMask[Index]);
+    }
+  }
+}
+
+STATIC
+BOOLEAN
+InternalPatchRecordRegion (
+  IN OUT PATCH_BATCH_REGION  **Regions,
+  IN OUT UINT32              *RegionCount,
+  IN OUT UINT32              *RegionAllocCount,
+  IN     UINT32              Offset,
+  IN     UINT32              Size
+  )
+{
+  PATCH_BATCH_REGION  *NewRegions;
+
+  if (*RegionCount == *RegionAllocCount) {
+    NewRegions = AllocatePool (2 * (*RegionAllocCount + 8) * sizeof (**Regions));
+    if (NewRegions == NULL) {
+      return FALSE;
+    }
+
+    if (*Regions != NULL) {
+      CopyMem (NewRegions, *Regions, *RegionCount * sizeof (**Regions));
+      FreePool (*Regions);
+    }
+
+    *Regions          = NewRegions;
+    *RegionAllocCount = 2 * (*RegionAllocCount + 8);
+  }
+
+  (*Regions)[*RegionCount].Offset = Offset;
+  (*Regions)[*RegionCount].Size   = Size;
+  ++(*RegionCount);
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+InternalPatchAddMatch (
+  IN OUT PATCH_BATCH_STATE  *State,
+  IN     UINT32             Offset
+  )
+{
+  UINT32  *NewMatches;
+
+  if (State->MatchCount == State->MatchAllocCount) {
+    NewMatches = AllocatePool (2 * (State->MatchAllocCount + 8) * sizeof (*NewMatches));
+    if (NewMatches == NULL) {
+      return FALSE;
+    }
+
+    if (State->Matches != NULL) {
+      CopyMem (NewMatches, State->Matches, State->MatchCount * sizeof (*NewMatches));
+      FreePool (State->Matches);
+    }
+
+    State->Matches         = NewMatches;
+    State->MatchAllocCount = 2 * (State->MatchAllocCount + 8);
+  }
+
+  State->Matches[State->MatchCount] = Offset;
+  ++State->MatchCount;
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+InternalPatchHasMatch (
+  IN CONST PATCH_BATCH_STATE  *State,
+  IN UINT32                   Offset
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Low  = 0;
+  High = State->MatchCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (State->Matches[Middle] < Offset) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low < State->MatchCount && State->Matches[Low] == Offset;
+}
+
+STATIC
+VOID
+InternalPatchFreeAutomaton (
+  IN OUT PATCH_BATCH_AUTOMATON  *Automaton
+  )
+{
+  if (Automaton->Transitions != NULL) {
+    FreePool (Automaton->Transitions);
+  }
+  if (Automaton->Failures != NULL) {
+    FreePool (Automaton->Failures);
+  }
+  if (Automaton->Outputs != NULL) {
+    FreePool (Automaton->Outputs);
+  }
+  if (Automaton->OutputLinks != NULL) {
+    FreePool (Automaton->OutputLinks);
+  }
+
+  ZeroMem (Automaton, sizeof (*Automaton));
+}
+
+STATIC
+BOOLEAN
+InternalPatchBuildAutomaton (
+  IN     CONST PATCH_BATCH_ENTRY  *Patches,
+  IN OUT PATCH_BATCH_STATE        *States,
+  IN     UINT32                   PatchCount,
+  IN     UINT32                   MaxStates,
+  OUT    PATCH_BATCH_AUTOMATON    *Automaton
+  )
+{
+  UINT32       Index;
+  UINT32       State;
+  UINT32       Next;
+  UINT32       Fail;
+  UINT32       Byte;
+  UINT32       *Queue;
+  UINT32       QueueHead;
+  UINT32       QueueTail;
+  CONST UINT8  *Anchor;
+
+  ZeroMem (Automaton, sizeof (*Automaton));
+
+  Automaton->Transitions = AllocatePool (MaxStates * PATCH_BATCH_ALPHABET * sizeof (UINT32));
+  Automaton->Failures    = AllocateZeroPool (MaxStates * sizeof (UINT32));
+  Automaton->Outputs     = AllocatePool (MaxStates * sizeof (UINT32));
+  Automaton->OutputLinks = AllocateZeroPool (MaxStates * sizeof (UINT32));
+  Queue                  = AllocatePool (MaxStates * sizeof (UINT32));
+
+  if (Automaton->Transitions == NULL || Automaton->Failures == NULL
+    || Automaton->Outputs == NULL || Automaton->OutputLinks == NULL || Queue == NULL) {
+    if (Queue != NULL) {
+      FreePool (Queue);
+    }
+    InternalPatchFreeAutomaton (Automaton);
+    return FALSE;
+  }
+
+  SetMem32 (Automaton->Transitions, MaxStates * PATCH_BATCH_ALPHABET * sizeof (UINT32), PATCH_BATCH_NONE);
+  SetMem32 (Automaton->Outputs, MaxStates * sizeof (UINT32), PATCH_BATCH_NONE);
+  Automaton->StateCount = 1;
+
+  //
+  // Build the trie of anchors.
+  //
+  for (Index = 0; Index < PatchCount; ++Index) {
+    if (Patches[Index].Pattern == NULL || States[Index].Sequential) {
+      continue;
+    }
+
+    Anchor = &Patches[Index].Pattern[States[Index].Search.AnchorOffset];
+    State  = 0;
+    for (Byte = 0; Byte < States[Index].Search.AnchorSize; ++Byte) {
+      Next = Automaton->Transitions[State * PATCH_BATCH_ALPHABET + Anchor[Byte]];
+      if (Next == PATCH_BATCH_NONE) {
+        ASSERT (Automaton->StateCount < MaxStates);
+        Next = Automaton->StateCount++;
+        Automaton->Transitions[State * PATCH_BATCH_ALPHABET + Anchor[Byte]] = Next;
+      }
+      State = Next;
+    }
+
+    States[Index].NextSameAnchor = Automaton->Outputs[State];
+    Automaton->Outputs[State]    = Index;
+  }
+
+  //
+  // Compute failure links breadth-first and complete the transition table.
+  //
+  QueueHead = 0;
+  QueueTail = 0;
+  for (Byte = 0; Byte < PATCH_BATCH_ALPHABET; ++Byte) {
+    Next = Automaton->Transitions[Byte];
+    if (Next == PATCH_BATCH_NONE) {
+      Automaton->Transitions[Byte] = 0;
+    } else {
+      Automaton->Failures[Next] = 0;
+      Queue[QueueTail++]        = Next;
+    }
+  }
+
+  while (QueueHead < QueueTail) {
+    State = Queue[QueueHead++];
+    Fail  = Automaton->Failures[State];
+    for (Byte = 0; Byte < PATCH_BATCH_ALPHABET; ++Byte) {
+      Next = Automaton->Transitions[State * PATCH_BATCH_ALPHABET + Byte];
+      if (Next == PATCH_BATCH_NONE) {
+        Automaton->Transitions[State * PATCH_BATCH_ALPHABET + Byte] =
+          Automaton->Transitions[Fail * PATCH_BATCH_ALPHABET + Byte];
+      } else {
+        Automaton->Failures[Next] = Automaton->Transitions[Fail * PATCH_BATCH_ALPHABET + Byte];
+        if (Automaton->Outputs[Automaton->Failures[Next]] != PATCH_BATCH_NONE) {
+          Automaton->OutputLinks[Next] = Automaton->Failures[Next];
+        } else {
+          Automaton->OutputLinks[Next] = Automaton->OutputLinks[Automaton->Failures[Next]];
+        }
+        Queue[QueueTail++] = Next;
+      }
+    }
+  }
+
+  FreePool (Queue);
+  return TRUE;
+}
+
+/**
+  Collect all pattern matches in one pass over the data.
+
+  @retval FALSE  Out of resources.
+**/
+STATIC
+BOOLEAN
+InternalPatchCollectMatches (
+  IN     CONST UINT8                  *Data,
+  IN     CONST PATCH_BATCH_ENTRY      *Patches,
+  IN OUT PATCH_BATCH_STATE            *States,
+  IN     CONST PATCH_BATCH_AUTOMATON  *Automaton,
+  IN     UINT32                       ScanStart,
+  IN     UINT32                       ScanEnd
+  )
+{
+  UINT32  Offset;
+  UINT32  State;
+  UINT32  Output;
+  UINT32  Index;
+  UINT32  AnchorStart;
+  UINT32  MatchStart;
+
+  State = 0;
+  for (Offset = ScanStart; Offset < ScanEnd; ++Offset) {
+    State = Automaton->Transitions[State * PATCH_BATCH_ALPHABET + Data[Offset]];
+
+    Output = Automaton->Outputs[State] != PATCH_BATCH_NONE ? State : Automaton->OutputLinks[State];
+    while (Output != 0) {
+      for (Index = Automaton->Outputs[Output]; Index != PATCH_BATCH_NONE; Index = States[Index].NextSameAnchor) {
+        AnchorStart = Offset + 1 - States[Index].Search.AnchorSize;
+        if (AnchorStart < States[Index].Search.AnchorOffset) {
+          continue;
+        }
+
+        MatchStart = AnchorStart - States[Index].Search.AnchorOffset;
+        if (!InternalPatchInWindow (&Patches[Index], MatchStart)
+          || (States[Index].Verify && !InternalPatternMatches (
+            Patches[Index].Pattern,
+            Patches[Index].PatternMask,
+            Patches[Index].PatternSize,
+            &Data[MatchStart]
+            ))) {
+          continue;
+        }
+
+        if (!InternalPatchAddMatch (&States[Index], MatchStart)) {
+          return FALSE;
+        }
+      }
+
+      Output = Automaton->OutputLinks[Output];
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Check whether data changes in Regions could have created new matches.
+  Only data around each region is searched. When this gets larger than
+  the patch window, e.g. with many overlapping regions, TRUE is returned
+  as sequential search is cheaper than the rescan.
+**/
+STATIC
+BOOLEAN
+InternalPatchHasNewMatches (
+  IN CONST UINT8               *Data,
+  IN CONST PATCH_BATCH_ENTRY   *Patch,
+  IN CONST PATCH_BATCH_STATE   *State,
+  IN CONST PATCH_BATCH_REGION  *Regions,
+  IN UINT32                    RegionCount
+  )
+{
+  CONST UINT8  *Window;
+  UINT32       Index;
+  UINT32       RegionStart;
+  UINT32       RegionEnd;
+  UINT32       Start;
+  UINT32       End;
+  UINT32       RescanSize;
+  INT32        Offset;
+
+  if (Patch->PatternSize >= Patch->DataSize) {
+    return FALSE;
+  }
+
+  Window     = &Data[Patch->DataOffset];
+  RescanSize = 0;
+
+  for (Index = 0; Index < RegionCount; ++Index) {
+    RegionStart = Regions[Index].Offset;
+    RegionEnd   = Regions[Index].Offset + Regions[Index].Size;
+    if (RegionEnd <= Patch->DataOffset || RegionStart >= Patch->DataOffset + Patch->DataSize) {
+      continue;
+    }
+
+    //
+    // Search matches overlapping the region, offsets are within patch window.
+    //
+    if (RegionStart >= Patch->DataOffset + Patch->PatternSize) {
+      Start = RegionStart - Patch->DataOffset - Patch->PatternSize + 1;
+    } else {
+      Start = 0;
+    }
+
+    End = MIN (RegionEnd - Patch->DataOffset + Patch->PatternSize, Patch->DataSize);
+
+    RescanSize += End - Start;
+    if (RescanSize >= Patch->DataSize) {
+      return TRUE;
+    }
+
+    Offset = (INT32) Start;
+    while ((Offset = InternalFindPreparedPattern (&State->Search, Window, End, (UINT32) Offset)) >= 0) {
+      if (!InternalPatchHasMatch (State, Patch->DataOffset + (UINT32) Offset)) {
+        return TRUE;
+      }
+      ++Offset;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Apply patch with sequential search like ApplyPatch does.
+
+  @retval FALSE  Failed to record replaced regions.
+**/
+STATIC
+BOOLEAN
+InternalPatchApplySequential (
+  IN OUT UINT8               *Data,
+  IN OUT PATCH_BATCH_ENTRY   *Patch,
+  IN OUT PATCH_BATCH_REGION  **Regions,
+  IN OUT UINT32              *RegionCount,
+  IN OUT UINT32              *RegionAllocCount
+  )
+{
+  BOOLEAN  Recorded;
+  UINT32   Count;
+  UINT32   Skip;
+  INT32    DataOff;
+
+  Recorded = TRUE;
+  Count    = Patch->Count;
+  Skip     = Patch->Skip;
+  DataOff  = 0;
+
+  while (TRUE) {
+    DataOff = FindPattern (
+      Patch->Pattern,
+      Patch->PatternMask,
+      Patch->PatternSize,
+      &Data[Patch->DataOffset],
+      Patch->DataSize,
+      DataOff
+      );
+    if (DataOff < 0) {
+      break;
+    }
+
+    if (Skip > 0) {
+      --Skip;
+      DataOff += Patch->PatternSize;
+      continue;
+    }
+
+    InternalPatchReplaceAt (Patch, Data, Patch->DataOffset + DataOff);
+    Recorded &= InternalPatchRecordRegion (
+      Regions,
+      RegionCount,
+      RegionAllocCount,
+      Patch->DataOffset + DataOff,
+      Patch->PatternSize
+      );
+    ++Patch->ReplaceCount;
+    DataOff += Patch->PatternSize;
+
+    if (Count > 0) {
+      --Count;
+      if (Count == 0) {
+        break;
+      }
+    }
+  }
+
+  return Recorded;
+}
+
+VOID
+ApplyPatchBatch (
+  IN OUT UINT8              *Data,
+  IN     UINT32             DataSize,
+  IN OUT PATCH_BATCH_ENTRY  *Patches,
+  IN     UINT32             PatchCount
+  )
+{
+  PATCH_BATCH_STATE      *States;
+  PATCH_BATCH_STATE      *State;
+  PATCH_BATCH_ENTRY      *Patch;
+  PATCH_BATCH_AUTOMATON  Automaton;
+  PATCH_BATCH_REGION     *Regions;
+  UINT32                 RegionCount;
+  UINT32                 RegionAllocCount;
+  BOOLEAN                RegionsValid;
+  BOOLEAN                HasAutomaton;
+  UINT32                 Index;
+  UINT32                 MatchIndex;
+  UINT32                 Offset;
+  UINT32                 NextOffset;
+  UINT32                 Count;
+  UINT32                 Skip;
+  UINT32                 MaxStates;
+  UINT32                 ScanStart;
+  UINT32                 ScanEnd;
+
+  ASSERT (Data != NULL);
+  ASSERT (Patches != NULL || PatchCount == 0);
+
+  States = AllocateZeroPool (PatchCount * sizeof (*States));
+
+  MaxStates = 1;
+  ScanStart = DataSize;
+  ScanEnd   = 0;
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Patch               = &Patches[Index];
+    Patch->ReplaceCount = 0;
+
+    ASSERT (Patch->DataOffset <= DataSize && Patch->DataSize <= DataSize - Patch->DataOffset);
+
+    if (States == NULL || Patch->Pattern == NULL || Patch->Replace == NULL) {
+      continue;
+    }
+
+    State = &States[Index];
+    InternalPreparePatternSearch (&State->Search, Patch->Pattern, Patch->PatternMask, Patch->PatternSize);
+    State->Verify = Patch->PatternMask != NULL;
+
+    if (State->Search.AnchorSize == 0 || MaxStates + State->Search.AnchorSize > PATCH_BATCH_MAX_STATES) {
+      State->Sequential = TRUE;
+      continue;
+    }
+
+    MaxStates += State->Search.AnchorSize;
+    ScanStart  = MIN (ScanStart, Patch->DataOffset);
+    ScanEnd    = MAX (ScanEnd, Patch->DataOffset + Patch->DataSize);
+  }
+
+  //
+  // Collect matches for all anchored patterns in one pass.
+  //
+  HasAutomaton = FALSE;
+  if (States != NULL && ScanStart < ScanEnd) {
+    HasAutomaton = InternalPatchBuildAutomaton (Patches, States, PatchCount, MaxStates, &Automaton);
+    if (HasAutomaton) {
+      HasAutomaton = InternalPatchCollectMatches (Data, Patches, States, &Automaton, ScanStart, ScanEnd);
+      InternalPatchFreeAutomaton (&Automaton);
+    }
+  }
+
+  if (!HasAutomaton) {
+    DEBUG ((DEBUG_VERBOSE, "OCMC: Applying %u patches sequentially\n", PatchCount));
+  }
+
+  Regions          = NULL;
+  RegionCount      = 0;
+  RegionAllocCount = 0;
+  RegionsValid     = TRUE;
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Patch = &Patches[Index];
+    if (Patch->Replace == NULL || (Patch->Pattern != NULL && Patch->PatternSize == 0)) {
+      continue;
+    }
+
+    //
+    // Patches without find pattern are written at window start as is.
+    //
+    if (Patch->Pattern == NULL) {
+      if (Patch->PatternSize <= Patch->DataSize) {
+        CopyMem (&Data[Patch->DataOffset], Patch->Replace, Patch->PatternSize);
+        RegionsValid &= InternalPatchRecordRegion (
+          &Regions,
+          &RegionCount,
+          &RegionAllocCount,
+          Patch->DataOffset,
+          Patch->PatternSize
+          );
+        Patch->ReplaceCount = 1;
+      }
+      continue;
+    }
+
+    State = States != NULL ? &States[Index] : NULL;
+
+    if (!HasAutomaton || !RegionsValid || State->Sequential
+      || InternalPatchHasNewMatches (Data, Patch, State, Regions, RegionCount)) {
+      RegionsValid &= InternalPatchApplySequential (
+        Data,
+        Patch,
+        &Regions,
+        &RegionCount,
+        &RegionAllocCount
+        );
+      continue;
+    }
+
+    Count      = Patch->Count;
+    Skip       = Patch->Skip;
+    NextOffset = 0;
+
+    for (MatchIndex = 0; MatchIndex < State->MatchCount; ++MatchIndex) {
+      Offset = State->Matches[MatchIndex];
+      //
+      // Matches are not searched within replaced or skipped data,
+      // and could have been removed by earlier patches.
+      //
+      if (Offset < NextOffset
+        || !InternalPatternMatches (Patch->Pattern, Patch->PatternMask, Patch->PatternSize, &Data[Offset])) {
+        continue;
+      }
+
+      NextOffset = Offset + Patch->PatternSize;
+
+      if (Skip > 0) {
+        --Skip;
+        continue;
+      }
+
+      InternalPatchReplaceAt (Patch, Data, Offset);
+      RegionsValid &= InternalPatchRecordRegion (
+        &Regions,
+        &RegionCount,
+        &RegionAllocCount,
+        Offset,
+        Patch->PatternSize
+        );
+      ++Patch->ReplaceCount;
+
+      if (Count > 0) {
+        --Count;
+        if (Count == 0) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (Regions != NULL) {
+    FreePool (Regions);
+  }
+
+  if (States != NULL) {
+    for (Index = 0; Index < PatchCount; ++Index) {
+      if (States[Index].Matches != NULL) {
+        FreePool (States[Index].Matches);
+      }
+    }
+    FreePool (States);
+  }
+}
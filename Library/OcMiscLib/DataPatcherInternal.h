@@ -0,0 +1,90 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#ifndef DATA_PATCHER_INTERNAL_H
+#define DATA_PATCHER_INTERNAL_H
+
+#include <Library/OcMiscLib.h>
+
+typedef struct {
+  CONST UINT8  *Pattern;
+  CONST UINT8  *PatternMask;
+  UINT32       PatternSize;
+  //
+  // Fully unmasked pattern part used for skip table lookup.
+  // AnchorSize is 0 when all pattern bytes are masked.
+  //
+  UINT32       AnchorOffset;
+  UINT32       AnchorSize;
+  //
+  // Horspool shift for the byte aligned with anchor end.
+  //
+  UINT32       Shift[256];
+} PATTERN_SEARCH;
+
+/**
+  Prepare pattern for repeated lookup. Masked patterns are anchored
+  on their longest fully unmasked run.
+
+  @param[out] Search       Search context.
+  @param[in]  Pattern      Pattern to search.
+  @param[in]  PatternMask  Pattern mask or NULL.
+  @param[in]  PatternSize  Pattern size.
+**/
+VOID
+InternalPreparePatternSearch (
+  OUT PATTERN_SEARCH  *Search,
+  IN  CONST UINT8     *Pattern,
+  IN  CONST UINT8     *PatternMask OPTIONAL,
+  IN  UINT32          PatternSize
+  );
+
+/**
+  Check whether pattern matches data.
+
+  @param[in]  Pattern      Pattern to compare.
+  @param[in]  PatternMask  Pattern mask or NULL.
+  @param[in]  PatternSize  Pattern size.
+  @param[in]  Data         Data of at least PatternSize bytes.
+
+  @retval TRUE when data matches.
+**/
+BOOLEAN
+InternalPatternMatches (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN UINT32        PatternSize,
+  IN CONST UINT8   *Data
+  );
+
+/**
+  Find prepared pattern. Like FindPattern does, matches ending
+  at DataSize are not reported.
+
+  @param[in]  Search    Prepared search context.
+  @param[in]  Data      Data to search in.
+  @param[in]  DataSize  Data size.
+  @param[in]  DataOff   Offset to start searching from.
+
+  @retval Match offset or -1.
+**/
+INT32
+InternalFindPreparedPattern (
+  IN CONST PATTERN_SEARCH  *Search,
+  IN CONST UINT8           *Data,
+  IN UINT32                DataSize,
+  IN UINT32                DataOff
+  );
+
+#endif // DATA_PATCHER_INTERNAL_H
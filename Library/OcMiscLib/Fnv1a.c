@@ -0,0 +1,37 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/OcMiscLib.h>
+
+#define OC_FNV1A_PRIME  0x01000193U
+
+UINT32
+Fnv1aUpdate (
+  IN UINT32      Hash,
+  IN CONST VOID  *Buffer,
+  IN UINTN       Length
+  )
+{
+  CONST UINT8  *Bytes;
+  UINTN        Index;
+
+  Bytes = (CONST UINT8 *) Buffer;
+  for (Index = 0; Index < Length; ++Index) {
+    Hash ^= Bytes[Index];
+    Hash *= OC_FNV1A_PRIME;
+  }
+
+  return Hash;
+}
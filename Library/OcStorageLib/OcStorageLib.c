@@ -21,6 +21,7 @@
 #include <Library/DebugLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/OcMiscLib.h>
 #include <Library/OcStringLib.h>
 #include <Library/OcStorageLib.h>
 #include <Library/UefiBootServicesTableLib.h>
@@ -119,6 +120,143 @@ mVaultSchema = {
 };
 
 
+/**
+  Calculate vault file path hash. Characters are hashed by value, so that
+  ASCII vault keys and their Unicode lookups hash equally.
+
+  @param[in]  Path       ASCII path when AsciiPath is TRUE, Unicode otherwise.
+  @param[in]  AsciiPath  Path is ASCII.
+  @param[in]  Length     Path length in characters.
+
+  @retval FNV-1a path hash.
+**/
+STATIC
+UINT32
+OcStorageGetPathHash (
+  IN CONST VOID  *Path,
+  IN BOOLEAN     AsciiPath,
+  IN UINTN       Length
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+  CHAR16  Char;
+
+  if (!AsciiPath) {
+    return Fnv1aUpdate (OC_FNV1A_INIT, Path, Length * sizeof (CHAR16));
+  }
+
+  //
+  // Hash ASCII characters widened to CHAR16.
+  //
+  Hash = OC_FNV1A_INIT;
+  for (Index = 0; Index < Length; ++Index) {
+    Char = (UINT8) ((CONST CHAR8 *) Path)[Index];
+    Hash = Fnv1aUpdate (Hash, &Char, sizeof (Char));
+  }
+
+  return Hash;
+}
+
+/**
+  Build vault digest index. On failure digest lookup walks vault files.
+
+  @param[in,out]  Context  Storage context with vault.
+**/
+STATIC
+VOID
+OcStorageBuildVaultIndex (
+  IN OUT OC_STORAGE_CONTEXT  *Context
+  )
+{
+  UINT32  Count;
+  UINT32  Size;
+  UINT32  Index;
+  UINT32  Slot;
+  UINT32  Probes;
+  UINT32  MaxProbes;
+
+  ASSERT (Context->VaultIndex == NULL);
+
+  Count = Context->Vault.Files.Count;
+  if (Count == 0 || Count > MAX_UINT32 / 4) {
+    return;
+  }
+
+  //
+  // Keep load factor at most 1/2 for short probe sequences.
+  //
+  Size = 1;
+  while (Size < Count * 2) {
+    Size <<= 1U;
+  }
+
+  Context->VaultIndex = AllocateZeroPool (Size * sizeof (*Context->VaultIndex));
+  if (Context->VaultIndex == NULL) {
+    DEBUG ((DEBUG_INFO, "OCST: Vault index allocation failure for %u files\n", Count));
+    return;
+  }
+
+  Context->VaultIndexMask = Size - 1;
+
+  MaxProbes = 0;
+  for (Index = 0; Index < Count; ++Index) {
+    //
+    // Keys without a terminator never match.
+    //
+    if (Context->Vault.Files.Keys[Index]->Size == 0) {
+      continue;
+    }
+
+    Slot = OcStorageGetPathHash (
+      OC_BLOB_GET (Context->Vault.Files.Keys[Index]),
+      TRUE,
+      Context->Vault.Files.Keys[Index]->Size - 1
+      ) & Context->VaultIndexMask;
+
+    Probes = 1;
+    while (Context->VaultIndex[Slot] != 0) {
+      Slot = (Slot + 1) & Context->VaultIndexMask;
+      ++Probes;
+    }
+
+    Context->VaultIndex[Slot] = Index + 1;
+    MaxProbes = MAX (MaxProbes, Probes);
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "OCST: Vault index for %u files uses %u slots (%u bytes) with at most %u probes\n",
+    Count,
+    Size,
+    Size * (UINT32) sizeof (*Context->VaultIndex),
+    MaxProbes
+    ));
+}
+
+/**
+  Free vault and its digest index.
+
+  @param[in,out]  Context  Storage context.
+**/
+STATIC
+VOID
+OcStorageFreeVault (
+  IN OUT OC_STORAGE_CONTEXT  *Context
+  )
+{
+  if (Context->VaultIndex != NULL) {
+    FreePool (Context->VaultIndex);
+    Context->VaultIndex     = NULL;
+    Context->VaultIndexMask = 0;
+  }
+
+  if (Context->HasVault) {
+    OC_STORAGE_VAULT_DESTRUCT (&Context->Vault, sizeof (Context->Vault));
+    Context->HasVault = FALSE;
+  }
+}
+
 STATIC
 EFI_STATUS
 OcStorageInitializeVault (
@@ -169,9 +307,48 @@ OcStorageInitializeVault (
 
   Context->HasVault = TRUE;
 
+  OcStorageBuildVaultIndex (Context);
+
   return EFI_SUCCESS;
 }
 
+/**
+  Compare vault file path to Unicode file name.
+
+  @param[in]  Context       Storage context with vault.
+  @param[in]  Index         Vault file index.
+  @param[in]  Filename      File name.
+  @param[in]  FilenameSize  File name size in characters including terminator.
+
+  @retval TRUE if vault file path matches.
+**/
+STATIC
+BOOLEAN
+OcStorageVaultFileMatches (
+  IN CONST OC_STORAGE_CONTEXT  *Context,
+  IN UINT32                    Index,
+  IN CONST CHAR16              *Filename,
+  IN UINTN                     FilenameSize
+  )
+{
+  UINTN              StrIndex;
+  CHAR8              *VaultFilePath;
+
+  if (Context->Vault.Files.Keys[Index]->Size != (UINT32) FilenameSize) {
+    return FALSE;
+  }
+
+  VaultFilePath = OC_BLOB_GET (Context->Vault.Files.Keys[Index]);
+
+  for (StrIndex = 0; StrIndex < FilenameSize; ++StrIndex) {
+    if (Filename[StrIndex] != VaultFilePath[StrIndex]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 STATIC
 UINT8 *
 OcStorageGetDigest (
@@ -180,8 +357,7 @@ OcStorageGetDigest (
   )
 {
   UINT32             Index;
-  UINTN              StrIndex;
-  CHAR8              *VaultFilePath;
+  UINT32             Slot;
   UINTN              FilenameSize;
 
   if (!Context->HasVault) {
@@ -190,20 +366,22 @@ OcStorageGetDigest (
 
   FilenameSize = StrLen (Filename) + 1;
 
-  for (Index = 0; Index < Context->Vault.Files.Count; ++Index) {
-    if (Context->Vault.Files.Keys[Index]->Size != (UINT32) FilenameSize) {
-      continue;
-    }
-
-    VaultFilePath = OC_BLOB_GET (Context->Vault.Files.Keys[Index]);
-
-    for (StrIndex = 0; StrIndex < FilenameSize; ++StrIndex) {
-      if (Filename[StrIndex] != VaultFilePath[StrIndex]) {
-        break;
+  if (Context->VaultIndex != NULL) {
+    Slot = OcStorageGetPathHash (Filename, FALSE, FilenameSize - 1) & Context->VaultIndexMask;
+    while (Context->VaultIndex[Slot] != 0) {
+      Index = Context->VaultIndex[Slot] - 1;
+      if (OcStorageVaultFileMatches (Context, Index, Filename, FilenameSize)) {
+        return &Context->Vault.Files.Values[Index]->Hash[0];
       }
+
+      Slot = (Slot + 1) & Context->VaultIndexMask;
     }
 
-    if (StrIndex == FilenameSize) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < Context->Vault.Files.Count; ++Index) {
+    if (OcStorageVaultFileMatches (Context, Index, Filename, FilenameSize)) {
       return &Context->Vault.Files.Values[Index]->Hash[0];
     }
   }
@@ -312,10 +490,7 @@ OcStorageFree (
     Context->StorageRoot = NULL;
   }
 
-  if (Context->HasVault) {
-    OC_STORAGE_VAULT_DESTRUCT (&Context->Vault, sizeof (Context->Vault));
-    Context->HasVault = FALSE;
-  }
+  OcStorageFreeVault (Context);
 }
 
 BOOLEAN
@@ -371,9 +546,12 @@ OcStorageReadFileUnicode (
   EFI_STATUS         Status;
   EFI_FILE_PROTOCOL  *File;
   UINT32             Size;
+  UINT32             Offset;
+  UINT32             BlockSize;
   UINT8              *FileBuffer;
   UINT8              *VaultDigest;
   UINT8              FileDigest[SHA256_DIGEST_SIZE];
+  SHA256_CONTEXT     HashContext;
 
   //
   // Using this API with empty filename is also not allowed.
@@ -420,15 +598,31 @@ OcStorageReadFileUnicode (
     return NULL;
   }
 
-  Status = GetFileData (File, 0, Size, FileBuffer);
-  File->Close (File);
-  if (EFI_ERROR (Status)) {
-    FreePool (FileBuffer);
-    return NULL;
+  //
+  // Hash each block right after reading it, while it is still in cache.
+  //
+  if (VaultDigest != NULL) {
+    Sha256Init (&HashContext);
   }
 
-  if (VaultDigest != 0) {
-    Sha256 (FileDigest, FileBuffer, Size);
+  for (Offset = 0; Offset < Size; Offset += BlockSize) {
+    BlockSize = MIN (Size - Offset, OC_STORAGE_READ_BLOCK_SIZE);
+    Status    = GetFileData (File, Offset, BlockSize, &FileBuffer[Offset]);
+    if (EFI_ERROR (Status)) {
+      File->Close (File);
+      FreePool (FileBuffer);
+      return NULL;
+    }
+
+    if (VaultDigest != NULL) {
+      Sha256Update (&HashContext, &FileBuffer[Offset], BlockSize);
+    }
+  }
+
+  File->Close (File);
+
+  if (VaultDigest != NULL) {
+    Sha256Final (&HashContext, FileDigest);
     if (CompareMem (FileDigest, VaultDigest, SHA256_DIGEST_SIZE) != 0) {
       DEBUG ((DEBUG_ERROR, "OCST: Aborting corrupted %s file access\n", FilePath));
       FreePool (FileBuffer);
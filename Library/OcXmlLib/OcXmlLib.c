@@ -44,13 +44,21 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/OcGuardLib.h>
 #include <Library/OcMiscLib.h>
 #include <Library/OcStringLib.h>
 
 //
-// Minimal extra allocation size during export.
+// Minimal key-value pair count to build dictionary key index.
+// Smaller dictionaries are faster to scan.
 //
-#define XML_EXPORT_MIN_ALLOCATION_SIZE 4096
+#define PLIST_DICT_INDEX_MIN_KEYS  16
+
+//
+// Document arena slab size limits.
+//
+#define XML_ARENA_MIN_SLAB_SIZE  SIZE_16KB
+#define XML_ARENA_MAX_SLAB_SIZE  SIZE_2MB
 
 struct XML_NODE_LIST_;
 struct XML_PARSER_;
@@ -58,6 +66,27 @@ struct XML_PARSER_;
 typedef struct XML_NODE_LIST_ XML_NODE_LIST;
 typedef struct XML_PARSER_ XML_PARSER;
 
+//
+// Arena slab, allocated from pages, with data following the header.
+//
+typedef struct XML_ARENA_SLAB_ XML_ARENA_SLAB;
+struct XML_ARENA_SLAB_ {
+  XML_ARENA_SLAB  *Next;
+  UINT32          Size;
+  UINT32          Used;
+};
+
+//
+// Bump allocator owning all document nodes and child lists.
+//
+typedef struct {
+  XML_ARENA_SLAB  *Slabs;
+  VOID            *Last;
+  UINT32          NextSlabSize;
+  UINT32          SlabCount;
+  UINT32          AllocationCount;
+} XML_ARENA;
+
 //
 // An XML_NODE will always contain a tag name and possibly a list of
 // children or text content.
@@ -70,10 +99,21 @@ struct XML_NODE_ {
   XML_NODE_LIST  *Children;
 };
 
+//
+// Dictionary key index, built on first keyed lookup. Slots are an open
+// addressing hash table of key-value pair numbers plus one, 0 is free.
+//
+typedef struct {
+  UINT32  Mask;
+  UINT32  Slots[];
+} XML_NODE_INDEX;
+
 struct XML_NODE_LIST_ {
-  UINT32    NodeCount;
-  UINT32    AllocCount;
-  XML_NODE  *NodeList[];
+  UINT32          NodeCount;
+  UINT32          AllocCount;
+  XML_ARENA       *Arena;
+  XML_NODE_INDEX  *Index;
+  XML_NODE        *NodeList[];
 };
 
 typedef struct {
@@ -93,6 +133,7 @@ struct XML_DOCUMENT_ {
 
   XML_NODE      *Root;
   XML_REFLIST   References;
+  XML_ARENA     Arena;
 };
 
 //
@@ -171,12 +212,125 @@ XmlParseAttributeNumber (
   return TRUE;
 }
 
+//
+// Allocates memory from the document arena.
+//
+STATIC
+VOID *
+XmlArenaAllocate (
+  XML_ARENA  *Arena,
+  UINT32     Size
+  )
+{
+  XML_ARENA_SLAB  *Slab;
+  UINT32          SlabSize;
+  VOID            *Memory;
+
+  Size = ALIGN_VALUE (Size, sizeof (UINT64));
+  Slab = Arena->Slabs;
+
+  if (Slab == NULL || Slab->Size - Slab->Used < Size) {
+    SlabSize = MAX (Arena->NextSlabSize, XML_ARENA_MIN_SLAB_SIZE);
+    if (SlabSize - sizeof (XML_ARENA_SLAB) < Size) {
+      if (OcOverflowAddU32 (Size, sizeof (XML_ARENA_SLAB), &SlabSize)) {
+        return NULL;
+      }
+    }
+
+    SlabSize = (UINT32) EFI_PAGES_TO_SIZE (EFI_SIZE_TO_PAGES (SlabSize));
+    Slab     = AllocatePages (EFI_SIZE_TO_PAGES (SlabSize));
+    if (Slab == NULL) {
+      return NULL;
+    }
+
+    Slab->Next   = Arena->Slabs;
+    Slab->Size   = SlabSize;
+    Slab->Used   = sizeof (XML_ARENA_SLAB);
+    Arena->Slabs = Slab;
+    ++Arena->SlabCount;
+
+    Arena->NextSlabSize = MIN (SlabSize * 2, XML_ARENA_MAX_SLAB_SIZE);
+  }
+
+  Memory      = (UINT8 *) Slab + Slab->Used;
+  Slab->Used += Size;
+  Arena->Last = Memory;
+  ++Arena->AllocationCount;
+
+  return Memory;
+}
+
+//
+// Grows memory from the document arena, in place when it was the last allocation.
+//
+STATIC
+VOID *
+XmlArenaReallocate (
+  XML_ARENA  *Arena,
+  VOID       *Memory,
+  UINT32     OldSize,
+  UINT32     NewSize
+  )
+{
+  XML_ARENA_SLAB  *Slab;
+  VOID            *NewMemory;
+  UINT32          Extra;
+
+  ASSERT (NewSize >= OldSize);
+
+  Slab = Arena->Slabs;
+
+  if (Memory != NULL && Memory == Arena->Last) {
+    OldSize = ALIGN_VALUE (OldSize, sizeof (UINT64));
+    Extra   = ALIGN_VALUE (NewSize, sizeof (UINT64)) - OldSize;
+    if (Slab->Size - Slab->Used >= Extra) {
+      Slab->Used += Extra;
+      return Memory;
+    }
+  }
+
+  NewMemory = XmlArenaAllocate (Arena, NewSize);
+  if (NewMemory != NULL && Memory != NULL) {
+    CopyMem (NewMemory, Memory, OldSize);
+  }
+
+  return NewMemory;
+}
+
+//
+// Frees all memory owned by the document arena.
+//
+STATIC
+VOID
+XmlArenaFree (
+  XML_ARENA  *Arena
+  )
+{
+  XML_ARENA_SLAB  *Slab;
+  XML_ARENA_SLAB  *Next;
+
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "OCXML: Freeing %u allocations in %u slabs\n",
+    Arena->AllocationCount,
+    Arena->SlabCount
+    ));
+
+  for (Slab = Arena->Slabs; Slab != NULL; Slab = Next) {
+    Next = Slab->Next;
+    FreePages (Slab, EFI_SIZE_TO_PAGES (Slab->Size));
+  }
+
+  ZeroMem (Arena, sizeof (*Arena));
+}
+
 //
 // Allocates the node with contents.
 //
 STATIC
 XML_NODE *
 XmlNodeCreate (
+  XML_ARENA      *Arena,
   CONST CHAR8    *Name,
   CONST CHAR8    *Attributes,
   CONST CHAR8    *Content,
@@ -186,7 +340,7 @@ XmlNodeCreate (
 {
   XML_NODE  *Node;
 
-  Node = AllocatePool (sizeof (XML_NODE));
+  Node = XmlArenaAllocate (Arena, sizeof (XML_NODE));
 
   if (Node != NULL) {
     Node->Name       = Name;
@@ -205,6 +359,7 @@ XmlNodeCreate (
 STATIC
 BOOLEAN
 XmlNodeChildPush (
+  XML_ARENA *Arena,
   XML_NODE  *Node,
   XML_NODE  *Child
   )
@@ -226,6 +381,7 @@ XmlNodeChildPush (
     if (NodeCount < XML_PARSER_NODE_COUNT && AllocCount > NodeCount) {
       Node->Children->NodeList[NodeCount] = Child;
       Node->Children->NodeCount++;
+      Node->Children->Index = NULL;
       return TRUE;
     }
   }
@@ -240,10 +396,15 @@ XmlNodeChildPush (
   //
   // Allocate three times more room.
   // This balances performance and memory usage on large files like prelinked plist.
+  // Previous list memory stays in the arena till the document is freed.
   //
   AllocCount *= 3;
 
-  NewList = (XML_NODE_LIST *) AllocatePool (
+  NewList = (XML_NODE_LIST *) XmlArenaReallocate (
+    Arena,
+    Node->Children,
+    Node->Children != NULL
+      ? sizeof (XML_NODE_LIST) + sizeof (NewList->NodeList[0]) * Node->Children->AllocCount : 0,
     sizeof (XML_NODE_LIST) + sizeof (NewList->NodeList[0]) * AllocCount
     );
 
@@ -253,17 +414,8 @@ XmlNodeChildPush (
 
   NewList->NodeCount  = NodeCount + 1;
   NewList->AllocCount = AllocCount;
-
-  if (Node->Children != NULL) {
-    CopyMem (
-      &NewList->NodeList[0],
-      &Node->Children->NodeList[0],
-      sizeof (NewList->NodeList[0]) * NodeCount
-      );
-
-    FreePool (Node->Children);
-  }
-
+  NewList->Arena      = Arena;
+  NewList->Index      = NULL;
   NewList->NodeList[NodeCount] = Child;
   Node->Children = NewList;
 
@@ -344,27 +496,6 @@ XmlNodeReal (
   return References->RefList[Number];
 }
 
-//
-// Frees the resources allocated by the node.
-//
-STATIC
-VOID
-XmlNodeFree (
-  XML_NODE  *Node
-  )
-{
-  UINT32  Index;
-
-  if (Node->Children != NULL) {
-    for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
-      XmlNodeFree (Node->Children->NodeList[Index]);
-    }
-    FreePool (Node->Children);
-  }
-
-  FreePool (Node);
-}
-
 STATIC
 VOID
 XmlFreeRefs (
@@ -816,57 +947,54 @@ XmlParseContent (
 }
 
 //
-// Prints to growing buffer always preserving one byte extra.
+// Export state. Buffer is NULL when only measuring the output.
+//
+typedef struct {
+  CHAR8    *Buffer;
+  UINT32   BufferSize;
+  UINT32   CurrentSize;
+  BOOLEAN  Overflow;
+} XML_EXPORT_CONTEXT;
+
+//
+// Prints to fixed buffer or just accounts the size when there is none.
 //
 STATIC
 VOID
-XmlBufferAppend (
-  CHAR8        **Buffer,
-  UINT32       *AllocSize,
-  UINT32       *CurrentSize,
-  CONST CHAR8  *Data,
-  UINT32       DataLength
+XmlExportAppend (
+  XML_EXPORT_CONTEXT  *Export,
+  CONST CHAR8         *Data,
+  UINT32              DataLength
   )
 {
-  CHAR8   *NewBuffer;
   UINT32  NewSize;
 
-  NewSize = *AllocSize;
-
-  if (NewSize - *CurrentSize <= DataLength) {
-    if (DataLength + 1 <= XML_EXPORT_MIN_ALLOCATION_SIZE) {
-      NewSize += XML_EXPORT_MIN_ALLOCATION_SIZE;
-    } else {
-      NewSize += DataLength + 1;
-    }
+  if (Export->Overflow) {
+    return;
+  }
 
-    NewBuffer = AllocatePool (NewSize);
-    if (NewBuffer == NULL) {
-      XML_USAGE_ERROR("XmlBufferAppend::failed to allocate");
-      return;
-    }
+  if (OcOverflowAddU32 (Export->CurrentSize, DataLength, &NewSize)
+    || (Export->Buffer != NULL && NewSize > Export->BufferSize)) {
+    Export->Overflow = TRUE;
+    return;
+  }
 
-    CopyMem (NewBuffer, *Buffer, *CurrentSize);
-    FreePool (*Buffer);
-    *Buffer    = NewBuffer;
-    *AllocSize = NewSize;
+  if (Export->Buffer != NULL) {
+    CopyMem (&Export->Buffer[Export->CurrentSize], Data, DataLength);
   }
 
-  CopyMem (&(*Buffer)[*CurrentSize], Data, DataLength);
-  *CurrentSize += DataLength;
+  Export->CurrentSize = NewSize;
 }
 
 //
-// Prints node to growing buffer always preserving one byte extra.
+// Prints node to export buffer.
 //
 STATIC
 VOID
 XmlNodeExportRecursive (
-  XML_NODE  *Node,
-  CHAR8     **Buffer,
-  UINT32    *AllocSize,
-  UINT32    *CurrentSize,
-  UINT32    Skip
+  XML_NODE            *Node,
+  XML_EXPORT_CONTEXT  *Export,
+  UINT32              Skip
   )
 {
   UINT32  Index;
@@ -875,7 +1003,7 @@ XmlNodeExportRecursive (
   if (Skip != 0) {
     if (Node->Children != NULL) {
       for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
-        XmlNodeExportRecursive (Node->Children->NodeList[Index], Buffer, AllocSize, CurrentSize, Skip - 1);
+        XmlNodeExportRecursive (Node->Children->NodeList[Index], Export, Skip - 1);
       }
     }
 
@@ -884,30 +1012,30 @@ XmlNodeExportRecursive (
 
   NameLength = (UINT32)AsciiStrLen (Node->Name);
 
-  XmlBufferAppend (Buffer, AllocSize, CurrentSize, "<", L_STR_LEN ("<"));
-  XmlBufferAppend (Buffer, AllocSize, CurrentSize, Node->Name, NameLength);
+  XmlExportAppend (Export, "<", L_STR_LEN ("<"));
+  XmlExportAppend (Export, Node->Name, NameLength);
 
   if (Node->Attributes != NULL) {
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, " ", L_STR_LEN (" "));
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, Node->Attributes, (UINT32)AsciiStrLen (Node->Attributes));
+    XmlExportAppend (Export, " ", L_STR_LEN (" "));
+    XmlExportAppend (Export, Node->Attributes, (UINT32)AsciiStrLen (Node->Attributes));
   }
 
   if (Node->Children != NULL || Node->Content != NULL) {
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, ">", L_STR_LEN (">"));
+    XmlExportAppend (Export, ">", L_STR_LEN (">"));
 
     if (Node->Children != NULL) {
       for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
-        XmlNodeExportRecursive (Node->Children->NodeList[Index], Buffer, AllocSize, CurrentSize, 0);
+        XmlNodeExportRecursive (Node->Children->NodeList[Index], Export, 0);
       }
     } else {
-      XmlBufferAppend (Buffer, AllocSize, CurrentSize, Node->Content, (UINT32)AsciiStrLen (Node->Content));
+      XmlExportAppend (Export, Node->Content, (UINT32)AsciiStrLen (Node->Content));
     }
 
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, "</", L_STR_LEN ("</"));
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, Node->Name, NameLength);
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, ">", L_STR_LEN (">"));
+    XmlExportAppend (Export, "</", L_STR_LEN ("</"));
+    XmlExportAppend (Export, Node->Name, NameLength);
+    XmlExportAppend (Export, ">", L_STR_LEN (">"));
   } else {
-    XmlBufferAppend (Buffer, AllocSize, CurrentSize, "/>", L_STR_LEN ("/>"));
+    XmlExportAppend (Export, "/>", L_STR_LEN ("/>"));
   }
 }
 
@@ -930,6 +1058,7 @@ STATIC
 XML_NODE *
 XmlParseNode (
   XML_PARSER  *Parser,
+  XML_ARENA   *Arena,
   XML_REFLIST *References
   )
 {
@@ -964,7 +1093,7 @@ XmlParseNode (
 
   XmlSkipWhitespace (Parser);
 
-  Node = XmlNodeCreate (TagOpen, Attributes, NULL, XmlNodeReal (References, Attributes), NULL);
+  Node = XmlNodeCreate (Arena, TagOpen, Attributes, NULL, XmlNodeReal (References, Attributes), NULL);
   if (Node == NULL) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node alloc fail");
     return NULL;
@@ -985,7 +1114,6 @@ XmlParseNode (
 
     if (Node->Content == NULL) {
       XML_PARSER_ERROR (Parser, 0, "XmlParseNode::content");
-      XmlNodeFree (Node);
       return NULL;
     }
 
@@ -1011,7 +1139,6 @@ XmlParseNode (
 
     if (Parser->Level > XML_PARSER_NEST_LEVEL) {
       XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::level overflow");
-      XmlNodeFree (Node);
       return NULL;
     }
 
@@ -1022,7 +1149,7 @@ XmlParseNode (
       //
       // Parse child node.
       //
-      Child = XmlParseNode (Parser, References);
+      Child = XmlParseNode (Parser, Arena, References);
       if (Child == NULL) {
         if ('/' == XmlParserPeek (Parser, CURRENT_CHARACTER)) {
           XML_PARSER_INFO (Parser, "child_end");
@@ -1031,14 +1158,11 @@ XmlParseNode (
         }
 
         XML_PARSER_ERROR (Parser, NEXT_CHARACTER, "XmlParseNode::child");
-        XmlNodeFree (Node);
         return NULL;
       }
 
-      if (!XmlNodeChildPush (Node, Child)) {
+      if (!XmlNodeChildPush (Arena, Node, Child)) {
         XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node push fail");
-        XmlNodeFree (Node);
-        XmlNodeFree (Child);
         return NULL;
       }
 
@@ -1063,7 +1187,6 @@ XmlParseNode (
   TagClose = XmlParseTagClose (Parser, Unprefixed);
   if (TagClose == NULL) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::tag close");
-    XmlNodeFree (Node);
     return NULL;
   }
 
@@ -1072,13 +1195,11 @@ XmlParseNode (
   //
   if (AsciiStrCmp (TagOpen, TagClose) != 0) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::tag missmatch");
-    XmlNodeFree (Node);
     return NULL;
   }
 
   if (IsReference && !XmlPushReference (References, Node, ReferenceNumber)) {
     XML_PARSER_ERROR (Parser, 0, "XmlParseNode::reference");
-    XmlNodeFree (Node);
     return NULL;
   }
 
@@ -1113,27 +1234,33 @@ XmlDocumentParse (
     return NULL;
   }
 
+  Document = AllocateZeroPool (sizeof (XML_DOCUMENT));
+
+  if (Document == NULL) {
+    XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::document allocation failed");
+    return NULL;
+  }
+
+  //
+  // Nodes take roughly as much memory as their source.
+  //
+  Document->Arena.NextSlabSize = MIN (Length, XML_ARENA_MAX_SLAB_SIZE);
+
   //
   // Parse the root node.
   //
-  Root = XmlParseNode (&Parser, WithRefs ? &References : NULL);
+  Root = XmlParseNode (&Parser, &Document->Arena, WithRefs ? &References : NULL);
   if (Root == NULL) {
     XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::parsing document failed");
+    XmlArenaFree (&Document->Arena);
+    XmlFreeRefs (&References);
+    FreePool (Document);
     return NULL;
   }
 
   //
   // Return parsed document.
   //
-  Document = AllocatePool (sizeof(XML_DOCUMENT));
-
-  if (Document == NULL) {
-    XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::document allocation failed");
-    XmlNodeFree (Root);
-    XmlFreeRefs (&References);
-    return NULL;
-  }
-
   Document->Buffer.Buffer = Buffer;
   Document->Buffer.Length = Length;
   Document->Root = Root;
@@ -1142,6 +1269,70 @@ XmlDocumentParse (
   return Document;
 }
 
+BOOLEAN
+XmlDocumentExportSize (
+  XML_DOCUMENT  *Document,
+  UINT32        *Length,
+  UINT32        Skip
+  )
+{
+  XML_EXPORT_CONTEXT  Export;
+
+  ZeroMem (&Export, sizeof (Export));
+  XmlNodeExportRecursive (Document->Root, &Export, Skip);
+
+  //
+  // Reserve space for the trailing \0.
+  //
+  if (Export.Overflow || Export.CurrentSize == MAX_UINT32) {
+    XML_USAGE_ERROR ("XmlDocumentExportSize::document is too large");
+    return FALSE;
+  }
+
+  *Length = Export.CurrentSize;
+  return TRUE;
+}
+
+BOOLEAN
+XmlDocumentExportToBuffer (
+  XML_DOCUMENT  *Document,
+  CHAR8         *Buffer,
+  UINT32        BufferSize,
+  UINT32        *Length,
+  UINT32        Skip
+  )
+{
+  XML_EXPORT_CONTEXT  Export;
+
+  if (BufferSize == 0) {
+    XML_USAGE_ERROR ("XmlDocumentExportToBuffer::buffer is too small");
+    return FALSE;
+  }
+
+  //
+  // Always preserve one byte for the trailing \0.
+  //
+  Export.Buffer      = Buffer;
+  Export.BufferSize  = BufferSize - 1;
+  Export.CurrentSize = 0;
+  Export.Overflow    = FALSE;
+
+  XmlNodeExportRecursive (Document->Root, &Export, Skip);
+
+  if (Export.Overflow) {
+    XML_USAGE_ERROR ("XmlDocumentExportToBuffer::buffer is too small");
+    return FALSE;
+  }
+
+  Buffer[Export.CurrentSize] = '\0';
+
+  if (Length != NULL) {
+    *Length = Export.CurrentSize;
+  }
+
+  return TRUE;
+}
+
 CHAR8 *
 XmlDocumentExport (
   XML_DOCUMENT  *Document,
@@ -1150,28 +1341,24 @@ XmlDocumentExport (
   )
 {
   CHAR8   *Buffer;
-  UINT32  AllocSize;
-  UINT32  CurrentSize;
+  UINT32  BufferSize;
 
-  AllocSize = Document->Buffer.Length + 1;
-  Buffer    = AllocatePool (AllocSize);
+  if (!XmlDocumentExportSize (Document, &BufferSize, Skip)) {
+    return NULL;
+  }
+
+  ++BufferSize;
+  Buffer = AllocatePool (BufferSize);
   if (Buffer == NULL) {
     XML_USAGE_ERROR ("XmlDocumentExport::failed to allocate");
     return NULL;
   }
 
-  CurrentSize = 0;
-  XmlNodeExportRecursive (Document->Root, &Buffer, &AllocSize, &CurrentSize, Skip);
-
-  if (Length != NULL) {
-    *Length = CurrentSize;
+  if (!XmlDocumentExportToBuffer (Document, Buffer, BufferSize, Length, Skip)) {
+    FreePool (Buffer);
+    return NULL;
   }
 
-  //
-  // XmlBufferAppend guarantees one more byte.
-  //
-  Buffer[CurrentSize] = '\0';
-
   return Buffer;
 }
 
@@ -1180,7 +1367,7 @@ XmlDocumentFree (
   XML_DOCUMENT  *Document
   )
 {
-  XmlNodeFree (Document->Root);
+  XmlArenaFree (&Document->Arena);
   XmlFreeRefs (&Document->References);
   FreePool (Document);
 }
@@ -1290,6 +1477,7 @@ XmlEasyChild (
 
 XML_NODE *
 XmlNodeAppend (
+  XML_DOCUMENT *Document,
   XML_NODE     *Node,
   CONST CHAR8  *Name,
   CONST CHAR8  *Attributes,
@@ -1298,13 +1486,12 @@ XmlNodeAppend (
 {
   XML_NODE  *NewNode;
 
-  NewNode = XmlNodeCreate (Name, Attributes, Content, NULL, NULL);
+  NewNode = XmlNodeCreate (&Document->Arena, Name, Attributes, Content, NULL, NULL);
   if (NewNode == NULL) {
     return NULL;
   }
 
-  if (!XmlNodeChildPush (Node, NewNode)) {
-    XmlNodeFree (NewNode);
+  if (!XmlNodeChildPush (&Document->Arena, Node, NewNode)) {
     return NULL;
   }
 
@@ -1313,6 +1500,7 @@ XmlNodeAppend (
 
 XML_NODE *
 XmlNodePrepend (
+  XML_DOCUMENT *Document,
   XML_NODE     *Node,
   CONST CHAR8  *Name,
   CONST CHAR8  *Attributes,
@@ -1321,7 +1509,7 @@ XmlNodePrepend (
 {
   XML_NODE  *NewNode;
 
-  NewNode = XmlNodeAppend (Node, Name, Attributes, Content);
+  NewNode = XmlNodeAppend (Document, Node, Name, Attributes, Content);
   if (NewNode == NULL) {
     return NULL;
   }
@@ -1428,6 +1616,126 @@ PlistDictChild (
   return XmlNodeChild (Node, Child);
 }
 
+//
+// Calculates FNV-1a hash of dictionary key.
+//
+STATIC
+UINT32
+PlistKeyHash (
+  CONST CHAR8  *Key
+  )
+{
+  return Fnv1aUpdate (OC_FNV1A_INIT, Key, AsciiStrLen (Key));
+}
+
+//
+// Builds key index for dictionary node, keeping the first of duplicate keys.
+//
+STATIC
+XML_NODE_INDEX *
+PlistDictBuildIndex (
+  XML_NODE  *Node
+  )
+{
+  XML_NODE_INDEX  *Index;
+  CONST CHAR8     *Key;
+  CONST CHAR8     *SlotKey;
+  UINT32          PairCount;
+  UINT32          SlotCount;
+  UINT32          Pair;
+  UINT32          Slot;
+
+  PairCount = PlistDictChildren (Node);
+  SlotCount = PLIST_DICT_INDEX_MIN_KEYS;
+  while (SlotCount < PairCount * 2) {
+    SlotCount <<= 1U;
+  }
+
+  Index = XmlArenaAllocate (
+    Node->Children->Arena,
+    sizeof (XML_NODE_INDEX) + SlotCount * sizeof (Index->Slots[0])
+    );
+  if (Index == NULL) {
+    return NULL;
+  }
+
+  Index->Mask = SlotCount - 1;
+  ZeroMem (Index->Slots, SlotCount * sizeof (Index->Slots[0]));
+
+  for (Pair = 0; Pair < PairCount; ++Pair) {
+    Key = PlistKeyValue (PlistDictChild (Node, Pair, NULL));
+    if (Key == NULL) {
+      continue;
+    }
+
+    Slot = PlistKeyHash (Key) & Index->Mask;
+    while (Index->Slots[Slot] != 0) {
+      SlotKey = PlistKeyValue (PlistDictChild (Node, Index->Slots[Slot] - 1, NULL));
+      if (AsciiStrCmp (SlotKey, Key) == 0) {
+        break;
+      }
+
+      Slot = (Slot + 1) & Index->Mask;
+    }
+
+    if (Index->Slots[Slot] == 0) {
+      Index->Slots[Slot] = Pair + 1;
+    }
+  }
+
+  Node->Children->Index = Index;
+  return Index;
+}
+
+XML_NODE *
+PlistDictLookup (
+  XML_NODE     *Node,
+  CONST CHAR8  *Key
+  )
+{
+  XML_NODE_INDEX  *Index;
+  XML_NODE        *Value;
+  CONST CHAR8     *CurrentKey;
+  UINT32          PairCount;
+  UINT32          Pair;
+  UINT32          Slot;
+
+  PairCount = PlistDictChildren (Node);
+
+  if (PairCount >= PLIST_DICT_INDEX_MIN_KEYS) {
+    Index = Node->Children->Index;
+    if (Index == NULL) {
+      Index = PlistDictBuildIndex (Node);
+    }
+
+    if (Index != NULL) {
+      Slot = PlistKeyHash (Key) & Index->Mask;
+      while (Index->Slots[Slot] != 0) {
+        CurrentKey = PlistKeyValue (PlistDictChild (Node, Index->Slots[Slot] - 1, &Value));
+        if (AsciiStrCmp (CurrentKey, Key) == 0) {
+          return Value;
+        }
+
+        Slot = (Slot + 1) & Index->Mask;
+      }
+
+      return NULL;
+    }
+  }
+
+  //
+  // Small dictionary or out of memory.
+  //
+  for (Pair = 0; Pair < PairCount; ++Pair) {
+    CurrentKey = PlistKeyValue (PlistDictChild (Node, Pair, &Value));
+    if (CurrentKey != NULL && AsciiStrCmp (CurrentKey, Key) == 0) {
+      return Value;
+    }
+  }
+
+  return NULL;
+}
+
 CONST CHAR8 *
 PlistKeyValue (
   XML_NODE  *Node
@@ -74,6 +74,11 @@ OcStartImage (
 
   OldMode = OcConsoleControlSetMode (EfiConsoleControlScreenGraphics);
 
+  //
+  // The started image may exit boot services, write the log file before that.
+  //
+  OcLogFlush ();
+
   Status = gBS->StartImage (
     ImageHandle,
     ExitDataSize,
@@ -161,6 +166,7 @@ OcBootstrapRerun (
   )
 {
   EFI_STATUS          Status;
+  OC_LOG_SPAN         Span;
 
   DEBUG ((DEBUG_INFO, "OC: ReRun executed!\n"));
 
@@ -169,12 +175,14 @@ OcBootstrapRerun (
   if (This->NestedCount == 1) {
     mOpenCoreVaultKey = OcGetVaultKey (This);
 
+    OcLogSpanBegin (&Span, "Storage init");
     Status = OcStorageInitFromFs (
       &mOpenCoreStorage,
       FileSystem,
       OPEN_CORE_ROOT_PATH,
       mOpenCoreVaultKey
       );
+    OcLogSpanEnd (&Span);
 
     if (!EFI_ERROR (Status)) {
       OcMain (&mOpenCoreStorage, LoadPath);
@@ -18,6 +18,10 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleKernelLib.h>
+#include <Library/OcCompressionLib.h>
+#include <Library/OcCryptoLib.h>
+#include <Library/OcDebugLogLib.h>
+#include <Library/OcFileLib.h>
 #include <Library/OcMiscLib.h>
 #include <Library/OcStringLib.h>
 #include <Library/OcVirtualFsLib.h>
@@ -28,6 +32,43 @@ STATIC OC_STORAGE_CONTEXT  *mOcStorage;
 STATIC OC_GLOBAL_CONFIG    *mOcConfiguration;
 STATIC OC_CPU_INFO         *mOcCpuInfo;
 
+#define OC_KERNEL_CACHE_SIGNATURE  SIGNATURE_32 ('O', 'C', 'K', 'C')
+#define OC_KERNEL_CACHE_VERSION    1
+
+#pragma pack(push, 1)
+
+///
+/// Prelinked kernel cache file header followed by LZSS compressed kernel.
+///
+typedef struct {
+  ///
+  /// OC_KERNEL_CACHE_SIGNATURE.
+  ///
+  UINT32  Signature;
+  ///
+  /// OC_KERNEL_CACHE_VERSION.
+  ///
+  UINT32  Version;
+  ///
+  /// Digest of the source kernel, kexts, and kernel configuration.
+  ///
+  UINT8   SourceDigest[SHA256_DIGEST_SIZE];
+  ///
+  /// Digest of compressed kernel data.
+  ///
+  UINT8   DataDigest[SHA256_DIGEST_SIZE];
+  ///
+  /// Decompressed kernel size.
+  ///
+  UINT32  KernelSize;
+  ///
+  /// Compressed kernel size.
+  ///
+  UINT32  CompressedSize;
+} OC_KERNEL_CACHE_HEADER;
+
+#pragma pack(pop)
+
 STATIC
 UINT32
 OcParseDarwinVersion (
@@ -322,8 +363,16 @@ OcKernelApplyPatches (
   UINT32                 MaxKernel;
   UINT32                 MinKernel;
   BOOLEAN                IsKernelPatch;
+  PATCHER_GENERIC_PATCH  *BatchPatches;
+  UINT32                 *BatchIndices;
+  EFI_STATUS             *BatchResults;
+  UINT32                 BatchCount;
 
   IsKernelPatch = Context == NULL;
+  BatchPatches  = NULL;
+  BatchIndices  = NULL;
+  BatchResults  = NULL;
+  BatchCount    = 0;
 
   if (IsKernelPatch) {
     ASSERT (Kernel != NULL);
@@ -338,6 +387,30 @@ OcKernelApplyPatches (
       DEBUG ((DEBUG_ERROR, "OC: Kernel patcher kernel init failure - %r\n", Status));
       return;
     }
+
+    //
+    // Kernel patches are applied in a single pass over the kernel,
+    // fall back to applying them one by one on allocation failure.
+    //
+    if (Config->Kernel.Patch.Count > 0) {
+      BatchPatches = AllocatePool (Config->Kernel.Patch.Count * sizeof (*BatchPatches));
+      BatchIndices = AllocatePool (Config->Kernel.Patch.Count * sizeof (*BatchIndices));
+      BatchResults = AllocatePool (Config->Kernel.Patch.Count * sizeof (*BatchResults));
+      if (BatchPatches == NULL || BatchIndices == NULL || BatchResults == NULL) {
+        if (BatchPatches != NULL) {
+          FreePool (BatchPatches);
+          BatchPatches = NULL;
+        }
+        if (BatchIndices != NULL) {
+          FreePool (BatchIndices);
+          BatchIndices = NULL;
+        }
+        if (BatchResults != NULL) {
+          FreePool (BatchResults);
+          BatchResults = NULL;
+        }
+      }
+    }
   }
 
   for (Index = 0; Index < Config->Kernel.Patch.Count; ++Index) {
@@ -425,6 +498,13 @@ OcKernelApplyPatches (
     Patch.Skip    = UserPatch->Skip;
     Patch.Limit   = UserPatch->Limit;
 
+    if (BatchPatches != NULL) {
+      CopyMem (&BatchPatches[BatchCount], &Patch, sizeof (Patch));
+      BatchIndices[BatchCount] = Index;
+      ++BatchCount;
+      continue;
+    }
+
     Status = PatcherApplyGenericPatch (&Patcher, &Patch);
     DEBUG ((
       EFI_ERROR (Status) ? DEBUG_WARN : DEBUG_INFO,
@@ -436,6 +516,26 @@ OcKernelApplyPatches (
       ));
   }
 
+  if (BatchPatches != NULL) {
+    PatcherApplyGenericPatches (&Patcher, BatchPatches, BatchCount, BatchResults);
+
+    for (Index = 0; Index < BatchCount; ++Index) {
+      UserPatch = Config->Kernel.Patch.Values[BatchIndices[Index]];
+      DEBUG ((
+        EFI_ERROR (BatchResults[Index]) ? DEBUG_WARN : DEBUG_INFO,
+        "OC: Kernel patcher result %u for %a (%a) - %r\n",
+        BatchIndices[Index],
+        OC_BLOB_GET (&UserPatch->Identifier),
+        OC_BLOB_GET (&UserPatch->Comment),
+        BatchResults[Index]
+        ));
+    }
+
+    FreePool (BatchPatches);
+    FreePool (BatchIndices);
+    FreePool (BatchResults);
+  }
+
   if (!IsKernelPatch) {
     if (Config->Kernel.Quirks.AppleCpuPmCfgLock) {
       PatchAppleCpuPmCfgLock (Context);
@@ -597,14 +697,18 @@ OcKernelProcessPrelinked (
   OC_KERNEL_ADD_ENTRY  *Kext;
   UINT32               MaxKernel;
   UINT32               MinKernel;
+  OC_LOG_SPAN          Span;
 
   Status = PrelinkedContextInit (&Context, Kernel, *KernelSize, AllocatedSize);
 
   if (!EFI_ERROR (Status)) {
+    OcLogSpanBegin (&Span, "Prelinked patch");
     OcKernelApplyPatches (Config, DarwinVersion, &Context, NULL, 0);
 
     OcKernelBlockKexts (Config, DarwinVersion, &Context);
+    OcLogSpanEnd (&Span);
 
+    OcLogSpanBegin (&Span, "Kext injection");
     Status = PrelinkedInjectPrepare (&Context);
     if (!EFI_ERROR (Status)) {
 
@@ -672,6 +776,7 @@ OcKernelProcessPrelinked (
     } else {
       DEBUG ((DEBUG_WARN, "OC: Prelink inject prepare error - %r\n", Status));
     }
+    OcLogSpanEnd (&Span);
 
     *KernelSize = Context.PrelinkedSize;
 
@@ -681,6 +786,298 @@ OcKernelProcessPrelinked (
   return Status;
 }
 
+STATIC
+VOID
+OcKernelCacheHashBlob (
+  IN OUT SHA256_CONTEXT  *Context,
+  IN     CONST VOID      *Data,
+  IN     UINT32          DataSize
+  )
+{
+  Sha256Update (Context, (CONST UINT8 *) &DataSize, sizeof (DataSize));
+  if (DataSize > 0) {
+    Sha256Update (Context, Data, DataSize);
+  }
+}
+
+STATIC
+VOID
+OcKernelCacheHashBoolean (
+  IN OUT SHA256_CONTEXT  *Context,
+  IN     BOOLEAN         Value
+  )
+{
+  Sha256Update (Context, (CONST UINT8 *) &Value, sizeof (Value));
+}
+
+STATIC
+VOID
+OcKernelCacheHashString (
+  IN OUT SHA256_CONTEXT  *Context,
+  IN     CONST CHAR8     *String
+  )
+{
+  OcKernelCacheHashBlob (Context, String, (UINT32) AsciiStrSize (String));
+}
+
+/**
+  Calculate prelinked kernel cache digest. It covers the source kernel,
+  injected kexts, and all configuration affecting kernel patching.
+
+  @param[in]  Config      OpenCore configuration.
+  @param[in]  Kernel      Source kernel.
+  @param[in]  KernelSize  Source kernel size.
+  @param[out] Digest      Resulting digest.
+**/
+STATIC
+VOID
+OcKernelCacheGetDigest (
+  IN  OC_GLOBAL_CONFIG  *Config,
+  IN  CONST UINT8       *Kernel,
+  IN  UINT32            KernelSize,
+  OUT UINT8             *Digest
+  )
+{
+  SHA256_CONTEXT         Context;
+  UINT32                 Index;
+  OC_KERNEL_ADD_ENTRY    *Kext;
+  OC_KERNEL_BLOCK_ENTRY  *Block;
+  OC_KERNEL_PATCH_ENTRY  *Patch;
+  OC_KERNEL_QUIRKS       *Quirks;
+  UINT32                 Cpuid[4];
+
+  Sha256Init (&Context);
+
+  OcKernelCacheHashString (&Context, OcMiscGetVersionString ());
+  OcKernelCacheHashBlob (&Context, Kernel, KernelSize);
+
+  for (Index = 0; Index < Config->Kernel.Add.Count; ++Index) {
+    Kext = Config->Kernel.Add.Values[Index];
+    if (!Kext->Enabled) {
+      continue;
+    }
+
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Kext->BundlePath));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Kext->ExecutablePath));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Kext->MinKernel));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Kext->MaxKernel));
+    OcKernelCacheHashBlob (&Context, Kext->PlistData, Kext->PlistDataSize);
+    OcKernelCacheHashBlob (&Context, Kext->ImageData, Kext->ImageDataSize);
+  }
+
+  for (Index = 0; Index < Config->Kernel.Block.Count; ++Index) {
+    Block = Config->Kernel.Block.Values[Index];
+    if (!Block->Enabled) {
+      continue;
+    }
+
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Block->Identifier));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Block->MinKernel));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Block->MaxKernel));
+  }
+
+  for (Index = 0; Index < Config->Kernel.Patch.Count; ++Index) {
+    Patch = Config->Kernel.Patch.Values[Index];
+    if (!Patch->Enabled) {
+      continue;
+    }
+
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Patch->Identifier));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Patch->Base));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Patch->MinKernel));
+    OcKernelCacheHashString (&Context, OC_BLOB_GET (&Patch->MaxKernel));
+    OcKernelCacheHashBlob (&Context, OC_BLOB_GET (&Patch->Find), Patch->Find.Size);
+    OcKernelCacheHashBlob (&Context, OC_BLOB_GET (&Patch->Mask), Patch->Mask.Size);
+    OcKernelCacheHashBlob (&Context, OC_BLOB_GET (&Patch->Replace), Patch->Replace.Size);
+    OcKernelCacheHashBlob (&Context, OC_BLOB_GET (&Patch->ReplaceMask), Patch->ReplaceMask.Size);
+    OcKernelCacheHashBlob (&Context, &Patch->Count, sizeof (Patch->Count));
+    OcKernelCacheHashBlob (&Context, &Patch->Limit, sizeof (Patch->Limit));
+    OcKernelCacheHashBlob (&Context, &Patch->Skip, sizeof (Patch->Skip));
+  }
+
+  //
+  // Fields are hashed one by one, structure padding is not initialised.
+  // Every kernel quirk must be listed here.
+  //
+  Quirks = &Config->Kernel.Quirks;
+  OcKernelCacheHashBoolean (&Context, Quirks->AppleCpuPmCfgLock);
+  OcKernelCacheHashBoolean (&Context, Quirks->AppleXcpmCfgLock);
+  OcKernelCacheHashBoolean (&Context, Quirks->AppleXcpmExtraMsrs);
+  OcKernelCacheHashBoolean (&Context, Quirks->AppleXcpmForceBoost);
+  OcKernelCacheHashBoolean (&Context, Quirks->CustomSmbiosGuid);
+  OcKernelCacheHashBoolean (&Context, Quirks->DisableIoMapper);
+  OcKernelCacheHashBoolean (&Context, Quirks->DisableRtcChecksum);
+  OcKernelCacheHashBoolean (&Context, Quirks->DummyPowerManagement);
+  OcKernelCacheHashBoolean (&Context, Quirks->ExternalDiskIcons);
+  OcKernelCacheHashBoolean (&Context, Quirks->IncreasePciBarSize);
+  OcKernelCacheHashBoolean (&Context, Quirks->LapicKernelPanic);
+  OcKernelCacheHashBoolean (&Context, Quirks->PanicNoKextDump);
+  OcKernelCacheHashBoolean (&Context, Quirks->PowerTimeoutKernelPanic);
+  OcKernelCacheHashBoolean (&Context, Quirks->ThirdPartyDrives);
+  OcKernelCacheHashBoolean (&Context, Quirks->XhciPortLimit);
+
+  OcKernelCacheHashBlob (&Context, Config->Kernel.Emulate.Cpuid1Data, sizeof (Config->Kernel.Emulate.Cpuid1Data));
+  OcKernelCacheHashBlob (&Context, Config->Kernel.Emulate.Cpuid1Mask, sizeof (Config->Kernel.Emulate.Cpuid1Mask));
+
+  //
+  // CPUID emulation merges configured values with the actual CPU.
+  //
+  Cpuid[0] = mOcCpuInfo->CpuidVerEax.Uint32;
+  Cpuid[1] = mOcCpuInfo->CpuidVerEbx.Uint32;
+  Cpuid[2] = mOcCpuInfo->CpuidVerEcx.Uint32;
+  Cpuid[3] = mOcCpuInfo->CpuidVerEdx.Uint32;
+  OcKernelCacheHashBlob (&Context, Cpuid, sizeof (Cpuid));
+
+  Sha256Final (&Context, Digest);
+}
+
+/**
+  Load prelinked kernel from cache.
+
+  @param[in]     Storage        OpenCore storage.
+  @param[in]     SourceDigest   Expected source digest.
+  @param[out]    Kernel         Kernel buffer to decompress to.
+  @param[in,out] KernelSize     Kernel size, updated on success.
+  @param[in]     AllocatedSize  Kernel buffer size.
+
+  @retval EFI_SUCCESS on success.
+**/
+STATIC
+EFI_STATUS
+OcKernelCacheLoad (
+  IN     OC_STORAGE_CONTEXT  *Storage,
+  IN     CONST UINT8         *SourceDigest,
+     OUT UINT8               *Kernel,
+  IN OUT UINT32              *KernelSize,
+  IN     UINT32              AllocatedSize
+  )
+{
+  UINT8                   *Cache;
+  UINT32                  CacheSize;
+  OC_KERNEL_CACHE_HEADER  *Header;
+  UINT8                   DataDigest[SHA256_DIGEST_SIZE];
+  UINT8                   *Buffer;
+  UINT32                  DecompressedSize;
+
+  if (!OcStorageExistsFileUnicode (Storage, OPEN_CORE_KERNEL_CACHE_PATH)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Cache = OcStorageReadFileUnicode (Storage, OPEN_CORE_KERNEL_CACHE_PATH, &CacheSize);
+  if (Cache == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  Header = (OC_KERNEL_CACHE_HEADER *) Cache;
+
+  if (CacheSize < sizeof (*Header)
+    || Header->Signature != OC_KERNEL_CACHE_SIGNATURE
+    || Header->Version != OC_KERNEL_CACHE_VERSION
+    || Header->CompressedSize != CacheSize - sizeof (*Header)
+    || Header->KernelSize > AllocatedSize) {
+    FreePool (Cache);
+    return EFI_UNSUPPORTED;
+  }
+
+  if (CompareMem (Header->SourceDigest, SourceDigest, SHA256_DIGEST_SIZE) != 0) {
+    FreePool (Cache);
+    return EFI_NOT_FOUND;
+  }
+
+  Sha256 (DataDigest, Cache + sizeof (*Header), Header->CompressedSize);
+  if (CompareMem (Header->DataDigest, DataDigest, SHA256_DIGEST_SIZE) != 0) {
+    FreePool (Cache);
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  //
+  // Decompress to a separate buffer to keep the source kernel on failure.
+  //
+  Buffer = AllocatePool (Header->KernelSize);
+  if (Buffer == NULL) {
+    FreePool (Cache);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  DecompressedSize = DecompressLZSS (
+    Buffer,
+    Header->KernelSize,
+    Cache + sizeof (*Header),
+    Header->CompressedSize
+    );
+
+  FreePool (Cache);
+
+  if (DecompressedSize != Header->KernelSize) {
+    FreePool (Buffer);
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  CopyMem (Kernel, Buffer, DecompressedSize);
+  *KernelSize = DecompressedSize;
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  Save prelinked kernel to cache.
+
+  @param[in] Storage        OpenCore storage.
+  @param[in] SourceDigest   Source digest.
+  @param[in] Kernel         Processed kernel.
+  @param[in] KernelSize     Processed kernel size.
+
+  @retval EFI_SUCCESS on success.
+**/
+STATIC
+EFI_STATUS
+OcKernelCacheSave (
+  IN OC_STORAGE_CONTEXT  *Storage,
+  IN CONST UINT8         *SourceDigest,
+  IN UINT8               *Kernel,
+  IN UINT32              KernelSize
+  )
+{
+  EFI_STATUS              Status;
+  UINT8                   *Cache;
+  UINT32                  CacheSize;
+  UINT8                   *CacheEnd;
+  OC_KERNEL_CACHE_HEADER  *Header;
+
+  //
+  // LZSS may slightly expand incompressible data, just give up then.
+  //
+  CacheSize = sizeof (*Header) + KernelSize;
+  Cache     = AllocatePool (CacheSize);
+  if (Cache == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CacheEnd = CompressLZSS (Cache + sizeof (*Header), KernelSize, Kernel, KernelSize);
+  if (CacheEnd == NULL) {
+    FreePool (Cache);
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  Header                 = (OC_KERNEL_CACHE_HEADER *) Cache;
+  Header->Signature      = OC_KERNEL_CACHE_SIGNATURE;
+  Header->Version        = OC_KERNEL_CACHE_VERSION;
+  Header->KernelSize     = KernelSize;
+  Header->CompressedSize = (UINT32) (CacheEnd - (Cache + sizeof (*Header)));
+  CopyMem (Header->SourceDigest, SourceDigest, SHA256_DIGEST_SIZE);
+  Sha256 (Header->DataDigest, Cache + sizeof (*Header), Header->CompressedSize);
+
+  Status = SetFileData (
+    Storage->StorageRoot,
+    OPEN_CORE_KERNEL_CACHE_PATH,
+    Cache,
+    sizeof (*Header) + Header->CompressedSize
+    );
+
+  FreePool (Cache);
+  return Status;
+}
+
 STATIC
 EFI_STATUS
 EFIAPI
@@ -701,6 +1098,10 @@ OcKernelFileOpen (
   EFI_STATUS         PrelinkedStatus;
   EFI_TIME           ModificationTime;
   UINT32             DarwinVersion;
+  BOOLEAN            UseCache;
+  UINT8              CacheDigest[SHA256_DIGEST_SIZE];
+  OC_LOG_SPAN        Span;
+  OC_LOG_SPAN        PrelinkedSpan;
 
   Status = SafeFileOpen (This, NewHandle, FileName, OpenMode, Attributes);
 
@@ -726,6 +1127,7 @@ OcKernelFileOpen (
     && StrCmp (FileName, L"System\\Library\\Kernels\\kernel") != 0) {
 
     DEBUG ((DEBUG_INFO, "OC: Trying XNU hook on %s\n", FileName));
+    OcLogSpanBegin (&Span, "Kernel read");
     Status = ReadAppleKernel (
       *NewHandle,
       &Kernel,
@@ -733,24 +1135,68 @@ OcKernelFileOpen (
       &AllocatedSize,
       OcKernelLoadKextsAndReserve (mOcStorage, mOcConfiguration)
       );
+    OcLogSpanEnd (&Span);
     DEBUG ((DEBUG_INFO, "OC: Result of XNU hook on %s is %r\n", FileName, Status));
 
     //
     // This is not Apple kernel, just return the original file.
     //
     if (!EFI_ERROR (Status)) {
-      DarwinVersion = OcKernelReadDarwinVersion (Kernel, KernelSize);
-      OcKernelApplyPatches (mOcConfiguration, DarwinVersion, NULL, Kernel, KernelSize);
+      //
+      // Cache is not covered by the vault, so it cannot be trusted there.
+      //
+      UseCache = FALSE;
+      if (mOcConfiguration->Kernel.Cache.Enabled) {
+        if (mOcStorage->HasVault) {
+          DEBUG ((DEBUG_INFO, "OC: Prelinked cache is not available with vault\n"));
+        } else if (mOcStorage->StorageRoot == NULL) {
+          DEBUG ((DEBUG_INFO, "OC: Prelinked cache is not available without storage root\n"));
+        } else {
+          UseCache = TRUE;
+        }
+      }
 
-      PrelinkedStatus = OcKernelProcessPrelinked (
-        mOcConfiguration,
-        DarwinVersion,
-        Kernel,
-        &KernelSize,
-        AllocatedSize
-        );
+      PrelinkedStatus = EFI_NOT_FOUND;
+      if (UseCache) {
+        OcKernelCacheGetDigest (mOcConfiguration, Kernel, KernelSize, CacheDigest);
+        PrelinkedStatus = OcKernelCacheLoad (mOcStorage, CacheDigest, Kernel, &KernelSize, AllocatedSize);
+        DEBUG ((DEBUG_INFO, "OC: Prelinked cache load - %r\n", PrelinkedStatus));
+      }
+
+      if (EFI_ERROR (PrelinkedStatus)) {
+        OcLogSpanBegin (&PrelinkedSpan, "Kernel processing");
+        DarwinVersion = OcKernelReadDarwinVersion (Kernel, KernelSize);
 
-      DEBUG ((DEBUG_INFO, "OC: Prelinked status - %r\n", PrelinkedStatus));
+        OcLogSpanBegin (&Span, "Kernel patch");
+        OcKernelApplyPatches (mOcConfiguration, DarwinVersion, NULL, Kernel, KernelSize);
+        OcLogSpanEnd (&Span);
+
+        PrelinkedStatus = OcKernelProcessPrelinked (
+          mOcConfiguration,
+          DarwinVersion,
+          Kernel,
+          &KernelSize,
+          AllocatedSize
+          );
+        OcLogSpanEnd (&PrelinkedSpan);
+
+        DEBUG ((DEBUG_INFO, "OC: Prelinked status - %r\n", PrelinkedStatus));
+
+        //
+        // Writing files from the boot path is slow and not safe with every
+        // firmware driver, so the cache is only written on explicit request.
+        //
+        if (UseCache && mOcConfiguration->Kernel.Cache.Update && !EFI_ERROR (PrelinkedStatus)) {
+          Status = OcKernelCacheSave (mOcStorage, CacheDigest, Kernel, KernelSize);
+          DEBUG ((DEBUG_INFO, "OC: Prelinked cache save - %r\n", Status));
+        }
+      }
+
+      //
+      // Kernel processing is the last thing we log before boot.efi exits
+      // boot services, after which the log file can no longer be written.
+      //
+      OcLogFlush ();
 
       Status = GetFileModifcationTime (*NewHandle, &ModificationTime);
       if (EFI_ERROR (Status)) {
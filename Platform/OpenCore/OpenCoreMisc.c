@@ -387,6 +387,7 @@ OcMiscEarlyInit (
   EFI_TIME                  BootTime;
   CONST CHAR8               *AsciiVault;
   OCS_VAULT_MODE            Vault;
+  OC_LOG_SPAN               Span;
 
   ConfigData = OcStorageReadFileUnicode (
     Storage,
@@ -397,7 +398,9 @@ OcMiscEarlyInit (
   if (ConfigData != NULL) {
     DEBUG ((DEBUG_INFO, "OC: Loaded configuration of %u bytes\n", ConfigDataSize));
 
+    OcLogSpanBegin (&Span, "Config parse");
     Status = OcConfigurationInit (Config, ConfigData, ConfigDataSize);
+    OcLogSpanEnd (&Span);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "OC: Failed to parse configuration!\n"));
       CpuDeadLoop ();
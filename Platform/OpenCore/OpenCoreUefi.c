@@ -423,6 +423,7 @@ OcLoadUefiSupport (
   BOOLEAN               BootOrderChanged;
   EFI_EVENT             Event;
   EFI_PHYSICAL_ADDRESS  ReservedAddress;
+  OC_LOG_SPAN           Span;
 
   OcReinstallProtocols (Config);
 
@@ -514,7 +515,9 @@ OcLoadUefiSupport (
   }
 
   if (Config->Uefi.ConnectDrivers) {
+    OcLogSpanBegin (&Span, "Driver load");
     OcLoadDrivers (Storage, Config, &DriversToConnect);
+    OcLogSpanEnd (&Span);
     DEBUG ((DEBUG_INFO, "OC: Connecting drivers...\n"));
     if (DriversToConnect != NULL) {
       OcRegisterDriversToHighestPriority (DriversToConnect);
@@ -522,10 +525,14 @@ OcLoadUefiSupport (
       // DriversToConnect is not freed as it is owned by OcRegisterDriversToHighestPriority.
       //
     }
+    OcLogSpanBegin (&Span, "Driver connect");
     OcConnectDrivers ();
+    OcLogSpanEnd (&Span);
     DEBUG ((DEBUG_INFO, "OC: Connecting drivers done...\n"));
   } else {
+    OcLogSpanBegin (&Span, "Driver load");
     OcLoadDrivers (Storage, Config, NULL);
+    OcLogSpanEnd (&Span);
   }
 
   if (Config->Uefi.Apfs.EnableJumpstart) {
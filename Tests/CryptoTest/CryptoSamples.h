@@ -628,4 +628,29 @@ STATIC UINT8 CONST ChaChaCipherText[375] = {
   0xC4, 0xFD, 0x80, 0x6C, 0x22, 0xF2, 0x21 
 };
 
+//
+// SHA-2 samples of one million repetitions of 'a' from FIPS 180-2,
+// long enough to exercise multiblock SHA-2 implementations.
+//
+#define SHA2_LONG_SAMPLE_CHAR 'a'
+#define SHA2_LONG_SAMPLE_LEN  1000000
+
+STATIC UINT8 CONST Sha256LongSampleHash[SHA256_DIGEST_SIZE] = {
+  0xCD, 0xC7, 0x6E, 0x5C, 0x99, 0x14, 0xFB, 0x92, 0x81, 0xA1, 0xC7, 0xE2, 0x84, 0xD7, 0x3E, 0x67,
+  0xF1, 0x80, 0x9A, 0x48, 0xA4, 0x97, 0x20, 0x0E, 0x04, 0x6D, 0x39, 0xCC, 0xC7, 0x11, 0x2C, 0xD0
+};
+
+STATIC UINT8 CONST Sha384LongSampleHash[SHA384_DIGEST_SIZE] = {
+  0x9D, 0x0E, 0x18, 0x09, 0x71, 0x64, 0x74, 0xCB, 0x08, 0x6E, 0x83, 0x4E, 0x31, 0x0A, 0x4A, 0x1C,
+  0xED, 0x14, 0x9E, 0x9C, 0x00, 0xF2, 0x48, 0x52, 0x79, 0x72, 0xCE, 0xC5, 0x70, 0x4C, 0x2A, 0x5B,
+  0x07, 0xB8, 0xB3, 0xDC, 0x38, 0xEC, 0xC4, 0xEB, 0xAE, 0x97, 0xDD, 0xD8, 0x7F, 0x3D, 0x89, 0x85
+};
+
+STATIC UINT8 CONST Sha512LongSampleHash[SHA512_DIGEST_SIZE] = {
+  0xE7, 0x18, 0x48, 0x3D, 0x0C, 0xE7, 0x69, 0x64, 0x4E, 0x2E, 0x42, 0xC7, 0xBC, 0x15, 0xB4, 0x63,
+  0x8E, 0x1F, 0x98, 0xB1, 0x3B, 0x20, 0x44, 0x28, 0x56, 0x32, 0xA8, 0x03, 0xAF, 0xA9, 0x73, 0xEB,
+  0xDE, 0x0F, 0xF2, 0x44, 0x87, 0x7E, 0xA6, 0x0A, 0x4C, 0xB0, 0x43, 0x2C, 0xE5, 0x77, 0xC3, 0x1B,
+  0xEB, 0x00, 0x9C, 0x5C, 0x2C, 0x49, 0xAA, 0x2E, 0x4E, 0xAD, 0xB2, 0x17, 0xAD, 0x8C, 0xC0, 0x9B
+};
+
 #endif // CRYPTO_SAMPLES_H
@@ -398,6 +398,81 @@ TestHash (
   return Status;
 }
 
+EFI_STATUS
+EFIAPI
+TestSha2Implementations (
+  VOID
+  )
+{
+  STATIC CONST CHAR16 *CONST  Names[] = {L"generic", L"AVX2", L"SHA-NI"};
+
+  BOOLEAN                 Sha2TestPassed;
+  OC_SHA2_IMPLEMENTATION  Implementation;
+  UINT8                   *LongSample;
+  UINTN                   Index;
+  UINT8                   Sha256Hash[SHA256_DIGEST_SIZE];
+  UINT8                   Sha512Hash[SHA512_DIGEST_SIZE];
+  UINT8                   Sha384Hash[SHA384_DIGEST_SIZE];
+
+  LongSample = AllocatePool (SHA2_LONG_SAMPLE_LEN);
+  if (LongSample == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  SetMem (LongSample, SHA2_LONG_SAMPLE_LEN, SHA2_LONG_SAMPLE_CHAR);
+
+  Sha2TestPassed = TRUE;
+
+  for (
+    Implementation = OcSha2ImplementationGeneric;
+    Implementation <= OcSha2ImplementationShaNi;
+    ++Implementation) {
+    if (OcSha2SetImplementation (Implementation) != Implementation) {
+      Print (L"Sha2 %s implementation is not supported\n", Names[Implementation]);
+      continue;
+    }
+
+    for (Index = 0; Index < HASH_SAMPLES_NUM; Index++) {
+      Sha256 (Sha256Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+      Sha512 (Sha512Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+      Sha384 (Sha384Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+
+      if (CompareMem (Sha256Hash, HashSamples[Index].Sha256Hash, SHA256_DIGEST_SIZE) != 0
+        || CompareMem (Sha512Hash, HashSamples[Index].Sha512Hash, SHA512_DIGEST_SIZE) != 0
+        || CompareMem (Sha384Hash, HashSamples[Index].Sha384Hash, SHA384_DIGEST_SIZE) != 0) {
+        Print (L"Sha2 %s hash test №%lu failed\n", Names[Implementation], Index);
+        Sha2TestPassed = FALSE;
+      }
+    }
+
+    Sha256 (Sha256Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+    Sha512 (Sha512Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+    Sha384 (Sha384Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+
+    if (CompareMem (Sha256Hash, Sha256LongSampleHash, SHA256_DIGEST_SIZE) != 0
+      || CompareMem (Sha512Hash, Sha512LongSampleHash, SHA512_DIGEST_SIZE) != 0
+      || CompareMem (Sha384Hash, Sha384LongSampleHash, SHA384_DIGEST_SIZE) != 0) {
+      Print (L"Sha2 %s long hash test failed\n", Names[Implementation]);
+      Sha2TestPassed = FALSE;
+    } else {
+      Print (L"Sha2 %s hash tests passed\n", Names[Implementation]);
+    }
+  }
+
+  //
+  // Restore the fastest implementation.
+  //
+  OcSha2SetImplementation (OcSha2ImplementationShaNi);
+
+  FreePool (LongSample);
+
+  if (!Sha2TestPassed) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 EFIAPI
 UefiDriverMain (
@@ -421,6 +496,17 @@ UefiDriverMain (
     Print (L"All hash tests passed!\n");
   }
 
+  //
+  // Test SHA-2 implementations
+  //
+  Status = TestSha2Implementations ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Sha2 implementation test failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Sha2 implementation tests passed!\n");
+  }
+
   //
   // Test AES-128-CBC
   //
@@ -498,6 +584,19 @@ UefiAppMain (
 
   WaitForKeyPress (L"Press any key...");
 
+  //
+  // Test SHA-2 implementations
+  //
+  Status = TestSha2Implementations ();
+  if (EFI_ERROR (Status)) {
+    Print (L"Sha2 implementation test failed!\n");
+    Failure = TRUE;
+  } else {
+    Print (L"Sha2 implementation tests passed!\n");
+  }
+
+  WaitForKeyPress (L"Press any key...");
+
   //
   // Test AES-128-CBC
   //
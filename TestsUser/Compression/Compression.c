@@ -0,0 +1,356 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/OcCompressionLib.h>
+
+/*
+ clang -g -fsanitize=undefined,address -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h Compression.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c -o Compression
+
+ ./Compression [seed]
+
+ Checks that DecompressLZSSWithChecksum and DecompressLZVNWithChecksum, used
+ for compressed kernels, restore the data and report the same checksum as
+ zlib adler32 (Adler32Update) over the whole data. LZSS data is produced with
+ CompressLZSS. LZVN data is produced by a simple encoder below with random
+ literals and matches, with both literals and matches crossing
+ OC_LZVN_CHECKSUM_WINDOW boundaries.
+*/
+
+//
+// Sizes around Adler-32 modulo reduction interval (5552) and larger ones.
+//
+STATIC UINT32 mTestSizes[] = {
+  1, 5551, 5552, 5553, 2 * 5552 + 1, 3 * BASE_64KB - 7, BASE_1MB + 13
+};
+
+typedef struct {
+  UINT8   *Stream;
+  UINT32  StreamSize;
+  UINT8   *Data;
+  UINT32  DataSize;
+  UINT32  Capacity;
+  UINT32  CrossingLiterals;
+  UINT32  CrossingMatches;
+} LZVN_ENCODER;
+
+STATIC
+BOOLEAN
+CrossesWindow (
+  IN UINT32  Offset,
+  IN UINT32  Size
+  )
+{
+  return Offset / OC_LZVN_CHECKSUM_WINDOW != (Offset + Size - 1) / OC_LZVN_CHECKSUM_WINDOW;
+}
+
+STATIC
+VOID
+FillData (
+  OUT UINT8   *Data,
+  IN  UINT32  Size
+  )
+{
+  UINT32  Index;
+
+  //
+  // Runs of random and repeated bytes, so that LZSS finds matches.
+  //
+  for (Index = 0; Index < Size; ++Index) {
+    if (Index >= 32 && (Index / 64) % 2 == 0 && rand () % 16 != 0) {
+      Data[Index] = Data[Index - 32];
+    } else {
+      Data[Index] = (UINT8) rand ();
+    }
+  }
+}
+
+STATIC
+VOID
+LzvnEmitLiteral (
+  IN OUT LZVN_ENCODER  *Encoder,
+  IN     UINT32        Size
+  )
+{
+  UINT32  Index;
+
+  ASSERT (Size > 0 && Size <= 271);
+
+  if (Size < 16) {
+    Encoder->Stream[Encoder->StreamSize++] = (UINT8) (0xE0 | Size);
+  } else {
+    Encoder->Stream[Encoder->StreamSize++] = 0xE0;
+    Encoder->Stream[Encoder->StreamSize++] = (UINT8) (Size - 16);
+  }
+
+  if (CrossesWindow (Encoder->DataSize, Size)) {
+    ++Encoder->CrossingLiterals;
+  }
+
+  for (Index = 0; Index < Size; ++Index) {
+    Encoder->Data[Encoder->DataSize] = (UINT8) rand ();
+    Encoder->Stream[Encoder->StreamSize++] = Encoder->Data[Encoder->DataSize++];
+  }
+}
+
+STATIC
+VOID
+LzvnEmitMatch (
+  IN OUT LZVN_ENCODER  *Encoder,
+  IN     UINT32        Distance,
+  IN     UINT32        Size
+  )
+{
+  UINT32  Index;
+  UINT32  Chunk;
+
+  ASSERT (Distance > 0 && Distance <= MIN (Encoder->DataSize, MAX_UINT16));
+  ASSERT (Size >= 3);
+
+  if (CrossesWindow (Encoder->DataSize, Size)) {
+    ++Encoder->CrossingMatches;
+  }
+
+  for (Index = 0; Index < Size; ++Index) {
+    Encoder->Data[Encoder->DataSize] = Encoder->Data[Encoder->DataSize - Distance];
+    ++Encoder->DataSize;
+  }
+
+  //
+  // Large distance opcode LLMMM111 with 0 literals and 3 to 10 bytes,
+  // followed by matches with the same distance.
+  //
+  Chunk = MIN (Size, 10);
+  Encoder->Stream[Encoder->StreamSize++] = (UINT8) (((Chunk - 3) << 3) | 0x07);
+  Encoder->Stream[Encoder->StreamSize++] = (UINT8) Distance;
+  Encoder->Stream[Encoder->StreamSize++] = (UINT8) (Distance >> 8);
+  Size -= Chunk;
+
+  while (Size > 0) {
+    Chunk = MIN (Size, 271);
+    if (Chunk < 16) {
+      Encoder->Stream[Encoder->StreamSize++] = (UINT8) (0xF0 | Chunk);
+    } else {
+      Encoder->Stream[Encoder->StreamSize++] = 0xF0;
+      Encoder->Stream[Encoder->StreamSize++] = (UINT8) (Chunk - 16);
+    }
+    Size -= Chunk;
+  }
+}
+
+STATIC
+BOOLEAN
+LzvnEncodeRandom (
+  OUT LZVN_ENCODER  *Encoder,
+  IN  UINT32        Size
+  )
+{
+  UINT32  Distance;
+  UINT32  Length;
+  UINT32  Remaining;
+
+  Encoder->Capacity   = Size + 1024;
+  Encoder->Data       = malloc (Encoder->Capacity);
+  Encoder->Stream     = malloc (2 * Encoder->Capacity);
+  Encoder->StreamSize = 0;
+  Encoder->DataSize   = 0;
+
+  Encoder->CrossingLiterals = 0;
+  Encoder->CrossingMatches  = 0;
+
+  if (Encoder->Data == NULL || Encoder->Stream == NULL) {
+    return FALSE;
+  }
+
+  while (Encoder->DataSize < Size) {
+    Distance = 1 + rand () % MIN (MAX (Encoder->DataSize, 1), MAX_UINT16);
+
+    //
+    // Make literals and matches cross window boundaries in turn.
+    //
+    Remaining = OC_LZVN_CHECKSUM_WINDOW - Encoder->DataSize % OC_LZVN_CHECKSUM_WINDOW;
+    if (Remaining < 271 && Encoder->DataSize >= 16) {
+      if ((Encoder->DataSize / OC_LZVN_CHECKSUM_WINDOW) % 2 == 0) {
+        LzvnEmitLiteral (Encoder, Remaining + 1);
+      } else {
+        LzvnEmitMatch (Encoder, Distance, Remaining + 3);
+      }
+      continue;
+    }
+
+    if (Encoder->DataSize < 16 || rand () % 3 == 0) {
+      LzvnEmitLiteral (Encoder, 1 + rand () % 271);
+    } else {
+      Length = 3 + rand () % 1000;
+      LzvnEmitMatch (Encoder, Distance, Length);
+    }
+  }
+
+  //
+  // End of stream opcode with 7 bytes of padding.
+  //
+  ZeroMem (&Encoder->Stream[Encoder->StreamSize], 8);
+  Encoder->Stream[Encoder->StreamSize] = 0x06;
+  Encoder->StreamSize += 8;
+  return TRUE;
+}
+
+STATIC
+INT32
+TestLzss (
+  IN UINT32  Size
+  )
+{
+  UINT8   *Data;
+  UINT8   *Compressed;
+  UINT8   *Decompressed;
+  UINT8   *CompressedEnd;
+  UINT32  CompressedSize;
+  UINT32  DecompressedSize;
+  UINT32  Checksum;
+  UINT32  Expected;
+  INT32   Failed;
+
+  Data         = malloc (Size);
+  Compressed   = malloc (2 * Size + 64);
+  Decompressed = malloc (Size);
+  if (Data == NULL || Compressed == NULL || Decompressed == NULL) {
+    printf ("Alloc fail\n");
+    return 1;
+  }
+
+  FillData (Data, Size);
+  CompressedEnd = CompressLZSS (Compressed, 2 * Size + 64, Data, Size);
+  if (CompressedEnd == NULL) {
+    printf ("LZSS %u: compression failed\n", Size);
+    return 1;
+  }
+
+  CompressedSize   = (UINT32) (CompressedEnd - Compressed);
+  Checksum         = 0;
+  DecompressedSize = DecompressLZSSWithChecksum (Decompressed, Size, Compressed, CompressedSize, &Checksum);
+  Expected         = Adler32Update (1, Data, Size);
+
+  Failed = DecompressedSize != Size
+    || CompareMem (Decompressed, Data, Size) != 0
+    || Checksum != Expected;
+
+  printf (
+    "LZSS %u (%u compressed): checksum %08X, zlib %08X - %s\n",
+    Size,
+    CompressedSize,
+    Checksum,
+    Expected,
+    Failed ? "FAIL" : "OK"
+    );
+
+  free (Decompressed);
+  free (Compressed);
+  free (Data);
+  return Failed;
+}
+
+STATIC
+INT32
+TestLzvn (
+  IN UINT32  Size
+  )
+{
+  LZVN_ENCODER  Encoder;
+  UINT8         *Decompressed;
+  UINT32        DecompressedSize;
+  UINT32        Truncated;
+  UINT32        TruncatedChecksum;
+  UINT32        Checksum;
+  UINT32        Expected;
+  INT32         Failed;
+
+  if (!LzvnEncodeRandom (&Encoder, Size)) {
+    printf ("Alloc fail\n");
+    return 1;
+  }
+
+  Decompressed = malloc (Encoder.DataSize);
+  if (Decompressed == NULL) {
+    printf ("Alloc fail\n");
+    return 1;
+  }
+
+  Checksum         = 0;
+  DecompressedSize = (UINT32) DecompressLZVNWithChecksum (
+    Decompressed,
+    Encoder.DataSize,
+    Encoder.Stream,
+    Encoder.StreamSize,
+    &Checksum
+    );
+  Expected         = Adler32Update (1, Encoder.Data, Encoder.DataSize);
+
+  Failed = DecompressedSize != Encoder.DataSize
+    || CompareMem (Decompressed, Encoder.Data, Encoder.DataSize) != 0
+    || Checksum != Expected;
+
+  //
+  // Short destination stops inside a match, checksum covers what was written.
+  //
+  Truncated         = Encoder.DataSize - Encoder.DataSize / 3;
+  TruncatedChecksum = 0;
+  DecompressedSize  = (UINT32) DecompressLZVNWithChecksum (
+    Decompressed,
+    Truncated,
+    Encoder.Stream,
+    Encoder.StreamSize,
+    &TruncatedChecksum
+    );
+
+  Failed |= DecompressedSize != Truncated
+    || TruncatedChecksum != Adler32Update (1, Encoder.Data, Truncated);
+
+  //
+  // Larger inputs must exercise window boundaries in the middle of opcodes.
+  //
+  if (Encoder.DataSize > 2 * OC_LZVN_CHECKSUM_WINDOW) {
+    Failed |= Encoder.CrossingLiterals == 0 || Encoder.CrossingMatches == 0;
+  }
+
+  printf (
+    "LZVN %u (%u compressed, %u/%u crossing literals/matches): checksum %08X, zlib %08X - %s\n",
+    Encoder.DataSize,
+    Encoder.StreamSize,
+    Encoder.CrossingLiterals,
+    Encoder.CrossingMatches,
+    Checksum,
+    Expected,
+    Failed ? "FAIL" : "OK"
+    );
+
+  free (Decompressed);
+  free (Encoder.Stream);
+  free (Encoder.Data);
+  return Failed;
+}
+
+int main(int argc, char** argv) {
+  UINT32  Index;
+  INT32   Failures;
+
+  srand (argc > 1 ? (unsigned) strtoul (argv[1], NULL, 0) : 0);
+
+  Failures = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mTestSizes); ++Index) {
+    Failures += TestLzss (mTestSizes[Index]);
+    Failures += TestLzvn (mTestSizes[Index]);
+  }
+
+  return Failures == 0 ? 0 : -1;
+}
@@ -0,0 +1,265 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/OcCryptoLib.h>
+
+#include "../../Tests/CryptoTest/CryptoSamples.h"
+
+#include <sys/time.h>
+
+/*
+ clang -g -O3 -I../Include -I../../Include -I../../Include/Intel -I../../../MdePkg/Include/ -include ../Include/Base.h Crypto.c ../../Library/OcCryptoLib/Sha2.c ../../Library/OcCryptoLib/Sha2Accel.c ../../Library/OcCryptoLib/SecureMem.c -o Crypto
+
+ ./Crypto [megabytes] [seed]
+
+ Checks every SHA-2 implementation supported by the CPU against known answers
+ and against generic code on random inputs fed in random pieces, then reports
+ SHA-256 and SHA-512 throughput of each implementation.
+*/
+
+#define CRYPTO_RANDOM_ROUNDS   256
+#define CRYPTO_RANDOM_MAX_SIZE 4096
+
+STATIC CONST char *mImplementationNames[] = {"generic", "AVX2", "SHA-NI"};
+
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long microseconds = te.tv_sec*1000000LL + te.tv_usec; // calculate microseconds
+    return microseconds;
+}
+
+STATIC
+VOID
+HashPieces (
+  IN  CONST UINT8  *Data,
+  IN  UINTN        Size,
+  OUT UINT8        *Sha256Hash,
+  OUT UINT8        *Sha384Hash,
+  OUT UINT8        *Sha512Hash
+  )
+{
+  SHA256_CONTEXT  Sha256Context;
+  SHA384_CONTEXT  Sha384Context;
+  SHA512_CONTEXT  Sha512Context;
+  UINTN           Offset;
+  UINTN           Piece;
+
+  Sha256Init (&Sha256Context);
+  Sha384Init (&Sha384Context);
+  Sha512Init (&Sha512Context);
+
+  for (Offset = 0; Offset < Size; Offset += Piece) {
+    //
+    // Mix short pieces, which stay buffered, with long ones processed in place.
+    //
+    if (rand () % 2 == 0) {
+      Piece = (UINTN) rand () % SHA512_BLOCK_SIZE + 1;
+    } else {
+      Piece = (UINTN) rand () % (4 * SHA512_BLOCK_SIZE * SHA512_BLOCK_SIZE) + 1;
+    }
+
+    Piece = MIN (Piece, Size - Offset);
+
+    Sha256Update (&Sha256Context, &Data[Offset], Piece);
+    Sha384Update (&Sha384Context, &Data[Offset], Piece);
+    Sha512Update (&Sha512Context, &Data[Offset], Piece);
+  }
+
+  Sha256Final (&Sha256Context, Sha256Hash);
+  Sha384Final (&Sha384Context, Sha384Hash);
+  Sha512Final (&Sha512Context, Sha512Hash);
+}
+
+STATIC
+UINT32
+CheckKnownAnswers (
+  IN CONST UINT8  *LongSample
+  )
+{
+  UINT32  Failures;
+  UINTN   Index;
+  UINT8   Sha256Hash[SHA256_DIGEST_SIZE];
+  UINT8   Sha384Hash[SHA384_DIGEST_SIZE];
+  UINT8   Sha512Hash[SHA512_DIGEST_SIZE];
+
+  Failures = 0;
+
+  for (Index = 0; Index < HASH_SAMPLES_NUM; ++Index) {
+    Sha256 (Sha256Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+    Sha384 (Sha384Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+    Sha512 (Sha512Hash, HashSamples[Index].PlainText, HashSamples[Index].PlainTextLen);
+
+    if (memcmp (Sha256Hash, HashSamples[Index].Sha256Hash, sizeof (Sha256Hash)) != 0
+      || memcmp (Sha384Hash, HashSamples[Index].Sha384Hash, sizeof (Sha384Hash)) != 0
+      || memcmp (Sha512Hash, HashSamples[Index].Sha512Hash, sizeof (Sha512Hash)) != 0) {
+      printf ("Hash sample %lu mismatch\n", (unsigned long) Index);
+      ++Failures;
+    }
+  }
+
+  Sha256 (Sha256Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+  Sha384 (Sha384Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+  Sha512 (Sha512Hash, LongSample, SHA2_LONG_SAMPLE_LEN);
+
+  if (memcmp (Sha256Hash, Sha256LongSampleHash, sizeof (Sha256Hash)) != 0
+    || memcmp (Sha384Hash, Sha384LongSampleHash, sizeof (Sha384Hash)) != 0
+    || memcmp (Sha512Hash, Sha512LongSampleHash, sizeof (Sha512Hash)) != 0) {
+    printf ("Long hash sample mismatch\n");
+    ++Failures;
+  }
+
+  //
+  // Feed the long sample in random pieces to cover block buffering.
+  //
+  HashPieces (LongSample, SHA2_LONG_SAMPLE_LEN, Sha256Hash, Sha384Hash, Sha512Hash);
+  if (memcmp (Sha256Hash, Sha256LongSampleHash, sizeof (Sha256Hash)) != 0
+    || memcmp (Sha384Hash, Sha384LongSampleHash, sizeof (Sha384Hash)) != 0
+    || memcmp (Sha512Hash, Sha512LongSampleHash, sizeof (Sha512Hash)) != 0) {
+    printf ("Long hash sample mismatch when hashed in pieces\n");
+    ++Failures;
+  }
+
+  return Failures;
+}
+
+STATIC
+UINT32
+CheckRandomInputs (
+  IN OC_SHA2_IMPLEMENTATION  Implementation,
+  IN unsigned                Seed
+  )
+{
+  UINT8   *Data;
+  UINT32  Failures;
+  UINT32  Round;
+  UINTN   Size;
+  UINTN   Index;
+  UINT8   Sha256Hash[2][SHA256_DIGEST_SIZE];
+  UINT8   Sha384Hash[2][SHA384_DIGEST_SIZE];
+  UINT8   Sha512Hash[2][SHA512_DIGEST_SIZE];
+
+  Data = malloc (CRYPTO_RANDOM_MAX_SIZE);
+  if (Data == NULL) {
+    return 1;
+  }
+
+  Failures = 0;
+  srand (Seed);
+
+  for (Round = 0; Round < CRYPTO_RANDOM_ROUNDS; ++Round) {
+    Size = (UINTN) rand () % (CRYPTO_RANDOM_MAX_SIZE + 1);
+    for (Index = 0; Index < Size; ++Index) {
+      Data[Index] = (UINT8) rand ();
+    }
+
+    OcSha2SetImplementation (OcSha2ImplementationGeneric);
+    Sha256 (Sha256Hash[0], Data, Size);
+    Sha384 (Sha384Hash[0], Data, Size);
+    Sha512 (Sha512Hash[0], Data, Size);
+
+    OcSha2SetImplementation (Implementation);
+    HashPieces (Data, Size, Sha256Hash[1], Sha384Hash[1], Sha512Hash[1]);
+
+    if (memcmp (Sha256Hash[0], Sha256Hash[1], sizeof (Sha256Hash[0])) != 0
+      || memcmp (Sha384Hash[0], Sha384Hash[1], sizeof (Sha384Hash[0])) != 0
+      || memcmp (Sha512Hash[0], Sha512Hash[1], sizeof (Sha512Hash[0])) != 0) {
+      printf ("Random input %u of %lu bytes mismatch\n", Round, (unsigned long) Size);
+      ++Failures;
+    }
+  }
+
+  free (Data);
+  return Failures;
+}
+
+STATIC
+VOID
+Benchmark (
+  IN CONST UINT8  *Data,
+  IN UINTN        Size
+  )
+{
+  long long  Start;
+  long long  Sha256Time;
+  long long  Sha512Time;
+  UINT8      Hash[SHA512_DIGEST_SIZE];
+
+  Start = current_timestamp ();
+  Sha256 (Hash, Data, Size);
+  Sha256Time = current_timestamp () - Start;
+
+  Start = current_timestamp ();
+  Sha512 (Hash, Data, Size);
+  Sha512Time = current_timestamp () - Start;
+
+  printf (
+    "  SHA-256 %lld us (%.1f MB/s), SHA-512 %lld us (%.1f MB/s)\n",
+    Sha256Time,
+    Sha256Time > 0 ? (double) Size / Sha256Time : 0.0,
+    Sha512Time,
+    Sha512Time > 0 ? (double) Size / Sha512Time : 0.0
+    );
+}
+
+int main(int argc, char** argv) {
+  UINT8                   *LongSample;
+  UINT8                   *BenchData;
+  UINTN                   BenchSize;
+  UINTN                   Index;
+  unsigned                Seed;
+  UINT32                  Failures;
+  UINT32                  ImplementationFailures;
+  OC_SHA2_IMPLEMENTATION  Implementation;
+
+  BenchSize = (argc > 1 ? (UINTN) strtoul (argv[1], NULL, 0) : 64) * BASE_1MB;
+  Seed      = argc > 2 ? (unsigned) strtoul (argv[2], NULL, 0) : 0;
+
+  LongSample = malloc (SHA2_LONG_SAMPLE_LEN);
+  BenchData  = malloc (BenchSize);
+  if (LongSample == NULL || BenchData == NULL) {
+    printf ("Alloc fail\n");
+    return -1;
+  }
+
+  SetMem (LongSample, SHA2_LONG_SAMPLE_LEN, SHA2_LONG_SAMPLE_CHAR);
+  for (Index = 0; Index < BenchSize; ++Index) {
+    BenchData[Index] = (UINT8) (Index * 131 + (Index >> 12));
+  }
+
+  Failures = 0;
+
+  for (
+    Implementation = OcSha2ImplementationGeneric;
+    Implementation <= OcSha2ImplementationShaNi;
+    ++Implementation) {
+    if (OcSha2SetImplementation (Implementation) != Implementation) {
+      printf ("%s: not supported\n", mImplementationNames[Implementation]);
+      continue;
+    }
+
+    ImplementationFailures  = CheckKnownAnswers (LongSample);
+    ImplementationFailures += CheckRandomInputs (Implementation, Seed);
+    Failures               += ImplementationFailures;
+
+    OcSha2SetImplementation (Implementation);
+    printf ("%s: %u failures\n", mImplementationNames[Implementation], ImplementationFailures);
+    Benchmark (BenchData, BenchSize);
+  }
+
+  free (LongSample);
+  free (BenchData);
+
+  return Failures == 0 ? 0 : -1;
+}
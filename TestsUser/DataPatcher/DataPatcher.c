@@ -0,0 +1,365 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/OcMiscLib.h>
+#include <Library/OcStringLib.h>
+
+#include <sys/time.h>
+
+/*
+ clang -g -O3 -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h DataPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcMiscLib/DataPatcherBatch.c -o DataPatcher
+
+ ./DataPatcher /System/Library/Kernels/kernel [patches] [seed]
+
+ Compares FindPattern with a naive matcher and sequential ApplyPatch calls
+ with ApplyPatchBatch on patches sampled from the file and reports timings.
+*/
+
+#define DATA_PATCHER_MAX_PATTERN 32
+
+typedef struct {
+  UINT8  Pattern[DATA_PATCHER_MAX_PATTERN];
+  UINT8  PatternMask[DATA_PATCHER_MAX_PATTERN];
+  UINT8  Replace[DATA_PATCHER_MAX_PATTERN];
+  UINT8  ReplaceMask[DATA_PATCHER_MAX_PATTERN];
+} DATA_PATCHER_BYTES;
+
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long microseconds = te.tv_sec*1000000LL + te.tv_usec; // calculate microseconds
+    return microseconds;
+}
+
+uint8_t *readFile(const char *str, uint32_t *size) {
+  FILE *f = fopen(str, "rb");
+
+  if (!f) return NULL;
+
+  fseek(f, 0, SEEK_END);
+  long fsize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t *string = malloc(fsize + 1);
+  fread(string, fsize, 1, f);
+  fclose(f);
+
+  string[fsize] = 0;
+  *size = fsize;
+
+  return string;
+}
+
+STATIC
+INT32
+NaiveFindPattern (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN CONST UINT32  PatternSize,
+  IN CONST UINT8   *Data,
+  IN UINT32        DataSize,
+  IN INT32         DataOff
+  )
+{
+  UINT32  Index;
+
+  if (PatternSize == 0 || DataSize == 0 || (UINT32)DataOff >= DataSize || DataSize - DataOff < PatternSize) {
+    return -1;
+  }
+
+  while (DataOff + PatternSize < DataSize) {
+    for (Index = 0; Index < PatternSize; ++Index) {
+      if ((PatternMask == NULL && Data[DataOff + Index] != Pattern[Index])
+        || (PatternMask != NULL && (Data[DataOff + Index] & PatternMask[Index]) != Pattern[Index])) {
+        break;
+      }
+    }
+
+    if (Index == PatternSize) {
+      return DataOff;
+    }
+    ++DataOff;
+  }
+
+  return -1;
+}
+
+STATIC
+UINT32
+BenchmarkFindPattern (
+  IN CONST UINT8               *Data,
+  IN UINT32                    DataSize,
+  IN CONST PATCH_BATCH_ENTRY   *Patches,
+  IN UINT32                    PatchCount
+  )
+{
+  UINT32     Index;
+  UINT32     Pass;
+  UINT32     Found[2];
+  UINT32     Mismatches;
+  INT32      Offset;
+  INT32      Expected;
+  long long  Start;
+  long long  Time[2];
+
+  Mismatches = 0;
+
+  for (Pass = 0; Pass < 2; ++Pass) {
+    Found[Pass] = 0;
+    Start       = current_timestamp ();
+    for (Index = 0; Index < PatchCount; ++Index) {
+      if (Patches[Index].Pattern == NULL) {
+        continue;
+      }
+
+      Offset = 0;
+      while (TRUE) {
+        if (Pass == 0) {
+          Offset = NaiveFindPattern (Patches[Index].Pattern, Patches[Index].PatternMask,
+            Patches[Index].PatternSize, Data, DataSize, Offset);
+        } else {
+          Expected = NaiveFindPattern (Patches[Index].Pattern, Patches[Index].PatternMask,
+            Patches[Index].PatternSize, Data, DataSize, Offset);
+          Offset = FindPattern (Patches[Index].Pattern, Patches[Index].PatternMask,
+            Patches[Index].PatternSize, Data, DataSize, Offset);
+          if (Offset != Expected) {
+            printf ("Pattern %u lookup mismatch %d vs %d\n", Index, Offset, Expected);
+            ++Mismatches;
+            break;
+          }
+        }
+
+        if (Offset < 0) {
+          break;
+        }
+
+        ++Found[Pass];
+        ++Offset;
+      }
+    }
+    Time[Pass] = current_timestamp () - Start;
+  }
+
+  //
+  // Second pass also runs the naive matcher for verification, time FindPattern alone.
+  //
+  Start = current_timestamp ();
+  for (Index = 0; Index < PatchCount; ++Index) {
+    if (Patches[Index].Pattern == NULL) {
+      continue;
+    }
+
+    Offset = 0;
+    while ((Offset = FindPattern (Patches[Index].Pattern, Patches[Index].PatternMask,
+      Patches[Index].PatternSize, Data, DataSize, Offset)) >= 0) {
+      ++Offset;
+    }
+  }
+  Time[1] = current_timestamp () - Start;
+
+  Start  = current_timestamp ();
+  Offset = FindPattern ((CONST UINT8 *) "Darwin Kernel Version ", NULL,
+    L_STR_LEN ("Darwin Kernel Version "), Data, DataSize, 0);
+
+  printf (
+    "FindPattern %u matches: naive %lld us, prepared %lld us, version lookup %lld us (%d) - %s\n",
+    Found[1],
+    Time[0],
+    Time[1],
+    current_timestamp () - Start,
+    Offset,
+    Mismatches == 0 && Found[0] == Found[1] ? "OK" : "FAIL"
+    );
+
+  return Mismatches + (Found[0] != Found[1]);
+}
+
+STATIC
+VOID
+GeneratePatches (
+  IN  CONST UINT8         *Data,
+  IN  UINT32              DataSize,
+  OUT PATCH_BATCH_ENTRY   *Patches,
+  OUT DATA_PATCHER_BYTES  *Bytes,
+  IN  UINT32              PatchCount
+  )
+{
+  UINT32  Index;
+  UINT32  Byte;
+  UINT32  Offset;
+  UINT32  Size;
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Size   = 4 + rand () % (DATA_PATCHER_MAX_PATTERN - 4);
+    Offset = rand () % (DataSize - Size);
+
+    //
+    // Short patterns from real data match multiple times,
+    // which tests Count and Skip handling.
+    //
+    if (rand () % 4 == 0) {
+      Size = 4;
+    }
+
+    ZeroMem (&Patches[Index], sizeof (Patches[Index]));
+    Patches[Index].PatternMask = rand () % 3 == 0 ? Bytes[Index].PatternMask : NULL;
+    Patches[Index].ReplaceMask = rand () % 3 == 0 ? Bytes[Index].ReplaceMask : NULL;
+
+    //
+    // Some patches match data replaced by the previous patch
+    // to check that newly created matches are found.
+    //
+    if (Index > 0 && rand () % 8 == 0 && Patches[Index - 1].Pattern != NULL
+      && Patches[Index - 1].ReplaceMask == NULL) {
+      Size = Patches[Index - 1].PatternSize;
+      CopyMem (Bytes[Index].Pattern, Bytes[Index - 1].Replace, Size);
+    } else {
+      CopyMem (Bytes[Index].Pattern, &Data[Offset], Size);
+    }
+
+    for (Byte = 0; Byte < Size; ++Byte) {
+      Bytes[Index].Replace[Byte]     = (UINT8) rand ();
+      Bytes[Index].PatternMask[Byte] = rand () % 6 == 0 ? 0xF0 : 0xFF;
+      Bytes[Index].ReplaceMask[Byte] = (UINT8) rand ();
+      if (Patches[Index].PatternMask != NULL) {
+        Bytes[Index].Pattern[Byte] &= Bytes[Index].PatternMask[Byte];
+      }
+    }
+
+    Patches[Index].Pattern     = Bytes[Index].Pattern;
+    Patches[Index].Replace     = Bytes[Index].Replace;
+    Patches[Index].PatternSize = Size;
+    Patches[Index].Count       = rand () % 3 == 0 ? 1 + rand () % 4 : 0;
+    Patches[Index].Skip        = rand () % 4 == 0 ? rand () % 3 : 0;
+
+    if (rand () % 4 == 0) {
+      Patches[Index].DataOffset = rand () % (DataSize / 2);
+      Patches[Index].DataSize   = rand () % (DataSize - Patches[Index].DataOffset);
+    } else {
+      Patches[Index].DataOffset = 0;
+      Patches[Index].DataSize   = DataSize;
+    }
+
+    if (rand () % 16 == 0) {
+      Patches[Index].Pattern = NULL;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  UINT8               *Data;
+  UINT8               *Sequential;
+  UINT8               *Batch;
+  UINT32              DataSize;
+  UINT32              PatchCount;
+  UINT32              Index;
+  UINT32              *ReplaceCounts;
+  UINT32              Mismatches;
+  PATCH_BATCH_ENTRY   *Patches;
+  DATA_PATCHER_BYTES  *Bytes;
+  long long           Start;
+  long long           SequentialTime;
+  long long           BatchTime;
+
+  if (argc < 2 || (Data = readFile (argv[1], &DataSize)) == NULL || DataSize < 2 * DATA_PATCHER_MAX_PATTERN) {
+    printf ("Read fail\n");
+    return -1;
+  }
+
+  PatchCount = argc > 2 ? (UINT32) strtoul (argv[2], NULL, 0) : 50;
+  srand (argc > 3 ? (unsigned) strtoul (argv[3], NULL, 0) : 0);
+
+  Sequential    = malloc (DataSize);
+  Batch         = malloc (DataSize);
+  Patches       = calloc (PatchCount, sizeof (*Patches));
+  Bytes         = calloc (PatchCount, sizeof (*Bytes));
+  ReplaceCounts = calloc (PatchCount, sizeof (*ReplaceCounts));
+  if (Sequential == NULL || Batch == NULL || Patches == NULL || Bytes == NULL || ReplaceCounts == NULL) {
+    printf ("Alloc fail\n");
+    return -1;
+  }
+
+  GeneratePatches (Data, DataSize, Patches, Bytes, PatchCount);
+  Mismatches = BenchmarkFindPattern (Data, DataSize, Patches, PatchCount);
+
+  CopyMem (Sequential, Data, DataSize);
+  CopyMem (Batch, Data, DataSize);
+
+  Start = current_timestamp ();
+  for (Index = 0; Index < PatchCount; ++Index) {
+    if (Patches[Index].Replace == NULL) {
+      continue;
+    }
+
+    if (Patches[Index].Pattern == NULL) {
+      if (Patches[Index].PatternSize <= Patches[Index].DataSize) {
+        CopyMem (&Sequential[Patches[Index].DataOffset], Patches[Index].Replace, Patches[Index].PatternSize);
+        ReplaceCounts[Index] = 1;
+      }
+      continue;
+    }
+
+    ReplaceCounts[Index] = ApplyPatch (
+      Patches[Index].Pattern,
+      Patches[Index].PatternMask,
+      Patches[Index].PatternSize,
+      Patches[Index].Replace,
+      Patches[Index].ReplaceMask,
+      &Sequential[Patches[Index].DataOffset],
+      Patches[Index].DataSize,
+      Patches[Index].Count,
+      Patches[Index].Skip
+      );
+  }
+  SequentialTime = current_timestamp () - Start;
+
+  Start = current_timestamp ();
+  ApplyPatchBatch (Batch, DataSize, Patches, PatchCount);
+  BatchTime = current_timestamp () - Start;
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    if (ReplaceCounts[Index] != Patches[Index].ReplaceCount) {
+      printf (
+        "Patch %u replace count mismatch %u vs %u\n",
+        Index,
+        ReplaceCounts[Index],
+        Patches[Index].ReplaceCount
+        );
+      ++Mismatches;
+    }
+  }
+
+  if (CompareMem (Sequential, Batch, DataSize) != 0) {
+    printf ("Patched data mismatch\n");
+    ++Mismatches;
+  }
+
+  printf (
+    "%u patches on %u bytes: sequential %lld us, batch %lld us - %s\n",
+    PatchCount,
+    DataSize,
+    SequentialTime,
+    BatchTime,
+    Mismatches == 0 ? "OK" : "FAIL"
+    );
+
+  free (ReplaceCounts);
+  free (Bytes);
+  free (Patches);
+  free (Batch);
+  free (Sequential);
+  free (Data);
+
+  return Mismatches == 0 ? 0 : -1;
+}
@@ -6,17 +6,179 @@
 #include <Library/OcAppleKeysLib.h>
 #include <Library/OcCompressionLib.h>
 
+#include <sys/time.h>
+
 /**
 
-clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c ../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
+clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcMiscLib/Fnv1a.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c ../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
 
-clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
+clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcMiscLib/Fnv1a.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
 rm -rf DICT fuzz*.log ; mkdir DICT ; UBSAN_OPTIONS='halt_on_error=1' ./DiskImage -jobs=4 DICT -rss_limit_mb=4096
 
+
+To benchmark chunk lookup, pass a BaseSystem.dmg and its chunklist from a recovery image
+(e.g. ./DiskImage BaseSystem.dmg BaseSystem.chunklist). The raw image is read through
+a fragmented extent table with and without a RAM disk cursor. The image is decompressed once as
+a whole and then read sector by sector with and without chunk ranges, reporting timings.
+
 **/
 
 EFI_GUID gOcVendorVariableGuid;
 
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000; // calculate milliseconds
+    return milliseconds;
+}
+
+//
+// Read the image sector by sector like a filesystem driver would.
+//
+static int ReadDmgBySector(OC_APPLE_DISK_IMAGE_CONTEXT *DmgContext, const uint8_t *UncompDmg) {
+  UINT8 Sector[APPLE_DISK_IMAGE_SECTOR_SIZE];
+  for (UINTN Lba = 0; Lba < DmgContext->SectorCount; ++Lba) {
+    BOOLEAN Result = OcAppleDiskImageRead (DmgContext, Lba, sizeof (Sector), Sector);
+    if (!Result || memcmp (Sector, &UncompDmg[Lba * APPLE_DISK_IMAGE_SECTOR_SIZE], sizeof (Sector)) != 0) {
+      printf ("DMG sector %lu read error\n", (unsigned long) Lba);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//
+// In-memory image file for chunklist-verified loading.
+//
+static uint8_t *mFileData;
+static UINT64  mFileSize;
+static UINT64  mFilePosition;
+
+static EFI_STATUS EFIAPI MemFileSetPosition(EFI_FILE_PROTOCOL *This, UINT64 Position) {
+  mFilePosition = Position == 0xFFFFFFFFFFFFFFFFULL ? mFileSize : Position;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MemFileGetPosition(EFI_FILE_PROTOCOL *This, UINT64 *Position) {
+  *Position = mFilePosition;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MemFileRead(EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer) {
+  if (mFilePosition > mFileSize) {
+    return EFI_DEVICE_ERROR;
+  }
+  *BufferSize = MIN (*BufferSize, mFileSize - mFilePosition);
+  memcpy (Buffer, &mFileData[mFilePosition], *BufferSize);
+  mFilePosition += *BufferSize;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI MemFileClose(EFI_FILE_PROTOCOL *This) {
+  return EFI_SUCCESS;
+}
+
+static EFI_FILE_PROTOCOL mMemFile = {
+  .Read        = MemFileRead,
+  .GetPosition = MemFileGetPosition,
+  .SetPosition = MemFileSetPosition,
+  .Close       = MemFileClose
+};
+
+#define NUM_EXTENTS 20
+
+static void BuildExtentTableWithCount(APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable, uint8_t *Data, long Size, UINT32 Count) {
+  ExtentTable->Signature   = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+  ExtentTable->Version     = APPLE_RAM_DISK_EXTENT_VERSION;
+  ExtentTable->Reserved    = 0;
+  ExtentTable->Signature2  = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+
+  ExtentTable->ExtentCount = MIN (Count, ARRAY_SIZE (ExtentTable->Extents));
+
+  UINT32 Index;
+  for (Index = 0; Index < ExtentTable->ExtentCount; ++Index) {
+    ExtentTable->Extents[Index].Start = (uintptr_t)Data + (Index * (Size / ExtentTable->ExtentCount));
+    ExtentTable->Extents[Index].Length = (Size / ExtentTable->ExtentCount);
+  }
+  if (Index != 0) {
+    ExtentTable->Extents[Index - 1].Length += (Size - (Index * (Size / ExtentTable->ExtentCount)));
+  }
+}
+
+static void BuildExtentTable(APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable, uint8_t *Data, long Size) {
+  BuildExtentTableWithCount (ExtentTable, Data, Size, NUM_EXTENTS);
+}
+
+//
+// Read the image through a maximally fragmented extent table sector by sector
+// and in random order, walking the table and then using a RAM disk cursor.
+//
+static int ReadFragmentedRamDisk(uint8_t *Dmg, long DmgSize) {
+  APPLE_RAM_DISK_EXTENT_TABLE ExtentTable;
+  OC_APPLE_RAM_DISK_CURSOR    Cursor;
+  UINT8                       Sector[APPLE_DISK_IMAGE_SECTOR_SIZE];
+  long long                   Start;
+  long                        Offset;
+  long                        Size;
+  UINT32                      Pass;
+  UINT32                      Index;
+  UINT32                      Seed;
+
+  BuildExtentTableWithCount (&ExtentTable, Dmg, DmgSize, APPLE_RAM_DISK_MAX_EXTENTS);
+  OcAppleRamDiskInitCursor (&Cursor, &ExtentTable);
+
+  for (Pass = 0; Pass < 2; ++Pass) {
+    Start = current_timestamp ();
+    for (Offset = 0; Offset < DmgSize; Offset += sizeof (Sector)) {
+      Size = MIN ((long) sizeof (Sector), DmgSize - Offset);
+      if (Pass == 0 ? !OcAppleRamDiskRead (&ExtentTable, Offset, Size, Sector)
+        : !OcAppleRamDiskCursorRead (&Cursor, Offset, Size, Sector)) {
+        printf ("RAM disk read error at %ld\n", Offset);
+        return -1;
+      }
+
+      if (memcmp (Sector, &Dmg[Offset], Size) != 0) {
+        printf ("RAM disk mismatch at %ld\n", Offset);
+        return -1;
+      }
+    }
+
+    printf (
+      "Read %u-extent RAM disk sequentially in %lld ms %s\n",
+      ExtentTable.ExtentCount,
+      current_timestamp () - Start,
+      Pass == 0 ? "walking extents" : "with cursor"
+      );
+
+    Seed  = 1;
+    Start = current_timestamp ();
+    for (Index = 0; Index < (UINT32) (DmgSize / sizeof (Sector)); ++Index) {
+      Seed   = Seed * 1103515245U + 12345U;
+      Offset = (long) (Seed % (UINT32) DmgSize);
+      Size   = MIN ((long) sizeof (Sector), DmgSize - Offset);
+      if (Pass == 0 ? !OcAppleRamDiskRead (&ExtentTable, Offset, Size, Sector)
+        : !OcAppleRamDiskCursorRead (&Cursor, Offset, Size, Sector)) {
+        printf ("RAM disk read error at %ld\n", Offset);
+        return -1;
+      }
+
+      if (memcmp (Sector, &Dmg[Offset], Size) != 0) {
+        printf ("RAM disk mismatch at %ld\n", Offset);
+        return -1;
+      }
+    }
+
+    printf (
+      "Read %u-extent RAM disk randomly in %lld ms %s\n",
+      ExtentTable.ExtentCount,
+      current_timestamp () - Start,
+      Pass == 0 ? "walking extents" : "with cursor"
+      );
+  }
+
+  return 0;
+}
+
 uint8_t *readFile(const char *str, long *size) {
   FILE *f = fopen(str, "rb");
 
@@ -65,6 +227,8 @@ int main (int argc, char *argv[]) {
 
     uint8_t *Chunklist = NULL;
     long    ChunklistSize;
+    OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
+    long long Start;
 
     uint8_t  *UncompDmg = NULL;
     uint32_t UncompSize;
@@ -79,23 +243,7 @@ int main (int argc, char *argv[]) {
     OC_APPLE_DISK_IMAGE_CONTEXT DmgContext;
     APPLE_RAM_DISK_EXTENT_TABLE ExtentTable;
 
-#define NUM_EXTENTS 20
-
-    ExtentTable.Signature   = APPLE_RAM_DISK_EXTENT_SIGNATURE;
-    ExtentTable.Version     = APPLE_RAM_DISK_EXTENT_VERSION;
-    ExtentTable.Reserved    = 0;
-    ExtentTable.Signature2  = APPLE_RAM_DISK_EXTENT_SIGNATURE;
-
-    ExtentTable.ExtentCount = MIN (NUM_EXTENTS, ARRAY_SIZE (ExtentTable.Extents));
-
-    UINT32 Index;
-    for (Index = 0; Index < ExtentTable.ExtentCount; ++Index) {
-      ExtentTable.Extents[Index].Start = (uintptr_t)Dmg + (Index * (DmgSize / ExtentTable.ExtentCount));
-      ExtentTable.Extents[Index].Length = (DmgSize / ExtentTable.ExtentCount);
-    }
-    if (Index != 0) {
-      ExtentTable.Extents[Index - 1].Length += (DmgSize - (Index * (DmgSize / ExtentTable.ExtentCount)));
-    }
+    BuildExtentTable (&ExtentTable, Dmg, DmgSize);
 
     Result = OcAppleDiskImageInitializeContext (&DmgContext, &ExtentTable, DmgSize);
     if (!Result) {
@@ -111,7 +259,6 @@ int main (int argc, char *argv[]) {
         goto ContinueDmgLoop;
       }
 
-      OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
       Result = OcAppleChunklistInitializeContext (&ChunklistContext, Chunklist, ChunklistSize);
       if (!Result) {
         printf ("Chunklist Context initialization error\n");
@@ -124,11 +271,42 @@ int main (int argc, char *argv[]) {
         goto ContinueDmgLoop;
       }
 
+      Start = current_timestamp ();
       Result = OcAppleDiskImageVerifyData (&DmgContext, &ChunklistContext);
       if (!Result) {
         printf ("Chunklist chunk verification error\n");
         goto ContinueDmgLoop;
       }
+
+      printf ("Verified preloaded DMG in %lld ms\n", current_timestamp () - Start);
+
+      //
+      // Load the image once more verifying chunks while loading.
+      //
+      APPLE_RAM_DISK_EXTENT_TABLE LoadedExtentTable;
+      uint8_t *LoadedDmg = malloc (DmgSize);
+      if (LoadedDmg == NULL) {
+        printf ("DMG data allocation failed\n");
+        goto ContinueDmgLoop;
+      }
+
+      BuildExtentTable (&LoadedExtentTable, LoadedDmg, DmgSize);
+      mFileData = Dmg;
+      mFileSize = DmgSize;
+      Start = current_timestamp ();
+      Result = OcAppleChunklistLoadFile (&ChunklistContext, &LoadedExtentTable, &mMemFile, DmgSize);
+      if (!Result || memcmp (LoadedDmg, Dmg, DmgSize) != 0) {
+        printf ("Chunklist verified load error\n");
+        free (LoadedDmg);
+        goto ContinueDmgLoop;
+      }
+
+      printf ("Loaded and verified DMG in %lld ms\n", current_timestamp () - Start);
+      free (LoadedDmg);
+    }
+
+    if (ReadFragmentedRamDisk (Dmg, DmgSize) != 0) {
+      goto ContinueDmgLoop;
     }
 
     UncompSize = (DmgContext.SectorCount * APPLE_DISK_IMAGE_SECTOR_SIZE);
@@ -138,13 +316,50 @@ int main (int argc, char *argv[]) {
       goto ContinueDmgLoop;
     }
 
+    Start = current_timestamp ();
     Result = OcAppleDiskImageRead (&DmgContext, 0, UncompSize, UncompDmg);
     if (!Result) {
       printf ("DMG read error\n");
       goto ContinueDmgLoop;
     }
 
-    printf ("Decompressed the entire DMG...\n");
+    printf ("Decompressed the entire DMG in %lld ms...\n", current_timestamp () - Start);
+
+    //
+    // Re-read sector by sector to exercise the chunk cache and chunk ranges,
+    // then repeat with chunk lookup walking the block list.
+    //
+    DmgContext.CacheHits   = 0;
+    DmgContext.CacheMisses = 0;
+    Start = current_timestamp ();
+    if (ReadDmgBySector (&DmgContext, UncompDmg) != 0) {
+      goto ContinueDmgLoop;
+    }
+
+    printf (
+      "Read %lu sectors in %lld ms using %u chunk ranges with %llu chunk cache hits and %llu misses\n",
+      (unsigned long) DmgContext.SectorCount,
+      current_timestamp () - Start,
+      DmgContext.ChunkRangeCount,
+      (unsigned long long) DmgContext.CacheHits,
+      (unsigned long long) DmgContext.CacheMisses
+      );
+
+    OC_APPLE_DISK_IMAGE_CHUNK_RANGE *ChunkRanges = DmgContext.ChunkRanges;
+    DmgContext.ChunkRanges = NULL;
+    Start = current_timestamp ();
+    int Code = ReadDmgBySector (&DmgContext, UncompDmg);
+    DmgContext.ChunkRanges = ChunkRanges;
+    if (Code != 0) {
+      goto ContinueDmgLoop;
+    }
+
+    printf (
+      "Read %lu sectors in %lld ms walking %u blocks\n",
+      (unsigned long) DmgContext.SectorCount,
+      current_timestamp () - Start,
+      DmgContext.BlockCount
+      );
 
 #if 0
     FILE *Fh = fopen("out.bin", "wb");
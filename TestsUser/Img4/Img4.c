@@ -133,10 +133,12 @@ int main (int argc, char *argv[])
           argv[i + 2]
           );
     if (r != 0) {
-      return r;
+      break;
     }
   }
 
+  RsaFreeKeyCache ();
+
   return r;
 }
 
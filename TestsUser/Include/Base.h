@@ -542,6 +542,13 @@ STATIC inline EFI_STATUS FreePool(void *x) { free (x); return EFI_SUCCESS; }
 #define CopyMem(a,b,c) (memmove)((a),(b),(c))
 #define ZeroMem(a,b) (memset)(a, 0, b)
 #define SetMem(Dst, Size, Value) (memset)(Dst, Value, Size)
+STATIC inline VOID *SetMem32(VOID *Dst, UINTN Size, UINT32 Value) {
+  UINTN Index;
+  for (Index = 0; Index < Size / sizeof (UINT32); ++Index) {
+    ((UINT32 *) Dst)[Index] = Value;
+  }
+  return Dst;
+}
 #define AsciiSPrint snppprintf
 #define AsciiStrCmp strcmp
 #define AsciiStrLen strlen
@@ -552,7 +559,8 @@ STATIC inline EFI_STATUS FreePool(void *x) { free (x); return EFI_SUCCESS; }
 #define AsciiStrDecimalToUint64(a) (strtoull)(a, NULL, 10)
 #define AsciiStrHexToUint64(a) (strtoull)(a, NULL, 16)
 
-static inline void FreePages(void *p,UINTN s) {}
+#define AllocatePages(x) (malloc)(EFI_PAGES_TO_SIZE (x))
+static inline void FreePages(void *p,UINTN s) { free (p); }
 #define UnicodeSPrint(...) assert(false)
 #define CompareGuid(a, b) ((memcmp)((a), (b), sizeof (EFI_GUID)) == 0)
 #define CopyGuid(a, b) (memcpy)((a), (b), sizeof (EFI_GUID))
@@ -1706,6 +1714,8 @@ SetDevicePathEndNode (
 // Services
 //
 
+typedef EFI_STATUS (*EFI_GET_MEMORY_MAP) (UINTN *MemoryMapSize, EFI_MEMORY_DESCRIPTOR *MemoryMap, UINTN *MapKey, UINTN *DescriptorSize, UINT32 *DescriptorVersion);
+
 struct EFI_BOOT_SERVICES_ {
   EFI_STATUS (*LocateProtocol)(EFI_GUID *ProtocolGuid, VOID *Registration, VOID **Interface);
   EFI_STATUS (*AllocatePages)(EFI_ALLOCATE_TYPE Type, EFI_MEMORY_TYPE MemoryType, UINTN Pages, EFI_PHYSICAL_ADDRESS *Memory);
@@ -1714,7 +1724,7 @@ struct EFI_BOOT_SERVICES_ {
   EFI_STATUS (*LocateHandleBuffer) (EFI_LOCATE_SEARCH_TYPE SearchType, EFI_GUID * Protocol, VOID *SearchKey, UINTN *NumberHandles, EFI_HANDLE **Buffer);
   EFI_STATUS (*HandleProtocol)(EFI_HANDLE Handle, EFI_GUID *Protocol, VOID **Interface);
   EFI_STATUS (*InstallProtocolInterface) (EFI_HANDLE *Handle, EFI_GUID *Protocol, EFI_INTERFACE_TYPE InterfaceType, VOID *Interface);
-  EFI_STATUS (*GetMemoryMap) (UINTN *MemoryMapSize, EFI_MEMORY_DESCRIPTOR *MemoryMap, UINTN *MapKey, UINTN *DescriptorSize, UINT32 *DescriptorVersion);
+  EFI_GET_MEMORY_MAP GetMemoryMap;
   EFI_STATUS (*FreePool) (void *x);
   EFI_STATUS (*LocateDevicePath) (EFI_GUID *Protocol, EFI_DEVICE_PATH_PROTOCOL **DevicePath, EFI_HANDLE *Device);
 };
@@ -27,6 +27,10 @@
  rm -rf fuzz*.log ; mkdir -p DICT ; cp /System/Library/Kernels/kernel DICT/kernel ; ./Macho -jobs=4 -rss_limit_mb=4096M DICT
 
  rm -rf Macho.dSYM DICT fuzz*.log Macho
+
+ for relocation lookup timing (resolves every relocation of the binary, e.g. a large kext executable,
+ with linear scans and with the sorted relocation index) add -DTEST_RELOC_TIMING=1 -O3 to the normal build line:
+ ./Macho /System/Library/Extensions/IOUSBHostFamily.kext/Contents/MacOS/IOUSBHostFamily
 */
 
 uint8_t *readFile(const char *str, uint32_t *size) {
@@ -48,6 +52,90 @@ uint8_t *readFile(const char *str, uint32_t *size) {
   return string;
 }
 
+#ifdef TEST_RELOC_TIMING
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000; // calculate milliseconds
+    return milliseconds;
+}
+
+static UINT32 ResolveAllRelocations(OC_MACHO_CONTEXT *Context, UINT64 *Addresses, UINT32 NumAddresses, MACH_NLIST_64 **Symbols) {
+  UINT32 Found = 0;
+  for (UINT32 Index = 0; Index < NumAddresses; ++Index) {
+    Symbols[Index] = NULL;
+    if (MachoGetSymbolByRelocationOffset64 (Context, Addresses[Index], &Symbols[Index])) {
+      ++Found;
+    }
+  }
+  return Found;
+}
+
+static void BenchmarkRelocationLookup(OC_MACHO_CONTEXT *Context) {
+  //
+  // Retrieve symbol and relocation tables.
+  //
+  if (MachoGetSymbolByIndex64 (Context, 0) == NULL || Context->DySymtab == NULL) {
+    printf("No relocations to resolve\n");
+    return;
+  }
+
+  UINT32 NumExtern = Context->DySymtab->NumExternalRelocations;
+  UINT32 NumLocal  = Context->DySymtab->NumOfLocalRelocations;
+  UINT32 NumAddresses = NumExtern + NumLocal;
+  if (NumAddresses == 0) {
+    printf("No relocations to resolve\n");
+    return;
+  }
+
+  UINT64 *Addresses = AllocatePool (NumAddresses * sizeof (*Addresses));
+  MACH_NLIST_64 **LinearSymbols = AllocatePool (NumAddresses * sizeof (*LinearSymbols));
+  MACH_NLIST_64 **IndexedSymbols = AllocatePool (NumAddresses * sizeof (*IndexedSymbols));
+  if (Addresses == NULL || LinearSymbols == NULL || IndexedSymbols == NULL) {
+    abort();
+  }
+
+  for (UINT32 Index = 0; Index < NumExtern; ++Index) {
+    Addresses[Index] = (UINT64) Context->ExternRelocations[Index].Address;
+  }
+  for (UINT32 Index = 0; Index < NumLocal; ++Index) {
+    Addresses[NumExtern + Index] = (UINT64) Context->LocalRelocations[Index].Address;
+  }
+
+  MachoFreeRelocationIndex (Context);
+  Context->DisableRelocationIndex = TRUE;
+  long long Start = current_timestamp ();
+  UINT32 LinearFound = ResolveAllRelocations (Context, Addresses, NumAddresses, LinearSymbols);
+  long long LinearTime = current_timestamp () - Start;
+
+  Context->DisableRelocationIndex = FALSE;
+  Start = current_timestamp ();
+  UINT32 IndexedFound = ResolveAllRelocations (Context, Addresses, NumAddresses, IndexedSymbols);
+  long long IndexedTime = current_timestamp () - Start;
+
+  printf (
+    "Resolved %u of %u relocations (%u extern, %u local): linear %lld ms, indexed %lld ms (%u + %u indexed)\n",
+    IndexedFound,
+    NumAddresses,
+    NumExtern,
+    NumLocal,
+    LinearTime,
+    IndexedTime,
+    Context->NumIndexedExternRelocations,
+    Context->NumIndexedLocalRelocations
+    );
+
+  if (LinearFound != IndexedFound || memcmp (LinearSymbols, IndexedSymbols, NumAddresses * sizeof (*LinearSymbols)) != 0) {
+    printf ("Relocation index lookup mismatch!\n");
+    abort();
+  }
+
+  FreePool (Addresses);
+  FreePool (LinearSymbols);
+  FreePool (IndexedSymbols);
+}
+#endif
+
 MACH_HEADER_64 Header;
 MACH_SECTION_64 Sect;
 MACH_SEGMENT_COMMAND_64 Seg;
@@ -283,13 +371,19 @@ static int FeedMacho(void *file, uint32_t size) {
   }
 
   for (size_t i = 0x1000000; i < 0x100000000; i+= 0x1000000) {
-    if ((Symbol = MachoGetSymbolByRelocationOffset64 (&Context, i))) {
+    if (MachoGetSymbolByRelocationOffset64 (&Context, i, &Symbol) && Symbol != NULL) {
       if (!AsciiStrCmp (MachoGetSymbolName64 (&Context, Symbol), "__hack")) {
         code++;
       }
     }
   }
 
+#ifdef TEST_RELOC_TIMING
+  BenchmarkRelocationLookup (&Context);
+#endif
+
+  MachoFreeRelocationIndex (&Context);
+
   return code != 963;
 }
 
@@ -0,0 +1,685 @@
+/** @file
+  Copyright (C) 2020, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/OcMemoryLib.h>
+
+#include <sys/time.h>
+
+/*
+ clang -g -fsanitize=undefined,address -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h MemoryMap.c ../../Library/OcMemoryLib/MemoryMap.c -o MemoryMap
+
+ ./MemoryMap [rounds] [seed]
+
+ Sorts, shrinks, and deduplicates random memory maps with OcMemoryLib and with
+ the previous implementation, and checks that the results are identical apart
+ from documented differences. Maps include entries with equal PhysicalStart.
+ Then reports timing for large unsorted memory maps.
+*/
+
+#define MEMORY_MAP_MAX_ENTRIES  640
+#define MEMORY_MAP_BENCH_ENTRIES 384
+#define MEMORY_MAP_BENCH_ROUNDS  2000
+
+STATIC CONST EFI_MEMORY_TYPE mTypes[] = {
+  EfiReservedMemoryType,
+  EfiLoaderCode,
+  EfiLoaderData,
+  EfiBootServicesCode,
+  EfiBootServicesData,
+  EfiRuntimeServicesCode,
+  EfiRuntimeServicesData,
+  EfiConventionalMemory,
+  EfiACPIReclaimMemory,
+  EfiMemoryMappedIO
+};
+
+//
+// Memory map allocation is not tested, stub out functions from other files.
+//
+UINTN
+OcCountSplitDescritptors (
+  VOID
+  )
+{
+  return 0;
+}
+
+EFI_STATUS
+OcAllocatePagesFromTop (
+  IN     EFI_MEMORY_TYPE         MemoryType,
+  IN     UINTN                   Pages,
+  IN OUT EFI_PHYSICAL_ADDRESS    *Memory,
+  IN     EFI_GET_MEMORY_MAP      GetMemoryMap  OPTIONAL,
+  IN     CHECK_ALLOCATION_RANGE  CheckRange  OPTIONAL
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long microseconds = te.tv_sec*1000000LL + te.tv_usec; // calculate microseconds
+    return microseconds;
+}
+
+//
+// Reference code is OcSortMemoryMap, OcShrinkMemoryMap, and OcDeduplicateDescriptors
+// as they were before sorting and compacting were rewritten.
+//
+
+STATIC
+VOID
+ReferenceSortMemoryMap (
+  IN UINTN                      MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN UINTN                      DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR       *MemoryMapEntry;
+  EFI_MEMORY_DESCRIPTOR       *NextMemoryMapEntry;
+  EFI_MEMORY_DESCRIPTOR       *MemoryMapEnd;
+  EFI_MEMORY_DESCRIPTOR       TempMemoryMap;
+
+  MemoryMapEntry = MemoryMap;
+  NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+  MemoryMapEnd = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + MemoryMapSize);
+  while (MemoryMapEntry < MemoryMapEnd) {
+    while (NextMemoryMapEntry < MemoryMapEnd) {
+      if (MemoryMapEntry->PhysicalStart > NextMemoryMapEntry->PhysicalStart) {
+        CopyMem (&TempMemoryMap, MemoryMapEntry, sizeof(EFI_MEMORY_DESCRIPTOR));
+        CopyMem (MemoryMapEntry, NextMemoryMapEntry, sizeof(EFI_MEMORY_DESCRIPTOR));
+        CopyMem (NextMemoryMapEntry, &TempMemoryMap, sizeof(EFI_MEMORY_DESCRIPTOR));
+      }
+
+      NextMemoryMapEntry = NEXT_MEMORY_DESCRIPTOR (NextMemoryMapEntry, DescriptorSize);
+    }
+
+    MemoryMapEntry      = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+    NextMemoryMapEntry  = NEXT_MEMORY_DESCRIPTOR (MemoryMapEntry, DescriptorSize);
+  }
+}
+
+STATIC
+EFI_STATUS
+ReferenceShrinkMemoryMap (
+  IN OUT UINTN                  *MemoryMapSize,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  EFI_STATUS              Status;
+  UINTN                   SizeFromDescToEnd;
+  UINT64                  Bytes;
+  EFI_MEMORY_DESCRIPTOR   *PrevDesc;
+  EFI_MEMORY_DESCRIPTOR   *Desc;
+  BOOLEAN                 CanBeJoinedFree;
+  BOOLEAN                 CanBeJoinedRt;
+  BOOLEAN                 HasEntriesToRemove;
+
+  Status = EFI_NOT_FOUND;
+
+  if (*MemoryMapSize <= DescriptorSize) {
+    return Status;
+  }
+
+  PrevDesc           = MemoryMap;
+  Desc               = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+  SizeFromDescToEnd  = *MemoryMapSize - DescriptorSize;
+  *MemoryMapSize     = DescriptorSize;
+  HasEntriesToRemove = FALSE;
+
+  while (SizeFromDescToEnd > 0) {
+    Bytes = EFI_PAGES_TO_SIZE (PrevDesc->NumberOfPages);
+    CanBeJoinedFree = FALSE;
+    CanBeJoinedRt   = FALSE;
+    if (Desc->Attribute == PrevDesc->Attribute
+      && PrevDesc->PhysicalStart + Bytes == Desc->PhysicalStart) {
+      //
+      // It *should* be safe to join this with conventional memory, because the firmware should not use
+      // GetMemoryMap for allocation, and for the kernel it does not matter, since it joins them.
+      //
+      CanBeJoinedFree = (
+          Desc->Type == EfiBootServicesCode
+          || Desc->Type == EfiBootServicesData
+          || Desc->Type == EfiConventionalMemory
+          || Desc->Type == EfiLoaderCode
+          || Desc->Type == EfiLoaderData
+        ) && (
+          PrevDesc->Type == EfiBootServicesCode
+          || PrevDesc->Type == EfiBootServicesData
+          || PrevDesc->Type == EfiConventionalMemory
+          || PrevDesc->Type == EfiLoaderCode
+          || PrevDesc->Type == EfiLoaderData
+        );
+
+      CanBeJoinedRt = (
+          Desc->Type == EfiRuntimeServicesCode
+          && PrevDesc->Type == EfiRuntimeServicesCode
+        ) || (
+          Desc->Type == EfiRuntimeServicesData
+          && PrevDesc->Type == EfiRuntimeServicesData
+        );
+    }
+
+    if (CanBeJoinedFree) {
+      //
+      // Two entries are the same/similar - join them
+      //
+      PrevDesc->Type           = EfiConventionalMemory;
+      PrevDesc->NumberOfPages += Desc->NumberOfPages;
+      HasEntriesToRemove       = TRUE;
+      Status                   = EFI_SUCCESS;
+    } else if (CanBeJoinedRt) {
+      PrevDesc->NumberOfPages += Desc->NumberOfPages;
+      HasEntriesToRemove       = TRUE;
+      Status                   = EFI_SUCCESS;
+    } else {
+      //
+      // Cannot be joined - we need to move to next
+      //
+      *MemoryMapSize += DescriptorSize;
+      PrevDesc        = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+      if (HasEntriesToRemove) {
+        //
+        // Have entries between PrevDesc and Desc which are joined to PrevDesc,
+        // we need to copy [Desc, end of list] to PrevDesc + 1
+        //
+        CopyMem (PrevDesc, Desc, SizeFromDescToEnd);
+        Desc = PrevDesc;
+        HasEntriesToRemove = FALSE;
+      }
+    }
+
+    Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize);
+    SizeFromDescToEnd -= DescriptorSize;
+  }
+
+  //
+  // Handle last entries if they were merged.
+  //
+  if (HasEntriesToRemove) {
+    *MemoryMapSize += DescriptorSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+ReferenceDeduplicateDescriptors (
+  IN OUT UINT32                 *EntryCount,
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  EFI_STATUS              Status;
+  UINTN                   EntriesToGo;
+  EFI_MEMORY_DESCRIPTOR   *PrevDesc;
+  EFI_MEMORY_DESCRIPTOR   *Desc;
+  BOOLEAN                 IsDuplicate;
+  BOOLEAN                 HasEntriesToRemove;
+
+  Status = EFI_NOT_FOUND;
+
+  if (*EntryCount <= 1) {
+    return Status;
+  }
+
+  PrevDesc           = MemoryMap;
+  Desc               = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+  EntriesToGo        = *EntryCount - 1;
+  *EntryCount        = 1;
+  HasEntriesToRemove = FALSE;
+
+  while (EntriesToGo > 0) {
+    IsDuplicate = Desc->PhysicalStart == PrevDesc->PhysicalStart
+      && Desc->NumberOfPages == PrevDesc->NumberOfPages;
+
+    if (IsDuplicate) {
+      //
+      // Two entries are duplicate, remove them.
+      //
+      Status               = EFI_SUCCESS;
+      HasEntriesToRemove   = TRUE;
+    } else {
+      //
+      // Not duplicates - we need to move to next
+      //
+      ++(*EntryCount);
+      PrevDesc = NEXT_MEMORY_DESCRIPTOR (PrevDesc, DescriptorSize);
+      if (HasEntriesToRemove) {
+        //
+        // Have same entries between PrevDesc and Desc which are replaced by PrevDesc,
+        // we need to copy [Desc, end of list] to PrevDesc + 1.
+        //
+        CopyMem (PrevDesc, Desc, EntriesToGo * DescriptorSize);
+        Desc = PrevDesc;
+        HasEntriesToRemove = FALSE;
+      }
+    }
+
+    Desc = NEXT_MEMORY_DESCRIPTOR (Desc, DescriptorSize);
+    --EntriesToGo;
+  }
+
+  //
+  // Handle last entries if they were deduplicated.
+  //
+  if (HasEntriesToRemove) {
+    ++(*EntryCount);
+  }
+
+  return Status;
+}
+
+/**
+  Value stored past EFI_MEMORY_DESCRIPTOR to check that it moves with the descriptor.
+**/
+STATIC
+UINT8
+DescriptorTag (
+  IN CONST EFI_MEMORY_DESCRIPTOR  *Desc,
+  IN UINTN                        Offset
+  )
+{
+  return (UINT8) ((Desc->PhysicalStart >> EFI_PAGE_SHIFT) * 31 + Offset);
+}
+
+/**
+  Generate random memory map of mostly contiguous regions. Some entries start
+  where the previous one does, either as its copy or with a different size or type.
+  Entries with equal PhysicalStart, NumberOfPages, and Type are always identical.
+**/
+STATIC
+VOID
+GenerateMemoryMap (
+  OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN  UINTN                  EntryCount,
+  IN  UINTN                  DescriptorSize,
+  IN  BOOLEAN                Shuffle
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *Desc;
+  EFI_MEMORY_DESCRIPTOR  *PrevDesc;
+  EFI_PHYSICAL_ADDRESS   Address;
+  EFI_PHYSICAL_ADDRESS   End;
+  UINTN                  Index;
+  UINTN                  Index2;
+  UINTN                  Offset;
+  UINT8                  Byte;
+
+  Address = EFI_PAGES_TO_SIZE ((UINT64) (rand () % 256));
+
+  for (Index = 0; Index < EntryCount; ++Index) {
+    Desc = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + Index * DescriptorSize);
+
+    if (Index > 0 && rand () % 6 == 0) {
+      PrevDesc = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) Desc - DescriptorSize);
+      CopyMem (Desc, PrevDesc, DescriptorSize);
+
+      switch (rand () % 3) {
+        case 0:
+          break;
+        case 1:
+          while (Desc->Type == PrevDesc->Type) {
+            Desc->Type = mTypes[rand () % ARRAY_SIZE (mTypes)];
+          }
+          break;
+        default:
+          Desc->NumberOfPages += (UINT64) (rand () % 16) + 1;
+          break;
+      }
+
+      End = Desc->PhysicalStart + EFI_PAGES_TO_SIZE (Desc->NumberOfPages);
+      if (End > Address) {
+        Address = End;
+      }
+
+      continue;
+    }
+
+    ZeroMem (Desc, sizeof (*Desc));
+
+    //
+    // Prefer joinable types and equal attributes to have something to shrink.
+    //
+    Desc->Type          = rand () % 2 == 0 ? EfiConventionalMemory : mTypes[rand () % ARRAY_SIZE (mTypes)];
+    Desc->PhysicalStart = Address;
+    Desc->NumberOfPages = (UINT64) (rand () % 64) + 1;
+    Desc->Attribute     = rand () % 4 == 0 ? BIT0 : BIT3; ///< EFI_MEMORY_UC or EFI_MEMORY_WB.
+
+    for (Offset = sizeof (*Desc); Offset < DescriptorSize; ++Offset) {
+      ((UINT8 *) Desc)[Offset] = DescriptorTag (Desc, Offset);
+    }
+
+    Address += EFI_PAGES_TO_SIZE (Desc->NumberOfPages);
+    if (rand () % 8 == 0) {
+      Address += EFI_PAGES_TO_SIZE ((UINT64) (rand () % 16) + 1);
+    }
+  }
+
+  if (Shuffle) {
+    for (Index = EntryCount; Index > 1; --Index) {
+      Index2 = (UINTN) rand () % Index;
+      for (Offset = 0; Offset < DescriptorSize; ++Offset) {
+        Byte = ((UINT8 *) MemoryMap)[(Index - 1) * DescriptorSize + Offset];
+        ((UINT8 *) MemoryMap)[(Index - 1) * DescriptorSize + Offset] = ((UINT8 *) MemoryMap)[Index2 * DescriptorSize + Offset];
+        ((UINT8 *) MemoryMap)[Index2 * DescriptorSize + Offset] = Byte;
+      }
+    }
+  }
+}
+
+/**
+  Reorder runs of entries with equal PhysicalStart by NumberOfPages and Type.
+  Only EFI_MEMORY_DESCRIPTOR part is moved, like the reference sort does.
+**/
+STATIC
+VOID
+OrderEqualStarts (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN     UINTN                  EntryCount,
+  IN     UINTN                  DescriptorSize
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *Desc;
+  EFI_MEMORY_DESCRIPTOR  *PrevDesc;
+  EFI_MEMORY_DESCRIPTOR  Temp;
+  UINTN                  Index;
+  UINTN                  Index2;
+
+  for (Index = 1; Index < EntryCount; ++Index) {
+    for (Index2 = Index; Index2 > 0; --Index2) {
+      Desc     = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + Index2 * DescriptorSize);
+      PrevDesc = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) Desc - DescriptorSize);
+      if (PrevDesc->PhysicalStart != Desc->PhysicalStart
+        || PrevDesc->NumberOfPages < Desc->NumberOfPages
+        || (PrevDesc->NumberOfPages == Desc->NumberOfPages && PrevDesc->Type <= Desc->Type)) {
+        break;
+      }
+
+      CopyMem (&Temp, PrevDesc, sizeof (Temp));
+      CopyMem (PrevDesc, Desc, sizeof (Temp));
+      CopyMem (Desc, &Temp, sizeof (Temp));
+    }
+  }
+}
+
+/**
+  Compare EFI_MEMORY_DESCRIPTOR parts of two memory maps.
+**/
+STATIC
+BOOLEAN
+CompareMemoryMaps (
+  IN CONST EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN CONST EFI_MEMORY_DESCRIPTOR  *ReferenceMap,
+  IN UINTN                        EntryCount,
+  IN UINTN                        DescriptorSize
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < EntryCount; ++Index) {
+    if (memcmp (
+      (CONST UINT8 *) MemoryMap + Index * DescriptorSize,
+      (CONST UINT8 *) ReferenceMap + Index * DescriptorSize,
+      sizeof (EFI_MEMORY_DESCRIPTOR)
+      ) != 0) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Check that data past EFI_MEMORY_DESCRIPTOR moved with every descriptor.
+**/
+STATIC
+BOOLEAN
+CheckDescriptorTags (
+  IN CONST EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN UINTN                        EntryCount,
+  IN UINTN                        DescriptorSize
+  )
+{
+  CONST EFI_MEMORY_DESCRIPTOR  *Desc;
+  UINTN                        Index;
+  UINTN                        Offset;
+
+  for (Index = 0; Index < EntryCount; ++Index) {
+    Desc = (CONST EFI_MEMORY_DESCRIPTOR *) ((CONST UINT8 *) MemoryMap + Index * DescriptorSize);
+    for (Offset = sizeof (*Desc); Offset < DescriptorSize; ++Offset) {
+      if (((CONST UINT8 *) Desc)[Offset] != DescriptorTag (Desc, Offset)) {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+STATIC
+UINT32
+CheckRound (
+  IN EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN EFI_MEMORY_DESCRIPTOR  *ReferenceMap,
+  IN EFI_MEMORY_DESCRIPTOR  *SourceMap,
+  IN UINT32                 Round
+  )
+{
+  UINTN                  DescriptorSize;
+  UINTN                  EntryCount;
+  UINTN                  Index;
+  UINTN                  Offset;
+  UINTN                  MemoryMapSize;
+  UINTN                  ReferenceSize;
+  UINTN                  SourceSize;
+  UINT32                 Count;
+  UINT32                 ReferenceCount;
+  EFI_STATUS             Status;
+  EFI_STATUS             ReferenceStatus;
+  EFI_STATUS             ExpectedStatus;
+  EFI_MEMORY_DESCRIPTOR  *Desc;
+  EFI_MEMORY_DESCRIPTOR  *LastDesc;
+  UINT32                 Failures;
+
+  Failures       = 0;
+  DescriptorSize = sizeof (EFI_MEMORY_DESCRIPTOR) + sizeof (UINT64) * (UINTN) (rand () % 3);
+  EntryCount     = (UINTN) rand () % (MEMORY_MAP_MAX_ENTRIES + 1);
+
+  GenerateMemoryMap (MemoryMap, EntryCount, DescriptorSize, rand () % 4 != 0);
+  CopyMem (ReferenceMap, MemoryMap, EntryCount * DescriptorSize);
+
+  OcSortMemoryMap (EntryCount * DescriptorSize, MemoryMap, DescriptorSize);
+  ReferenceSortMemoryMap (EntryCount * DescriptorSize, ReferenceMap, DescriptorSize);
+
+  //
+  // Reference sort leaves entries with equal PhysicalStart in no particular order.
+  //
+  OrderEqualStarts (ReferenceMap, EntryCount, DescriptorSize);
+
+  if (!CompareMemoryMaps (MemoryMap, ReferenceMap, EntryCount, DescriptorSize)
+    || !CheckDescriptorTags (MemoryMap, EntryCount, DescriptorSize)) {
+    printf ("Round %u sort mismatch for %lu entries\n", Round, (unsigned long) EntryCount);
+    return 1;
+  }
+
+  //
+  // Duplicate some more entries of the sorted map, possibly the last one.
+  //
+  Count = (UINT32) EntryCount;
+  for (Index = 0; Index < EntryCount && Count < MEMORY_MAP_MAX_ENTRIES * 2; ++Index) {
+    if (rand () % 4 != 0) {
+      continue;
+    }
+
+    Offset = ((UINTN) rand () % Count) * DescriptorSize;
+    CopyMem (
+      (UINT8 *) MemoryMap + Offset + DescriptorSize,
+      (UINT8 *) MemoryMap + Offset,
+      Count * DescriptorSize - Offset
+      );
+    ++Count;
+  }
+
+  CopyMem (ReferenceMap, MemoryMap, Count * DescriptorSize);
+  ReferenceCount = Count;
+
+  //
+  // Reference deduplication kept one duplicate when the map ended with duplicates.
+  //
+  ExpectedStatus = EFI_NOT_FOUND;
+  if (Count > 1) {
+    LastDesc = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + (Count - 1) * DescriptorSize);
+    Desc     = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) LastDesc - DescriptorSize);
+    if (Desc->PhysicalStart == LastDesc->PhysicalStart
+      && Desc->NumberOfPages == LastDesc->NumberOfPages) {
+      ExpectedStatus = EFI_SUCCESS;
+    }
+  }
+
+  Status          = OcDeduplicateDescriptors (&Count, MemoryMap, DescriptorSize);
+  ReferenceStatus = ReferenceDeduplicateDescriptors (&ReferenceCount, ReferenceMap, DescriptorSize);
+
+  if (ExpectedStatus == EFI_SUCCESS) {
+    --ReferenceCount;
+  }
+
+  if (Status != ReferenceStatus
+    || Count != ReferenceCount
+    || !CompareMemoryMaps (MemoryMap, ReferenceMap, Count, DescriptorSize)
+    || !CheckDescriptorTags (MemoryMap, Count, DescriptorSize)) {
+    printf ("Round %u deduplication mismatch for %lu entries\n", Round, (unsigned long) EntryCount);
+    ++Failures;
+  }
+
+  MemoryMapSize = Count * DescriptorSize;
+  ReferenceSize = MemoryMapSize;
+  SourceSize    = MemoryMapSize;
+  CopyMem (ReferenceMap, MemoryMap, MemoryMapSize);
+  CopyMem (SourceMap, MemoryMap, MemoryMapSize);
+
+  Status = OcShrinkMemoryMap (&MemoryMapSize, MemoryMap, DescriptorSize);
+  ReferenceShrinkMemoryMap (&ReferenceSize, ReferenceMap, DescriptorSize);
+
+  //
+  // Reference shrinking kept one stale entry when the last entry was joined,
+  // and returned EFI_SUCCESS even when nothing was joined.
+  //
+  if (SourceSize > DescriptorSize) {
+    LastDesc = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) SourceMap + SourceSize - DescriptorSize);
+    Desc     = (EFI_MEMORY_DESCRIPTOR *) ((UINT8 *) MemoryMap + MemoryMapSize - DescriptorSize);
+    if (Desc->PhysicalStart != LastDesc->PhysicalStart) {
+      ReferenceSize -= DescriptorSize;
+    }
+  }
+
+  ExpectedStatus = MemoryMapSize < SourceSize ? EFI_SUCCESS : EFI_NOT_FOUND;
+
+  if (Status != ExpectedStatus
+    || MemoryMapSize != ReferenceSize
+    || !CompareMemoryMaps (MemoryMap, ReferenceMap, MemoryMapSize / DescriptorSize, DescriptorSize)
+    || !CheckDescriptorTags (MemoryMap, MemoryMapSize / DescriptorSize, DescriptorSize)) {
+    printf ("Round %u shrink mismatch for %lu entries\n", Round, (unsigned long) EntryCount);
+    ++Failures;
+  }
+
+  return Failures;
+}
+
+STATIC
+VOID
+Benchmark (
+  IN EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN EFI_MEMORY_DESCRIPTOR  *SourceMap
+  )
+{
+  UINTN      DescriptorSize;
+  UINTN      MemoryMapSize;
+  UINT32     Round;
+  long long  Start;
+  long long  Time;
+  long long  ReferenceTime;
+
+  DescriptorSize = sizeof (EFI_MEMORY_DESCRIPTOR) + sizeof (UINT64);
+  GenerateMemoryMap (SourceMap, MEMORY_MAP_BENCH_ENTRIES, DescriptorSize, TRUE);
+
+  Time = 0;
+  ReferenceTime = 0;
+
+  for (Round = 0; Round < MEMORY_MAP_BENCH_ROUNDS; ++Round) {
+    CopyMem (MemoryMap, SourceMap, MEMORY_MAP_BENCH_ENTRIES * DescriptorSize);
+    MemoryMapSize = MEMORY_MAP_BENCH_ENTRIES * DescriptorSize;
+    Start = current_timestamp ();
+    OcSortMemoryMap (MemoryMapSize, MemoryMap, DescriptorSize);
+    OcShrinkMemoryMap (&MemoryMapSize, MemoryMap, DescriptorSize);
+    Time += current_timestamp () - Start;
+
+    CopyMem (MemoryMap, SourceMap, MEMORY_MAP_BENCH_ENTRIES * DescriptorSize);
+    MemoryMapSize = MEMORY_MAP_BENCH_ENTRIES * DescriptorSize;
+    Start = current_timestamp ();
+    ReferenceSortMemoryMap (MemoryMapSize, MemoryMap, DescriptorSize);
+    ReferenceShrinkMemoryMap (&MemoryMapSize, MemoryMap, DescriptorSize);
+    ReferenceTime += current_timestamp () - Start;
+  }
+
+  printf (
+    "Sort and shrink of %u entries: %lld us, reference %lld us\n",
+    MEMORY_MAP_BENCH_ENTRIES,
+    Time / MEMORY_MAP_BENCH_ROUNDS,
+    ReferenceTime / MEMORY_MAP_BENCH_ROUNDS
+    );
+}
+
+int main(int argc, char** argv) {
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  EFI_MEMORY_DESCRIPTOR  *ReferenceMap;
+  EFI_MEMORY_DESCRIPTOR  *SourceMap;
+  UINTN                  MaxSize;
+  UINT32                 Rounds;
+  UINT32                 Round;
+  UINT32                 Failures;
+
+  Rounds = argc > 1 ? (UINT32) strtoul (argv[1], NULL, 0) : 1000;
+  srand (argc > 2 ? (unsigned) strtoul (argv[2], NULL, 0) : 0);
+
+  //
+  // Up to three extra words per descriptor and room for duplicates.
+  //
+  MaxSize      = MEMORY_MAP_MAX_ENTRIES * 2 * (sizeof (EFI_MEMORY_DESCRIPTOR) + 3 * sizeof (UINT64));
+  MemoryMap    = malloc (MaxSize);
+  ReferenceMap = malloc (MaxSize);
+  SourceMap    = malloc (MaxSize);
+  if (MemoryMap == NULL || ReferenceMap == NULL || SourceMap == NULL) {
+    printf ("Alloc fail\n");
+    return -1;
+  }
+
+  Failures = 0;
+  for (Round = 0; Round < Rounds; ++Round) {
+    Failures += CheckRound (MemoryMap, ReferenceMap, SourceMap, Round);
+  }
+
+  printf ("%u rounds, %u failures\n", Rounds, Failures);
+
+  Benchmark (MemoryMap, SourceMap);
+
+  free (MemoryMap);
+  free (ReferenceMap);
+  free (SourceMap);
+
+  return Failures == 0 ? 0 : -1;
+}
@@ -17,22 +17,29 @@
 #include <Library/OcMiscLib.h>
 #include <Library/OcAppleKernelLib.h>
 
+#include "../../Library/OcAppleKernelLib/PrelinkedInternal.h"
+
 #include <sys/time.h>
 
 /*
- clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -I../../../UefiCpuPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
+ clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -I../../../UefiCpuPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcMiscLib/Fnv1a.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c ../../Library/OcCompressionLib/zlib/inflate.c ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
 
  for fuzzing:
- clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
+ clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcMiscLib/Fnv1a.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c ../../Library/OcCompressionLib/zlib/inflate.c ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
  rm -rf DICT fuzz*.log ; mkdir DICT ; find /System/Library/Extensions/<< * >>/Contents/MacOS -type f -exec cp {} DICT \; UBSAN_OPTIONS='halt_on_error=1' ./Prelinked -jobs=4 DICT -rss_limit_mb=4096
 
  rm -rf Prelinked.dSYM DICT fuzz*.log Prelinked
 
- clang -DTEST_SLE=1 -g -O3 -fno-sanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c  -o Prelinked
+ clang -DTEST_SLE=1 -g -O3 -fno-sanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcMiscLib/Fnv1a.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c ../../Library/OcCompressionLib/zlib/inflate.c ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c  -o Prelinked
 
  for i in /System/Library/Extensions/<< * >>.kext ; do plist=$i/Contents/Info.plist ; kext="$i/Contents/MacOS/$(/usr/libexec/PlistBuddy -c 'Print CFBundleExecutable' "$plist")" ; echo "$kext $plist" ; ./Prelinked prelinkedkernel.unpack "$kext" "$plist" ; done
 
  /[^\n]+\nPassed.kext injected - 0x8[^\n]+
+
+ for linker timing (compares linear symbol and kext lookup with indexed lookup, including a kernel symbol
+ lookup micro-benchmark and __PRELINK_INFO parse timing with arena slab counts printed on document free)
+ add -DTEST_LINK_TIMING=1 -O3 to the normal build line:
+ ./Prelinked prelinkedkernel.unpack /path/to/kext1 /path/to/Info1.plist /path/to/kext2 /path/to/Info2.plist ...
 */
 
 STATIC CHAR8 KextInfoPlistData[] = {
@@ -417,6 +424,187 @@ ApplyKernelPatches (
   }
 }
 
+BOOLEAN DisableSymbolIndices;
+
+#ifdef TEST_LINK_TIMING
+VOID
+BenchmarkKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS  Status;
+  long long   Start;
+
+  //
+  // Rebuild the index to time it separately from plist parsing, or drop it
+  // to compare against KextList walks.
+  //
+  if (Context->KextIndex != NULL) {
+    FreePool (Context->KextIndex);
+    Context->KextIndex      = NULL;
+    Context->KextIndexCount = 0;
+    Context->KextIndexMask  = 0;
+  }
+
+  if (DisableSymbolIndices) {
+    return;
+  }
+
+  Start  = current_timestamp ();
+  Status = InternalBuildPrelinkedKextIndex (Context);
+  printf (
+    "Kext index build took %lld ms (%u identifiers) - %zx\n",
+    current_timestamp () - Start,
+    Context->KextIndexCount,
+    Status
+    );
+}
+
+VOID
+BenchmarkKernelSymbolLookup (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS                  Status;
+  PRELINKED_KEXT              *Kernel;
+  CONST PRELINKED_KEXT_SYMBOL *Symbol;
+  UINT32                      Index;
+  UINT32                      FoundNames;
+  UINT32                      FoundValues;
+  long long                   Start;
+
+  Kernel = InternalCachedPrelinkedKernel (Context);
+  if (Kernel == NULL) {
+    printf("Kernel lookup fail\n");
+    return;
+  }
+
+  Status = InternalScanPrelinkedKext (Kernel, Context, TRUE);
+  if (EFI_ERROR (Status)) {
+    printf("Kernel scan fail %zx\n", Status);
+    return;
+  }
+
+  FoundNames = 0;
+  Start = current_timestamp ();
+  for (Index = Kernel->NumberOfSymbols - Kernel->NumberOfCxxSymbols; Index < Kernel->NumberOfSymbols; ++Index) {
+    Symbol = InternalOcGetSymbolName (Context, Kernel, Kernel->LinkedSymbolTable[Index].Name, OcGetSymbolOnlyCxx);
+    if (Symbol != NULL) {
+      ++FoundNames;
+    }
+  }
+  printf (
+    "Kernel C++ name lookup took %lld ms (%u/%u found)\n",
+    current_timestamp () - Start,
+    FoundNames,
+    Kernel->NumberOfCxxSymbols
+    );
+
+  FoundValues = 0;
+  Start = current_timestamp ();
+  for (Index = Kernel->NumberOfSymbols - Kernel->NumberOfCxxSymbols; Index < Kernel->NumberOfSymbols; ++Index) {
+    Symbol = InternalOcGetSymbolValue (Context, Kernel, Kernel->LinkedSymbolTable[Index].Value, OcGetSymbolOnlyCxx);
+    if (Symbol != NULL) {
+      ++FoundValues;
+    }
+  }
+  printf (
+    "Kernel C++ value lookup took %lld ms (%u/%u found)\n",
+    current_timestamp () - Start,
+    FoundValues,
+    Kernel->NumberOfCxxSymbols
+    );
+}
+#endif
+
+#ifdef TEST_LINK_TIMING
+STATIC
+VOID
+CountXmlAllocations (
+  IN  XML_NODE  *Node,
+  OUT UINT32    *NodeCount,
+  OUT UINT32    *ListCount
+  )
+{
+  UINT32  Index;
+  UINT32  Children;
+  UINT32  AllocCount;
+
+  ++(*NodeCount);
+
+  //
+  // Child lists grow three times from 1 element.
+  //
+  Children = XmlNodeChildren (Node);
+  for (AllocCount = 1; Children > 0 && AllocCount / 3 < Children; AllocCount *= 3) {
+    ++(*ListCount);
+  }
+
+  for (Index = 0; Index < Children; ++Index) {
+    CountXmlAllocations (XmlNodeChild (Node, Index), NodeCount, ListCount);
+  }
+}
+
+VOID
+BenchmarkPrelinkedInfoParse (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  XML_DOCUMENT  *Document;
+  CHAR8         *Info;
+  UINT32        InfoSize;
+  UINT32        NodeCount;
+  UINT32        ListCount;
+  UINT32        Index;
+  long long     ParseTime;
+  long long     FreeTime;
+  long long     Start;
+
+  InfoSize  = (UINT32) Context->PrelinkedInfoSection->Size;
+  Info      = AllocatePool (InfoSize);
+  ParseTime = 0;
+  FreeTime  = 0;
+  NodeCount = 0;
+  ListCount = 0;
+
+  if (Info == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < 10; ++Index) {
+    CopyMem (Info, &Context->Prelinked[Context->PrelinkedInfoSection->Offset], InfoSize);
+
+    Start    = current_timestamp ();
+    Document = XmlDocumentParse (Info, InfoSize, TRUE);
+    ParseTime += current_timestamp () - Start;
+
+    if (Document == NULL) {
+      printf ("Prelinked info parse failed\n");
+      break;
+    }
+
+    if (Index == 0) {
+      CountXmlAllocations (XmlDocumentRoot (Document), &NodeCount, &ListCount);
+    }
+
+    Start = current_timestamp ();
+    XmlDocumentFree (Document);
+    FreeTime += current_timestamp () - Start;
+  }
+
+  printf (
+    "Prelinked info parse took %lld ms, free took %lld ms per run (%u nodes, %u lists, %u per-node pool allocations replaced)\n",
+    ParseTime / 10,
+    FreeTime / 10,
+    NodeCount,
+    ListCount,
+    NodeCount + ListCount
+    );
+
+  FreePool (Info);
+}
+#endif
+
 #ifdef FUZZING_TEST
 #define main no_main
 #endif
@@ -498,17 +686,34 @@ int wrap_main(int argc, char** argv) {
   ApplyKernelPatches (Prelinked, PrelinkedSize);
 #endif
 
+  long long InitStart = current_timestamp ();
+
   EFI_STATUS Status = PrelinkedContextInit (&Context, Prelinked, PrelinkedSize, AllocSize);
 
+  printf ("Context init took %lld ms\n", current_timestamp () - InitStart);
+
   if (!EFI_ERROR (Status)) {
+    Context.DisableSymbolIndices = DisableSymbolIndices;
+
+#ifdef TEST_LINK_TIMING
+    BenchmarkKextIndex (&Context);
+    BenchmarkPrelinkedInfoParse (&Context);
+#endif
+
     ApplyKextPatches (&Context);
 
+    long long InjectStart = current_timestamp ();
+
     Status = PrelinkedInjectPrepare (&Context);
     if (EFI_ERROR (Status)) {
       printf("Prelink inject prepare error %zx\n", Status);
       return -1;
     }
 
+#ifdef TEST_LINK_TIMING
+    BenchmarkKernelSymbolLookup (&Context);
+#endif
+
 #ifndef TEST_SLE
     Status = PrelinkedInjectKext (
       &Context,
@@ -586,7 +791,15 @@ int wrap_main(int argc, char** argv) {
 
       DEBUG ((DEBUG_WARN, "VirtualSMC.kext injected - %r\n", Status));
     }
+#endif
 
+    printf (
+      "Kext injection took %lld ms with %s symbol lookup\n",
+      current_timestamp () - InjectStart,
+      DisableSymbolIndices ? "linear" : "indexed"
+      );
+
+#ifndef TEST_SLE
     Status = PrelinkedInjectComplete (&Context);
 
     if (EFI_ERROR (Status)) {
@@ -671,6 +884,11 @@ INT32 LLVMFuzzerTestOneInput(CONST UINT8 *Data, UINTN Size) {
 }
 
 int main(int argc, char *argv[]) {
+#ifdef TEST_LINK_TIMING
+  DisableSymbolIndices = TRUE;
+  wrap_main(argc, argv);
+  DisableSymbolIndices = FALSE;
+#endif
   for (size_t i = 0; i < 1; i++) {
     wrap_main(argc, argv);
   }
@@ -15,6 +15,13 @@
 
 /**
 clang -g -fsanitize=undefined,address -I../Include -I../../Include  -I../../Library/OcCryptoLib -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h RsaPreprocess.c  ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcCryptoLib/BigNumMontgomery.c ../../Library/OcCryptoLib/BigNumPrimitives.c ../../Library/OcCryptoLib/X64/BigNumWordMul64.c -o RsaPreprocess
+
+./RsaPreprocess [key files]
+
+Checks Montgomery parameters of the given and inbuilt keys, then compares
+exponentiation results for several exponents and reports the cost of
+parameter calculation against exponentiation for 2048, 3072 and 4096-bit
+moduli.
 **/
 
 #include <Base.h>
@@ -24,6 +31,17 @@ clang -g -fsanitize=undefined,address -I../Include -I../../Include  -I../../Libr
 
 #include <BigNumLib.h>
 
+#include <sys/time.h>
+
+#define POW_MOD_ROUNDS  16
+
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long microseconds = te.tv_sec*1000000LL + te.tv_usec; // calculate microseconds
+    return microseconds;
+}
+
 uint8_t *readFile(const char *str, uint32_t *size) {
   FILE *f = fopen(str, "rb");
 
@@ -76,10 +94,139 @@ int verifyRsa (CONST OC_RSA_PUBLIC_KEY *PublicKey, char *Name)
   return 0;
 }
 
+void randomNum (OC_BN_WORD *Num, OC_BN_NUM_WORDS NumWords)
+{
+  unsigned int Index;
+
+  for (Index = 0; Index < NumWords * OC_BN_WORD_SIZE; ++Index) {
+    ((uint8_t *) Num)[Index] = (uint8_t) rand ();
+  }
+}
+
+int powModEqual (
+  OC_BN_NUM_WORDS   NumWords,
+  CONST OC_BN_WORD  *A,
+  UINT32            B,
+  UINT32            B1,
+  UINT32            B2,
+  CONST OC_BN_WORD  *N,
+  OC_BN_WORD        N0Inv,
+  CONST OC_BN_WORD  *RSqrMod,
+  OC_BN_WORD        *Tmp
+  )
+{
+  UINTN Size = NumWords * OC_BN_WORD_SIZE;
+
+  //
+  // A^B == (A^B1)^B2 for B == B1 * B2.
+  //
+  if (!BigNumPowMod (Tmp, NumWords, A, B, N, N0Inv, RSqrMod)
+    || !BigNumPowMod (&Tmp[NumWords], NumWords, A, B1, N, N0Inv, RSqrMod)
+    || !BigNumPowMod (&Tmp[2 * NumWords], NumWords, &Tmp[NumWords], B2, N, N0Inv, RSqrMod)) {
+    return 0;
+  }
+
+  return memcmp (Tmp, &Tmp[2 * NumWords], Size) == 0;
+}
+
+int benchmarkPowMod (unsigned int NumBits)
+{
+  OC_BN_NUM_WORDS NumWords = NumBits / OC_BN_WORD_NUM_BITS;
+  UINTN           Size     = NumWords * OC_BN_WORD_SIZE;
+  OC_BN_WORD      *N;
+  OC_BN_WORD      *A;
+  OC_BN_WORD      *RSqrMod;
+  OC_BN_WORD      *Tmp;
+  OC_BN_WORD      N0Inv;
+  unsigned int    Index;
+  int             Failures;
+  long long       Start;
+  long long       ParamsTime;
+  long long       Pow65537Time;
+  long long       PowGenericTime;
+
+  N       = malloc (Size);
+  A       = malloc (Size);
+  RSqrMod = malloc (Size);
+  Tmp     = malloc (3 * Size);
+  if (N == NULL || A == NULL || RSqrMod == NULL || Tmp == NULL) {
+    printf ("memory allocation error!\n");
+    return -1;
+  }
+
+  Failures       = 0;
+  ParamsTime     = 0;
+  Pow65537Time   = 0;
+  PowGenericTime = 0;
+
+  for (Index = 0; Index < POW_MOD_ROUNDS; ++Index) {
+    //
+    // Odd modulus of exactly NumBits bits and a base below it.
+    //
+    randomNum (N, NumWords);
+    randomNum (A, NumWords);
+    N[0]            |= 1U;
+    N[NumWords - 1] |= (OC_BN_WORD) 1U << (OC_BN_WORD_NUM_BITS - 1);
+    A[NumWords - 1] &= ~((OC_BN_WORD) 1U << (OC_BN_WORD_NUM_BITS - 1));
+
+    Start      = current_timestamp ();
+    N0Inv      = BigNumCalculateMontParams (RSqrMod, NumWords, N);
+    ParamsTime += current_timestamp () - Start;
+    if (N0Inv == 0) {
+      ++Failures;
+      continue;
+    }
+
+    Start = current_timestamp ();
+    if (!BigNumPowMod (Tmp, NumWords, A, 0x10001, N, N0Inv, RSqrMod)) {
+      ++Failures;
+    }
+    Pow65537Time += current_timestamp () - Start;
+
+    Start = current_timestamp ();
+    if (!BigNumPowMod (Tmp, NumWords, A, 0xC0000003U, N, N0Inv, RSqrMod)) {
+      ++Failures;
+    }
+    PowGenericTime += current_timestamp () - Start;
+
+    if (!powModEqual (NumWords, A, 9, 3, 3, N, N0Inv, RSqrMod, Tmp)
+      || !powModEqual (NumWords, A, 0x30003, 0x10001, 3, N, N0Inv, RSqrMod, Tmp)
+      || !powModEqual (NumWords, A, 0x90009, 0x30003, 3, N, N0Inv, RSqrMod, Tmp)
+      || !powModEqual (NumWords, A, 0xC0000003U, 0x40000001U, 3, N, N0Inv, RSqrMod, Tmp)
+      || !powModEqual (NumWords, A, 35, 5, 7, N, N0Inv, RSqrMod, Tmp)) {
+      printf ("%u-bit: exponentiation %u mismatch\n", NumBits, Index);
+      ++Failures;
+    }
+
+    if (BigNumPowMod (Tmp, NumWords, A, 1, N, N0Inv, RSqrMod)
+      || BigNumPowMod (Tmp, NumWords, A, 2, N, N0Inv, RSqrMod)
+      || BigNumPowMod (Tmp, NumWords, A, 0x10000, N, N0Inv, RSqrMod)) {
+      printf ("%u-bit: invalid exponent accepted\n", NumBits);
+      ++Failures;
+    }
+  }
+
+  printf (
+    "%u-bit: %d failures, params %lld us, e=65537 %lld us, e=0xC0000003 %lld us\n",
+    NumBits,
+    Failures,
+    ParamsTime / POW_MOD_ROUNDS,
+    Pow65537Time / POW_MOD_ROUNDS,
+    PowGenericTime / POW_MOD_ROUNDS
+    );
+
+  free (N);
+  free (A);
+  free (RSqrMod);
+  free (Tmp);
+  return Failures == 0 ? 0 : -1;
+}
+
 int main(int argc, char *argv[]) {
   unsigned int      Index;
   OC_RSA_PUBLIC_KEY *PublicKey;
   uint32_t          PkSize;
+  int               Status;
 
   for (Index = 1; Index < argc; ++Index) {
     PublicKey = (OC_RSA_PUBLIC_KEY *)readFile (argv[Index], &PkSize);
@@ -96,5 +243,10 @@ int main(int argc, char *argv[]) {
     verifyRsa (PkDataBase[Index].PublicKey, "inbuilt");
   }
 
-  return 0;
+  Status = 0;
+  Status |= benchmarkPowMod (2048);
+  Status |= benchmarkPowMod (3072);
+  Status |= benchmarkPowMod (4096);
+
+  return Status;
 }